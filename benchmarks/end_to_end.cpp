@@ -0,0 +1,736 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //For std::min, std::max and to find triangles with std::search.
+#include <chrono> //To time the conversions.
+#include <cstdint> //To write binary STL files.
+#include <cstdio> //To remove the large files of the ZIP64 check.
+#include <cstdlib> //To parse the arguments.
+#include <cstring> //To write floats into binary STL files with memcpy.
+#include <fstream> //To write the corpus and the baseline.
+#include <iostream> //To report the results.
+#include <map> //To store the baseline.
+#include <set> //To find unique vertices in the output.
+#include <sstream> //To read the baseline.
+#include <string> //To store file names.
+#include <vector> //To store the corpus.
+
+#include "estimate.hpp" //To calibrate the coefficients of the estimator.
+#include "zip_reader.hpp" //To read the resulting 3MF files.
+
+#include <fcntl.h> //To silence the output of the conversions.
+#include <sys/resource.h> //To measure the peak memory usage of the conversions.
+#include <sys/stat.h> //To create the directory for the corpus.
+#include <sys/wait.h> //To wait for the conversions to finish.
+#include <unistd.h> //To start the conversions.
+
+namespace {
+
+/*!
+ * A file in the corpus, and what the 3MF file converted from it must contain.
+ */
+struct CorpusFile {
+	/*!
+	 * A name to identify this file in the results and in the baseline.
+	 */
+	std::string name;
+
+	/*!
+	 * The file name of the input file, within the corpus directory.
+	 */
+	std::string filename;
+
+	/*!
+	 * How many objects the 3MF file must contain.
+	 */
+	size_t objects;
+
+	/*!
+	 * How many unique vertices each object must contain.
+	 */
+	size_t vertices_per_object;
+
+	/*!
+	 * How many triangles each object must contain.
+	 */
+	size_t triangles_per_object;
+};
+
+/*!
+ * The performance of converting one file.
+ */
+struct Measurement {
+	/*!
+	 * How many megabytes of input were converted per second.
+	 */
+	double throughput;
+
+	/*!
+	 * The peak memory usage of the conversion, in kilobytes.
+	 */
+	long peak_rss;
+};
+
+/*!
+ * A conversion measured to calibrate the estimator.
+ */
+struct CalibrationSample {
+	/*!
+	 * The size of the input file, in bytes.
+	 */
+	size_t bytes;
+
+	/*!
+	 * The number of triangles in the input file.
+	 */
+	size_t triangles;
+
+	/*!
+	 * The best duration of the conversion, in seconds.
+	 */
+	double seconds;
+
+	/*!
+	 * The peak memory usage of the conversion, in bytes.
+	 */
+	double peak_memory;
+};
+
+/*!
+ * The height of a vertex in the grids of the corpus.
+ *
+ * This is a fixed pseudo-random integer, so that the corpus is the same every
+ * time and the coordinates can be written exactly in any format.
+ * \param x The column of the vertex in the grid.
+ * \param y The row of the vertex in the grid.
+ * \return The height of the vertex.
+ */
+int height(const size_t x, const size_t y) {
+	uint32_t hash = x * 73856093u ^ y * 19349663u;
+	hash ^= hash >> 13;
+	hash *= 0x5bd1e995u;
+	hash ^= hash >> 15;
+	return hash % 100;
+}
+
+/*!
+ * Calls a function for each triangle of a grid of `size` by `size` squares,
+ * with the corners of the triangle as grid positions.
+ * \param size The number of squares along each side of the grid.
+ * \param function The function to call with the column and row of each of the
+ * three corners.
+ */
+template<typename Function>
+void for_each_grid_triangle(const size_t size, Function function) {
+	for(size_t y = 0; y < size; ++y) {
+		for(size_t x = 0; x < size; ++x) {
+			function(x, y, x + 1, y, x + 1, y + 1);
+			function(x, y, x + 1, y + 1, x, y + 1);
+		}
+	}
+}
+
+/*!
+ * Write a grid as a binary STL file.
+ * \param filename The file to write.
+ * \param size The number of squares along each side of the grid.
+ */
+void write_stl_binary(const std::string& filename, const size_t size) {
+	std::ofstream file(filename, std::ios_base::out | std::ios_base::binary);
+	const std::string header(80, ' ');
+	file.write(header.data(), header.size());
+	const uint32_t num_triangles = size * size * 2;
+	file.write(reinterpret_cast<const char*>(&num_triangles), sizeof(num_triangles));
+	for_each_grid_triangle(size, [&file](const size_t x0, const size_t y0, const size_t x1, const size_t y1, const size_t x2, const size_t y2) {
+		char record[50] = {0};
+		const float coordinates[9] = {float(x0), float(y0), float(height(x0, y0)), float(x1), float(y1), float(height(x1, y1)), float(x2), float(y2), float(height(x2, y2))};
+		memcpy(record + 12, coordinates, sizeof(coordinates)); //Leave the normal zero.
+		file.write(record, sizeof(record));
+	});
+}
+
+/*!
+ * Write a number of grids as solids in an ASCII STL file.
+ * \param filename The file to write.
+ * \param size The number of squares along each side of each grid.
+ * \param solids The number of solids to write.
+ */
+void write_stl_ascii(const std::string& filename, const size_t size, const size_t solids) {
+	std::ofstream file(filename);
+	for(size_t solid = 0; solid < solids; ++solid) {
+		file << "solid grid" << solid << "\n";
+		for_each_grid_triangle(size, [&file](const size_t x0, const size_t y0, const size_t x1, const size_t y1, const size_t x2, const size_t y2) {
+			file << "  facet normal 0 0 1\n    outer loop\n"
+				<< "      vertex " << x0 << " " << y0 << " " << height(x0, y0) << "\n"
+				<< "      vertex " << x1 << " " << y1 << " " << height(x1, y1) << "\n"
+				<< "      vertex " << x2 << " " << y2 << " " << height(x2, y2) << "\n"
+				<< "    endloop\n  endfacet\n";
+		});
+		file << "endsolid grid" << solid << "\n";
+	}
+}
+
+/*!
+ * Write a grid as an OBJ file with quads.
+ *
+ * Half of the quads refer to their vertices with negative indices. The first
+ * row of vertices is written twice, and the quads along that row refer only to
+ * the copies, so the unused originals must not end up in the output.
+ * \param filename The file to write.
+ * \param size The number of squares along each side of the grid.
+ */
+void write_obj(const std::string& filename, const size_t size) {
+	std::ofstream file(filename);
+	for(size_t y = 0; y <= size; ++y) {
+		for(size_t x = 0; x <= size; ++x) {
+			file << "v " << x << " " << y << " " << height(x, y) << "\n";
+		}
+	}
+	for(size_t x = 0; x <= size; ++x) { //Copies of the first row.
+		file << "v " << x << " 0 " << height(x, 0) << "\n";
+	}
+	const long num_vertices = (size + 1) * (size + 2);
+	const auto index = [size](const size_t x, const size_t y) -> long {
+		if(y == 0) {
+			return (size + 1) * (size + 1) + x + 1; //Use the copy.
+		}
+		return y * (size + 1) + x + 1;
+	};
+	for(size_t y = 0; y < size; ++y) {
+		for(size_t x = 0; x < size; ++x) {
+			const long corners[4] = {index(x, y), index(x + 1, y), index(x + 1, y + 1), index(x, y + 1)};
+			file << "f";
+			for(const long corner : corners) {
+				file << " " << (((x + y) % 2 == 0) ? corner : corner - num_vertices - 1);
+			}
+			file << "\n";
+		}
+	}
+}
+
+/*!
+ * Run the command line application on a file.
+ * \param executable The command line application.
+ * \param input The file to convert.
+ * \param output The 3MF file to write.
+ * \param peak_rss Output parameter for the peak memory usage in kilobytes.
+ * \param extra_argument An additional option to pass to the application, if
+ * not empty.
+ * \return Whether the conversion finished successfully.
+ */
+bool run_conversion(const std::string& executable, const std::string& input, const std::string& output, long& peak_rss, const std::string& extra_argument = "") {
+	const std::string output_argument = "--output=" + output;
+	const pid_t process = fork();
+	if(process < 0) {
+		return false;
+	}
+	if(process == 0) { //In the child process.
+		const int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO); //Don't mix the progress messages with the results.
+		if(extra_argument.empty()) {
+			execl(executable.c_str(), executable.c_str(), input.c_str(), output_argument.c_str(), static_cast<char*>(nullptr));
+		} else {
+			execl(executable.c_str(), executable.c_str(), input.c_str(), output_argument.c_str(), extra_argument.c_str(), static_cast<char*>(nullptr));
+		}
+		_exit(127); //Couldn't start the application.
+	}
+	int status;
+	struct rusage usage;
+	if(wait4(process, &status, 0, &usage) < 0) {
+		return false;
+	}
+	peak_rss = usage.ru_maxrss;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/*!
+ * Convert multiple files in a batch with a journal, in a separate process.
+ * \param executable The convertto3mf application.
+ * \param inputs The files to convert, in order.
+ * \param output_directory The directory to store the 3MF files in.
+ * \param journal The journal of the batch.
+ * \return Whether the application ran until the end and exited normally,
+ * even if some of the files failed to convert.
+ */
+bool run_batch(const std::string& executable, const std::vector<std::string>& inputs, const std::string& output_directory, const std::string& journal) {
+	std::vector<std::string> arguments = {executable};
+	arguments.insert(arguments.end(), inputs.begin(), inputs.end());
+	arguments.push_back("--output=" + output_directory);
+	arguments.push_back("--journal=" + journal);
+	const pid_t process = fork();
+	if(process < 0) {
+		return false;
+	}
+	if(process == 0) { //In the child process.
+		const int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO); //Don't mix the progress messages with the results.
+		std::vector<char*> argv;
+		for(std::string& argument : arguments) {
+			argv.push_back(&argument[0]);
+		}
+		argv.push_back(nullptr);
+		execv(executable.c_str(), argv.data());
+		_exit(127); //Couldn't start the application.
+	}
+	int status;
+	if(waitpid(process, &status, 0) < 0) {
+		return false;
+	}
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/*!
+ * Write a binary PLY file that claims to have far more faces than fit in
+ * memory.
+ *
+ * Importing it runs out of memory with a `std::bad_alloc` rather than a
+ * `std::runtime_error`, the usual way for an input to fail.
+ * \param filename The file to write.
+ */
+void write_ply_oversized(const std::string& filename) {
+	std::ofstream file(filename, std::ios_base::out | std::ios_base::binary);
+	file << "ply\nformat binary_little_endian 1.0\nelement vertex 3\nproperty float x\nproperty float y\nproperty float z\nelement face 1000000000000000\nproperty list uchar int vertex_indices\nend_header\n";
+	const float coordinates[9] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+	file.write(reinterpret_cast<const char*>(coordinates), sizeof(coordinates));
+	const char vertex_count = 3;
+	const int32_t indices[3] = {0, 1, 2};
+	file.write(&vertex_count, 1);
+	file.write(reinterpret_cast<const char*>(indices), sizeof(indices));
+}
+
+/*!
+ * Check whether a 3MF file contains what it should.
+ * \param filename The 3MF file to check.
+ * \param expected What the 3MF file must contain.
+ * \return An empty string if the file is correct, or a description of what is
+ * wrong.
+ */
+std::string verify(const std::string& filename, const CorpusFile& expected) {
+	const convertto3mf::ZipReader archive(filename);
+	if(!archive.is_valid()) {
+		return "The 3MF file can't be opened.";
+	}
+	if(!archive.find("3D/3dmodel.model")) {
+		return "The 3MF file contains no 3D model.";
+	}
+	std::string model;
+	if(!archive.read("3D/3dmodel.model", model)) {
+		return "The 3D model can't be read.";
+	}
+
+	//Count the vertices and triangles of each object, and which vertices are unique.
+	size_t objects = 0;
+	for(size_t object_start = model.find("<object "); object_start != std::string::npos; object_start = model.find("<object ", object_start + 1)) {
+		objects++;
+		const size_t object_end = model.find("</object>", object_start);
+		size_t vertices = 0;
+		std::set<std::string> unique_vertices;
+		for(size_t vertex = model.find("<vertex ", object_start); vertex < object_end; vertex = model.find("<vertex ", vertex + 1)) {
+			vertices++;
+			unique_vertices.insert(model.substr(vertex, model.find("/>", vertex) - vertex));
+		}
+		size_t triangles = 0;
+		for(size_t triangle = model.find("<triangle ", object_start); triangle < object_end; triangle = model.find("<triangle ", triangle + 1)) {
+			triangles++;
+		}
+		if(vertices != expected.vertices_per_object || unique_vertices.size() != vertices) {
+			return "Object " + std::to_string(objects) + " has " + std::to_string(vertices) + " vertices of which " + std::to_string(unique_vertices.size()) + " unique, but should have " + std::to_string(expected.vertices_per_object) + " unique vertices.";
+		}
+		if(triangles != expected.triangles_per_object) {
+			return "Object " + std::to_string(objects) + " has " + std::to_string(triangles) + " triangles, but should have " + std::to_string(expected.triangles_per_object) + ".";
+		}
+	}
+	if(objects != expected.objects) {
+		return "The 3D model has " + std::to_string(objects) + " objects, but should have " + std::to_string(expected.objects) + ".";
+	}
+	return "";
+}
+
+/*!
+ * Write an OBJ file with so many triangles that its 3D model is larger than
+ * 4GB, which needs ZIP64 extensions in the 3MF file.
+ *
+ * The triangles all use the same few vertices, so that the faces can be
+ * streamed with little memory, and so that the file is as small as possible
+ * for the number of triangles it has.
+ * \param filename The file to write.
+ * \param triangles The number of triangles to write.
+ */
+void write_obj_zip64(const std::string& filename, const size_t triangles) {
+	std::ofstream file(filename);
+	file << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n";
+	const std::string faces = "f 1 2 3\nf 1 3 4\n"; //Both lines are equally long, so any number of triangles is a prefix of the block.
+	const size_t face_size = faces.size() / 2;
+	constexpr size_t block_size = 65536 * 2; //In triangles.
+	std::string block; //Write many faces at once, since this is a big file.
+	for(size_t repeat = 0; repeat < block_size / 2; ++repeat) {
+		block += faces;
+	}
+	for(size_t written = 0; written < triangles;) {
+		const size_t block_triangles = std::min(triangles - written, block_size); //The last block may have an odd number of triangles.
+		file.write(block.data(), block_triangles * face_size);
+		written += block_triangles;
+	}
+}
+
+/*!
+ * Check whether a 3MF file with a 3D model larger than 4GB is correct.
+ *
+ * The 3D model is read in pieces, so it doesn't need to fit in memory.
+ * \param filename The 3MF file to check.
+ * \param triangles How many triangles the 3D model must contain.
+ * \return An empty string if the file is correct, or a description of what is
+ * wrong.
+ */
+std::string verify_zip64(const std::string& filename, const size_t triangles) {
+	const convertto3mf::ZipReader archive(filename);
+	if(!archive.is_valid()) {
+		return "The 3MF file can't be opened.";
+	}
+	const convertto3mf::ZipReader::Entry* model = archive.find("3D/3dmodel.model");
+	if(!model) {
+		return "The 3MF file contains no 3D model.";
+	}
+	if(model->uncompressed_size <= 0xFFFFFFFF) {
+		return "The 3D model is only " + std::to_string(model->uncompressed_size) + " bytes, so it doesn't need ZIP64 extensions.";
+	}
+
+	//Count the triangles, also where they are split over two pieces.
+	const std::string needle = "<triangle ";
+	std::string carry; //The end of the previous piece, which may contain the start of a triangle.
+	size_t found = 0;
+	const bool complete = archive.read(*model, [&needle, &carry, &found](const char* data, const size_t size) {
+		const std::string piece = carry + std::string(data, std::min(size, needle.size() - 1));
+		for(size_t position = piece.find(needle); position != std::string::npos; position = piece.find(needle, position + 1)) {
+			found++;
+		}
+		const char* end = data + size;
+		for(const char* position = data; (position = std::search(position, end, needle.begin(), needle.end())) != end; ++position) {
+			found++;
+		}
+		carry.append(data + size - std::min(size, needle.size() - 1), std::min(size, needle.size() - 1));
+		carry.erase(0, carry.size() - std::min(carry.size(), needle.size() - 1));
+	});
+	if(!complete) {
+		return "The 3D model can't be read, or doesn't match its size or CRC-32.";
+	}
+	if(found != triangles) {
+		return "The 3D model has " + std::to_string(found) + " triangles, but should have " + std::to_string(triangles) + ".";
+	}
+	return "";
+}
+
+/*!
+ * Fit the coefficients of the estimator for one format to the measured
+ * conversions, and print them.
+ *
+ * The fixed memory and time are those of the smallest conversion, which are
+ * mostly the cost of starting the application. The memory and time per
+ * triangle are then fitted with least squares through that point. The memory
+ * per byte isn't fitted, since it follows from how the importer reads files.
+ * \param name The name of the coefficients in the estimator.
+ * \param file_type The format that was converted.
+ * \param streaming Whether the faces of OBJ files were streamed.
+ * \param samples The measured conversions of that format.
+ */
+void fit_coefficients(const std::string& name, const convertto3mf::FileType file_type, const bool streaming, const std::vector<CalibrationSample>& samples) {
+	convertto3mf::Estimate::Coefficients coefficients = convertto3mf::Estimate::coefficients(file_type, streaming);
+	coefficients.memory_fixed = samples[0].peak_memory;
+	coefficients.seconds_fixed = samples[0].seconds;
+	for(const CalibrationSample& sample : samples) {
+		coefficients.memory_fixed = std::min(coefficients.memory_fixed, sample.peak_memory);
+		coefficients.seconds_fixed = std::min(coefficients.seconds_fixed, sample.seconds);
+	}
+	double memory_covariance = 0;
+	double seconds_covariance = 0;
+	double variance = 0;
+	for(const CalibrationSample& sample : samples) {
+		const double triangles = sample.triangles;
+		memory_covariance += triangles * (sample.peak_memory - coefficients.memory_per_byte * sample.bytes - coefficients.memory_fixed);
+		seconds_covariance += triangles * (sample.seconds - coefficients.seconds_fixed);
+		variance += triangles * triangles;
+	}
+	coefficients.memory_per_triangle = memory_covariance / variance;
+	coefficients.seconds_per_triangle = seconds_covariance / variance;
+	std::cout << "static const Coefficients " << name << " = {" << coefficients.memory_fixed << ", " << coefficients.memory_per_byte << ", " << coefficients.memory_per_triangle << ", " << coefficients.seconds_fixed << ", " << coefficients.seconds_per_triangle << "};" << std::endl;
+}
+
+/*!
+ * Read the stored baseline.
+ * \param filename The file containing the baseline.
+ * \return For each file in the corpus, the measurement it had in the baseline.
+ * Files without a baseline are not included.
+ */
+std::map<std::string, Measurement> read_baseline(const std::string& filename) {
+	std::map<std::string, Measurement> baseline;
+	std::ifstream file(filename);
+	for(std::string line; std::getline(file, line);) {
+		if(line.empty() || line[0] == '#') {
+			continue;
+		}
+		std::istringstream fields(line);
+		std::string name;
+		Measurement measurement;
+		if(fields >> name >> measurement.throughput >> measurement.peak_rss) {
+			baseline[name] = measurement;
+		}
+	}
+	return baseline;
+}
+
+/*!
+ * Store a new baseline.
+ * \param filename The file to store the baseline in.
+ * \param measurements For each file in the corpus, the measurement to store.
+ */
+void write_baseline(const std::string& filename, const std::map<std::string, Measurement>& measurements) {
+	std::ofstream file(filename);
+	file << "#File, throughput in MB/s, peak memory usage in kB.\n";
+	for(const std::pair<const std::string, Measurement>& measurement : measurements) {
+		file << measurement.first << " " << measurement.second.throughput << " " << measurement.second.peak_rss << "\n";
+	}
+}
+
+}
+
+/*!
+ * Convert a generated corpus of files end-to-end with the command line
+ * application, and check the results and the performance.
+ *
+ * The corpus contains binary and ASCII STL files, OBJ files with quads and
+ * negative indices, and an ASCII STL file with multiple solids, from tiny to
+ * very large. Each file is converted a few times. The resulting 3MF files must
+ * contain the correct number of objects, unique vertices and triangles.
+ *
+ * The best throughput and peak memory usage of each file are compared to a
+ * stored baseline. If the throughput dropped or the memory usage grew by more
+ * than the threshold, this fails. Files that are not in the baseline yet are
+ * added to it, so that the next runs are compared to them.
+ *
+ * Arguments:
+ * * The command line application to test.
+ * * A directory to generate the corpus in.
+ * * The file containing the baseline.
+ * * Optionally `--update-baseline` to store the results as the new baseline.
+ * * Optionally `--threshold=fraction` to change the allowed regression. By
+ * default, 25% regression is allowed.
+ * * Optionally `--scale=factor` to make all files larger or smaller.
+ * * Optionally `--calibrate` to fit the coefficients of the estimator to the
+ * measured conversions, instead of checking them. The OBJ files are then also
+ * converted with their faces streamed.
+ * * Optionally `--zip64` to convert a model with a 3D model larger than 4GB
+ * instead, with its faces streamed. This checks that the 3MF file has ZIP64
+ * extensions and the correct number of triangles, and that the conversion
+ * stays below a fixed peak memory usage.
+ */
+int main(int argc, char** argv) {
+	if(argc < 4) {
+		std::cerr << "Usage: benchmark_end_to_end executable corpus_directory baseline_file [--update-baseline] [--threshold=fraction] [--scale=factor] [--calibrate] [--zip64] [--batch]" << std::endl;
+		return 2;
+	}
+	const std::string executable = argv[1];
+	const std::string directory = argv[2];
+	const std::string baseline_filename = argv[3];
+	bool update_baseline = false;
+	bool calibrate = false;
+	bool zip64 = false;
+	bool batch = false;
+	double threshold = 0.25;
+	double scale = 1.0;
+	for(int i = 4; i < argc; ++i) {
+		const std::string argument = argv[i];
+		if(argument == "--update-baseline") {
+			update_baseline = true;
+		} else if(argument.find("--threshold=") == 0) {
+			threshold = strtod(argument.substr(12).c_str(), nullptr);
+		} else if(argument.find("--scale=") == 0) {
+			scale = strtod(argument.substr(8).c_str(), nullptr);
+		} else if(argument == "--calibrate") {
+			calibrate = true;
+		} else if(argument == "--zip64") {
+			zip64 = true;
+		} else if(argument == "--batch") {
+			batch = true;
+		}
+	}
+	constexpr size_t repeats = 3;
+
+	//Generate the corpus.
+	mkdir(directory.c_str(), 0755);
+	if(zip64) {
+		constexpr size_t triangles = 140000000; //About 4.6GB of triangles in the 3D model.
+		const std::string input = directory + "/obj_zip64.obj";
+		const std::string output = directory + "/obj_zip64.3mf";
+		write_obj_zip64(input, triangles);
+		struct stat input_status;
+		stat(input.c_str(), &input_status);
+		const long max_peak_rss = input_status.st_size / 1024 + 256 * 1024; //The input is mapped into memory, which counts as well. Apart from that, the faces are streamed, so this should stay far below the size of the 3D model.
+		long peak_rss = 0;
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		const bool converted = run_conversion(executable, input, output, peak_rss, "--stream");
+		const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		remove(input.c_str()); //Don't leave gigabytes of corpus behind.
+		const std::string problem = converted ? verify_zip64(output, triangles) : "The conversion failed.";
+		remove(output.c_str());
+		if(!problem.empty()) {
+			std::cout << "obj_zip64: INCORRECT! " << problem << std::endl;
+			return 1;
+		}
+		std::cout << "obj_zip64: " << duration << " s, " << peak_rss << " kB peak memory.";
+		if(peak_rss > max_peak_rss) {
+			std::cout << " MEMORY USAGE ABOVE " << max_peak_rss << " kB!" << std::endl;
+			return 1;
+		}
+		std::cout << std::endl;
+		return 0;
+	}
+	if(batch) {
+		//A file that fails in an unusual way must not stop the batch from converting the next file.
+		const std::string output_directory = directory + "/batch";
+		mkdir(output_directory.c_str(), 0755);
+		const std::string journal = output_directory + "/journal.txt";
+		remove(journal.c_str()); //Convert everything again, rather than skipping what a previous run converted.
+		const std::string oversized = directory + "/ply_oversized.ply";
+		write_ply_oversized(oversized);
+		constexpr size_t grid = 10;
+		const CorpusFile good = {"stl_binary_after_failure", "stl_binary_after_failure.stl", 1, (grid + 1) * (grid + 1), grid * grid * 2};
+		write_stl_binary(directory + "/" + good.filename, grid);
+		const std::string good_output = output_directory + "/stl_binary_after_failure.3mf";
+		remove(good_output.c_str());
+		std::string problem;
+		if(!run_batch(executable, {oversized, directory + "/" + good.filename}, output_directory, journal)) {
+			problem = "The batch stopped before the end.";
+		} else {
+			struct stat output_status;
+			if(stat((output_directory + "/ply_oversized.3mf").c_str(), &output_status) == 0) {
+				problem = "The file that failed got a 3MF file.";
+			} else {
+				problem = verify(good_output, good);
+			}
+		}
+		if(!problem.empty()) {
+			std::cout << "batch: INCORRECT! " << problem << std::endl;
+			return 1;
+		}
+		std::cout << "batch: The next file was converted after a file failed." << std::endl;
+		return 0;
+	}
+	const auto scaled = [scale](const size_t size) {
+		return std::max(size_t(1), size_t(size * scale));
+	};
+	std::vector<CorpusFile> corpus;
+	for(const std::pair<const char*, size_t>& size : std::vector<std::pair<const char*, size_t>>{{"tiny", 1}, {"small", scaled(50)}, {"medium", scaled(300)}, {"large", scaled(1000)}}) {
+		const size_t grid = size.second;
+		const size_t vertices = (grid + 1) * (grid + 1);
+		const size_t triangles = grid * grid * 2;
+		corpus.push_back({std::string("stl_binary_") + size.first, std::string("stl_binary_") + size.first + ".stl", 1, vertices, triangles});
+		write_stl_binary(directory + "/" + corpus.back().filename, grid);
+		if(grid <= scaled(300)) { //ASCII files are much bigger, so limit their size somewhat.
+			corpus.push_back({std::string("stl_ascii_") + size.first, std::string("stl_ascii_") + size.first + ".stl", 1, vertices, triangles});
+			write_stl_ascii(directory + "/" + corpus.back().filename, grid, 1);
+		}
+		corpus.push_back({std::string("obj_") + size.first, std::string("obj_") + size.first + ".obj", 1, vertices, triangles});
+		write_obj(directory + "/" + corpus.back().filename, grid);
+	}
+	corpus.push_back({"stl_ascii_multiple_solids", "stl_ascii_multiple_solids.stl", 8, (scaled(100) + 1) * (scaled(100) + 1), scaled(100) * scaled(100) * 2});
+	write_stl_ascii(directory + "/" + corpus.back().filename, scaled(100), 8);
+
+	if(calibrate) {
+		//Measure each file in each mode that the estimator has coefficients for.
+		std::map<std::string, std::vector<CalibrationSample>> samples;
+		for(const CorpusFile& file : corpus) {
+			const std::string input = directory + "/" + file.filename;
+			const std::string output = directory + "/" + file.name + ".3mf";
+			struct stat input_status;
+			stat(input.c_str(), &input_status);
+			const std::string format = (file.name.find("obj_") == 0) ? "obj" : file.name.substr(0, file.name.find('_', 4)); //obj, stl_ascii or stl_binary.
+			for(const std::string& mode : (format == "obj") ? std::vector<std::string>{"", "--stream"} : std::vector<std::string>{""}) {
+				CalibrationSample best = {size_t(input_status.st_size), file.objects * file.triangles_per_object, 0, 0};
+				for(size_t repeat = 0; repeat < repeats; ++repeat) {
+					long peak_rss = 0;
+					const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					if(!run_conversion(executable, input, output, peak_rss, mode)) {
+						std::cout << file.name << ": The conversion failed." << std::endl;
+						return 1;
+					}
+					const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					best.seconds = (repeat == 0) ? duration : std::min(best.seconds, duration);
+					best.peak_memory = (repeat == 0) ? peak_rss * 1024.0 : std::min(best.peak_memory, peak_rss * 1024.0);
+				}
+				std::cout << file.name << mode << ": " << best.triangles << " triangles, " << best.seconds << " s, " << best.peak_memory << " bytes peak memory." << std::endl;
+				samples[mode.empty() ? format : format + "_streaming"].push_back(best);
+			}
+		}
+		fit_coefficients("obj", convertto3mf::FileType::OBJ, false, samples["obj"]);
+		fit_coefficients("obj_streaming", convertto3mf::FileType::OBJ, true, samples["obj_streaming"]);
+		fit_coefficients("stl_binary", convertto3mf::FileType::STL_BINARY, false, samples["stl_binary"]);
+		fit_coefficients("stl_ascii", convertto3mf::FileType::STL_ASCII, false, samples["stl_ascii"]);
+		return 0;
+	}
+
+	//Convert each file, check the result, and measure the performance.
+	const std::map<std::string, Measurement> baseline = read_baseline(baseline_filename);
+	std::map<std::string, Measurement> measurements;
+	std::map<std::string, Measurement> recorded = baseline; //The baseline, plus the files that weren't in it yet.
+	bool success = true;
+	for(const CorpusFile& file : corpus) {
+		const std::string input = directory + "/" + file.filename;
+		const std::string output = directory + "/" + file.name + ".3mf";
+		struct stat input_status;
+		stat(input.c_str(), &input_status);
+		const double megabytes = input_status.st_size / 1e6;
+
+		Measurement best = {0, 0};
+		std::string problem;
+		for(size_t repeat = 0; repeat < repeats && problem.empty(); ++repeat) {
+			long peak_rss = 0;
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if(!run_conversion(executable, input, output, peak_rss)) {
+				problem = "The conversion failed.";
+				break;
+			}
+			const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			best.throughput = std::max(best.throughput, megabytes / duration);
+			best.peak_rss = (repeat == 0) ? peak_rss : std::min(best.peak_rss, peak_rss);
+			problem = verify(output, file);
+		}
+		if(!problem.empty()) {
+			std::cout << file.name << ": INCORRECT! " << problem << std::endl;
+			success = false;
+			continue;
+		}
+		measurements[file.name] = best;
+
+		std::cout << file.name << ": " << best.throughput << " MB/s, " << best.peak_rss << " kB peak memory.";
+		const std::map<std::string, Measurement>::const_iterator reference = baseline.find(file.name);
+		if(reference == baseline.end()) { //This becomes the baseline to compare to in the next runs.
+			std::cout << " No baseline. Recorded this as the baseline." << std::endl;
+			recorded[file.name] = best;
+			continue;
+		}
+		std::cout << " Baseline: " << reference->second.throughput << " MB/s, " << reference->second.peak_rss << " kB.";
+		if(best.throughput < reference->second.throughput * (1.0 - threshold)) {
+			std::cout << " THROUGHPUT REGRESSED!";
+			success = false;
+		}
+		if(best.peak_rss > reference->second.peak_rss * (1.0 + threshold)) {
+			std::cout << " MEMORY USAGE REGRESSED!";
+			success = false;
+		}
+		std::cout << std::endl;
+	}
+
+	if(update_baseline) {
+		write_baseline(baseline_filename, measurements);
+		std::cout << "Stored the results as the new baseline in " << baseline_filename << std::endl;
+	} else if(recorded.size() > baseline.size()) {
+		write_baseline(baseline_filename, recorded);
+		std::cout << "Recorded the missing baselines in " << baseline_filename << std::endl;
+	}
+	return success ? 0 : 1;
+}
\ No newline at end of file
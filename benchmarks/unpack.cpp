@@ -0,0 +1,70 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <chrono> //To time the implementations.
+#include <cstdlib> //To parse the number of triangles from the arguments.
+#include <cstring> //To write floats into the records with memcpy.
+#include <initializer_list> //To iterate over all implementations.
+#include <iostream> //To report the results.
+#include <random> //To generate random coordinates.
+#include <vector> //To store the records and the unpacked coordinates.
+
+#include "unpack.hpp" //The implementations to compare.
+
+/*!
+ * Compare the implementations of unpacking triangles from binary STL records.
+ *
+ * Each implementation that the processor supports unpacks the same random
+ * records a number of times. The fastest run is reported, along with whether
+ * the result is identical to that of the scalar implementation.
+ *
+ * The number of triangles can be given as argument. By default, this uses a
+ * million triangles.
+ */
+int main(int argc, char** argv) {
+	using convertto3mf::Unpack;
+	const size_t num_triangles = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000;
+	constexpr size_t stride = 50; //The size of a binary STL record.
+	constexpr size_t repeats = 10;
+
+	//Generate records with random coordinates. The normal and attribute bytes are left zero.
+	std::vector<char> records(num_triangles * stride, 0);
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> distribution(-1000, 1000);
+	for(size_t triangle = 0; triangle < num_triangles; ++triangle) {
+		for(size_t coordinate = 0; coordinate < 9; ++coordinate) {
+			const float value = distribution(generator);
+			memcpy(records.data() + triangle * stride + 12 + coordinate * sizeof(float), &value, sizeof(value));
+		}
+	}
+
+	std::vector<convertto3mf::coord_t> expected(num_triangles * 9);
+	Unpack::unpack_triangles(Unpack::Instructions::SCALAR, records.data() + 12, stride, num_triangles, expected.data());
+
+	std::cout << "Unpacking " << num_triangles << " triangles. Automatically chosen: " << Unpack::name(Unpack::best_supported()) << std::endl;
+	for(const Unpack::Instructions instructions : {Unpack::Instructions::SCALAR, Unpack::Instructions::SSE2, Unpack::Instructions::AVX2, Unpack::Instructions::AVX512}) {
+		if(!Unpack::is_supported(instructions)) {
+			std::cout << Unpack::name(instructions) << ": not supported by this processor." << std::endl;
+			continue;
+		}
+		std::vector<convertto3mf::coord_t> output(num_triangles * 9);
+		double fastest = -1; //In seconds.
+		for(size_t repeat = 0; repeat < repeats; ++repeat) {
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			Unpack::unpack_triangles(instructions, records.data() + 12, stride, num_triangles, output.data());
+			const double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if(fastest < 0 || duration < fastest) {
+				fastest = duration;
+			}
+		}
+		const bool correct = output == expected;
+		std::cout << Unpack::name(instructions) << ": " << (fastest * 1e9 / num_triangles) << " ns per triangle, " << (num_triangles * stride / fastest / 1e9) << " GB/s of input. " << (correct ? "Correct." : "INCORRECT!") << std::endl;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <string> //To store file names.
+#include <vector> //To store the input file names.
+
+#include "options.hpp" //To store the settings for the conversions.
+
+namespace convertto3mf {
+
+/*!
+ * A batch of conversions: Each input file is converted to its own 3MF file.
+ *
+ * Completed conversions are recorded in a journal. If the batch gets
+ * interrupted, running it again skips the conversions that were completed
+ * already.
+ */
+class Batch {
+	public:
+		/*!
+		 * The input files to convert, each to their own 3MF file.
+		 */
+		std::vector<std::string> input_filenames;
+
+		/*!
+		 * The directory to store the resulting 3MF files in.
+		 *
+		 * If this is empty, each 3MF file is stored next to its input file.
+		 */
+		std::string output_directory;
+
+		/*!
+		 * The file that records which conversions were completed.
+		 */
+		std::string journal_filename;
+
+		/*!
+		 * The settings for how to convert the files.
+		 */
+		Options options;
+
+		/*!
+		 * How many input files ahead of the current conversion to load into
+		 * memory in the background.
+		 *
+		 * If this is 0, files are only read when they are converted.
+		 */
+		size_t prefetch;
+
+		/*!
+		 * Construct a new batch of conversions.
+		 */
+		Batch(const std::vector<std::string>& input_filenames, const std::string& output_directory, const std::string& journal_filename, const Options& options = Options());
+
+		/*!
+		 * Convert all files that weren't converted before.
+		 *
+		 * If multiple input files would be converted to the same 3MF file,
+		 * such as files with the same name in different directories when
+		 * storing all 3MF files in one output directory, only the first of
+		 * them is converted. The others are reported as failed, rather than
+		 * overwriting each other.
+		 * \return `true` if all conversions were done, or `false` if the
+		 * journal could not be opened or the batch was cancelled.
+		 */
+		bool run();
+
+		/*!
+		 * Get the file that an input file gets converted to.
+		 * \param input_filename The file to convert.
+		 * \param output_directory The directory to store the 3MF file in, or
+		 * empty to store it next to the input file.
+		 * \return The file name of the 3MF file.
+		 */
+		static std::string output_filename(const std::string& input_filename, const std::string& output_directory);
+};
+
+}
+
+#endif //BATCH_HPP
\ No newline at end of file
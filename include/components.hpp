@@ -0,0 +1,78 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef COMPONENTS_HPP
+#define COMPONENTS_HPP
+
+#include <array> //To store triangles.
+#include <atomic> //To merge sets of vertices from multiple threads.
+#include <vector> //To store lists of vertices and triangles.
+
+#include "point3.hpp" //To store the vertices of the components.
+
+namespace convertto3mf {
+
+/*!
+ * Collection of functions to split a mesh into its connected components.
+ *
+ * Two triangles are connected if they share a vertex. The vertices are grouped
+ * with a union-find structure that can be updated by multiple threads at the
+ * same time, so that this takes near-linear time, spread over all processors.
+ */
+class Components {
+public:
+	/*!
+	 * Split a mesh into its connected components.
+	 *
+	 * The components are ordered by the lowest index of their vertices. Within
+	 * each component, the vertices and triangles keep their original order.
+	 * Vertices that aren't used by any triangle are dropped.
+	 * \param vertices The vertices of the mesh to split.
+	 * \param triangles The triangles of the mesh to split, referring to the
+	 * vertices by their index.
+	 * \param component_vertices Output parameter for the vertices of each
+	 * component.
+	 * \param component_triangles Output parameter for the triangles of each
+	 * component, referring to the vertices of that component.
+	 */
+	static void split(const std::vector<Point3>& vertices, const std::vector<std::array<size_t, 3>>& triangles, std::vector<std::vector<Point3>>& component_vertices, std::vector<std::vector<std::array<size_t, 3>>>& component_triangles);
+
+protected:
+	/*!
+	 * The number of triangles that each thread processes at a time.
+	 */
+	static constexpr size_t batch_size = 65536;
+
+	/*!
+	 * Find the representative of the set that a vertex is in.
+	 *
+	 * This halves the path to the representative along the way, so that later
+	 * searches are faster.
+	 * \param parents For each vertex, the parent vertex in its set.
+	 * \param vertex The vertex to find the set of.
+	 * \return The representative of the set.
+	 */
+	static size_t find(std::vector<std::atomic<size_t>>& parents, size_t vertex);
+
+	/*!
+	 * Merge the sets that two vertices are in.
+	 *
+	 * The set with the higher representative is always linked to the set with
+	 * the lower representative. That way no cycles can form when multiple
+	 * threads are merging sets at the same time, and the representative of
+	 * each set ends up being its lowest vertex.
+	 * \param parents For each vertex, the parent vertex in its set.
+	 * \param a One of the vertices to merge.
+	 * \param b The other vertex to merge.
+	 */
+	static void unite(std::vector<std::atomic<size_t>>& parents, size_t a, size_t b);
+};
+
+}
+
+#endif //COMPONENTS_HPP
\ No newline at end of file
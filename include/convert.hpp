@@ -0,0 +1,72 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef CONVERT_HPP
+#define CONVERT_HPP
+
+#include <functional> //To write the result to a callback.
+#include <istream> //To import models from streams.
+#include <string> //To accept file names and return the result.
+
+#include "model.hpp" //To import models from memory.
+#include "options.hpp" //To change how the conversion is performed.
+
+namespace convertto3mf {
+
+/*!
+ * Read a 3D model from memory, detecting which file format it is in.
+ * \param data The contents of the file with the 3D model.
+ * \param size The number of bytes in the file.
+ * \param filename The name of the file, which helps to detect the file type.
+ * This may be empty if the name is unknown.
+ * \param monitor Optionally, a monitor to report the progress to, which can
+ * also cancel the import.
+ * \return The 3D model that was in the file.
+ */
+Model import_from_memory(const char* data, const size_t size, const std::string& filename = "", Monitor* monitor = nullptr);
+
+/*!
+ * Read a 3D model from a stream, detecting which file format it is in.
+ *
+ * The stream doesn't need to be able to seek, so this can read from pipes such
+ * as the standard input. The file type is detected from the start of the
+ * stream. Text formats are then read from the stream as it comes in, while
+ * binary formats are first read completely into memory.
+ * \param stream The stream to read the 3D model from.
+ * \param monitor Optionally, a monitor to report the progress to, which can
+ * also cancel the import.
+ * \return The 3D model that was in the stream.
+ */
+Model import_from_stream(std::istream& stream, Monitor* monitor = nullptr);
+
+/*!
+ * Convert a 3D model in memory to a 3MF file in memory.
+ * \param data The contents of the file with the 3D model to convert.
+ * \param size The number of bytes in the file.
+ * \param options Settings for how to convert the file.
+ * \param filename The name of the file, which helps to detect the file type.
+ * This may be empty if the name is unknown.
+ * \return The contents of the resulting 3MF file.
+ */
+std::string convert(const char* data, const size_t size, const Options& options = Options(), const std::string& filename = "");
+
+/*!
+ * Convert a 3D model in memory to a 3MF file, writing it to a callback.
+ * \param data The contents of the file with the 3D model to convert.
+ * \param size The number of bytes in the file.
+ * \param output A function that gets called with consecutive blocks of the
+ * resulting 3MF file, in order, until the whole file is written.
+ * \param options Settings for how to convert the file.
+ * \param filename The name of the file, which helps to detect the file type.
+ * This may be empty if the name is unknown.
+ */
+void convert(const char* data, const size_t size, const std::function<void(const char*, size_t)>& output, const Options& options = Options(), const std::string& filename = "");
+
+}
+
+#endif //CONVERT_HPP
\ No newline at end of file
@@ -0,0 +1,192 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef CONVERTTO3MF_H
+#define CONVERTTO3MF_H
+
+/*
+ * This is the C interface of the conversion library, to embed it in other
+ * applications. It converts 3D models in memory, without going through the
+ * file system.
+ */
+
+#include <stddef.h> /* For size_t. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * Settings for how to perform a conversion.
+ *
+ * The contents are hidden, so that new settings can be added without breaking
+ * compatibility. Use the functions below to create and change them.
+ */
+typedef struct convertto3mf_options convertto3mf_options;
+
+/*!
+ * The results that the conversion functions can return.
+ */
+enum convertto3mf_status {
+	CONVERTTO3MF_OK = 0, /*!< The conversion succeeded. */
+	CONVERTTO3MF_INVALID_ARGUMENT = 1, /*!< One of the parameters was invalid, such as a null pointer. */
+	CONVERTTO3MF_WRITE_FAILED = 2, /*!< The write callback reported an error. */
+	CONVERTTO3MF_OUT_OF_MEMORY = 3, /*!< There was not enough memory to perform the conversion. */
+	CONVERTTO3MF_INTERNAL_ERROR = 4 /*!< Something else went wrong during the conversion. */
+};
+
+/*!
+ * A function that receives the messages of a conversion, such as what it
+ * found.
+ *
+ * The conversion doesn't print anything itself. Failures are returned as a
+ * status instead. This is never called from multiple threads at the same time.
+ * \param message The message, without line break at the end. It may span
+ * multiple lines. It is only valid during this call.
+ * \param user_data The pointer that was given with the callback.
+ */
+typedef void (*convertto3mf_log_callback)(const char* message, void* user_data);
+
+/*!
+ * A function that receives the resulting 3MF file.
+ *
+ * This gets called with consecutive blocks of the file, in order, until the
+ * whole file is written.
+ * \param data The next block of the file.
+ * \param size The number of bytes in this block.
+ * \param user_data The pointer that was given to the conversion function.
+ * \return 0 if the block was written successfully, or any other value to abort
+ * the conversion.
+ */
+typedef int (*convertto3mf_write_callback)(const void* data, size_t size, void* user_data);
+
+/*!
+ * Create a new set of options, with the default settings.
+ * \return The new options, or a null pointer if there is not enough memory.
+ * These must be destroyed with `convertto3mf_options_destroy`.
+ */
+convertto3mf_options* convertto3mf_options_create(void);
+
+/*!
+ * Destroy a set of options that was created with
+ * `convertto3mf_options_create`.
+ * \param options The options to destroy.
+ */
+void convertto3mf_options_destroy(convertto3mf_options* options);
+
+/*!
+ * Set whether to write each mesh to its own model part in the archive.
+ * \param options The options to change.
+ * \param split_parts Non-zero to write meshes to separate parts.
+ * \param part_max_triangles The maximum number of triangles in one part, or 0
+ * to never split meshes over multiple parts.
+ */
+void convertto3mf_options_set_split_parts(convertto3mf_options* options, int split_parts, size_t part_max_triangles);
+
+/*!
+ * Set whether to reorder the vertices and triangles of each mesh for locality.
+ * \param options The options to change.
+ * \param reorder Non-zero to reorder the meshes.
+ */
+void convertto3mf_options_set_reorder(convertto3mf_options* options, int reorder);
+
+/*!
+ * Set whether to store meshes that are identical apart from their position only
+ * once, placing them multiple times in the build.
+ * \param options The options to change.
+ * \param instancing Non-zero to find copies of meshes.
+ */
+void convertto3mf_options_set_instancing(convertto3mf_options* options, int instancing);
+
+/*!
+ * Set whether to check the meshes for holes, flipped triangles, non-manifold
+ * edges and degenerate triangles. The problems found are reported to the log
+ * callback.
+ * \param options The options to change.
+ * \param validate Non-zero to check the meshes.
+ */
+void convertto3mf_options_set_validate(convertto3mf_options* options, int validate);
+
+/*!
+ * Set the maximum number of triangles to write. Meshes with more triangles are
+ * simplified until they fit.
+ * \param options The options to change.
+ * \param max_triangles The maximum number of triangles, or 0 to write all
+ * triangles.
+ */
+void convertto3mf_options_set_max_triangles(convertto3mf_options* options, size_t max_triangles);
+
+/*!
+ * Set whether to split each mesh into its connected components, writing each
+ * component as a separate object.
+ * \param options The options to change.
+ * \param split_components Non-zero to split meshes into their components.
+ */
+void convertto3mf_options_set_split_components(convertto3mf_options* options, int split_components);
+
+/*!
+ * Set how precisely to write coordinates.
+ * \param options The options to change.
+ * \param precision The number of significant digits to write coordinates
+ * with.
+ * \param quantize The size of the grid to snap coordinates to, in micrometres,
+ * or 0 to not snap them. Snapped coordinates are written exactly, regardless of
+ * the precision.
+ */
+void convertto3mf_options_set_precision(convertto3mf_options* options, size_t precision, double quantize);
+
+/*!
+ * Set a function to receive the messages of the conversion, such as the
+ * report of the validation. Without one, the conversion is silent.
+ * \param options The options to change.
+ * \param log The function to call with each message, or a null pointer to
+ * stay silent.
+ * \param user_data A pointer that is passed on to the log function.
+ */
+void convertto3mf_options_set_log(convertto3mf_options* options, convertto3mf_log_callback log, void* user_data);
+
+/*!
+ * Convert a 3D model in memory to 3MF, writing the result to a callback.
+ * \param input The contents of the file with the 3D model.
+ * \param input_size The number of bytes in the input.
+ * \param filename The name of the input file, which helps to detect the file
+ * type. This may be a null pointer if the name is unknown.
+ * \param options Settings for the conversion, or a null pointer to use the
+ * default settings.
+ * \param write The function to write the resulting 3MF file to.
+ * \param user_data A pointer that is passed on to the write function.
+ * \return One of the values of `convertto3mf_status`.
+ */
+int convertto3mf_convert(const void* input, size_t input_size, const char* filename, const convertto3mf_options* options, convertto3mf_write_callback write, void* user_data);
+
+/*!
+ * Convert a 3D model in memory to a 3MF file in memory.
+ * \param input The contents of the file with the 3D model.
+ * \param input_size The number of bytes in the input.
+ * \param filename The name of the input file, which helps to detect the file
+ * type. This may be a null pointer if the name is unknown.
+ * \param options Settings for the conversion, or a null pointer to use the
+ * default settings.
+ * \param output Receives a pointer to the resulting 3MF file. This must be
+ * freed with `convertto3mf_free`.
+ * \param output_size Receives the number of bytes in the resulting 3MF file.
+ * \return One of the values of `convertto3mf_status`.
+ */
+int convertto3mf_convert_to_buffer(const void* input, size_t input_size, const char* filename, const convertto3mf_options* options, void** output, size_t* output_size);
+
+/*!
+ * Free a buffer that was returned by `convertto3mf_convert_to_buffer`.
+ * \param buffer The buffer to free.
+ */
+void convertto3mf_free(void* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONVERTTO3MF_H */
\ No newline at end of file
@@ -19,18 +19,46 @@ namespace convertto3mf {
 enum FileType {
 	OBJ,
 	STL_BINARY,
-	STL_ASCII
+	STL_ASCII,
+	PLY,
+	GLB
 };
 
+/*!
+ * The number of bytes from the start of a file that are needed to detect its
+ * file type.
+ */
+constexpr size_t detection_sample_size = 1024;
+
+/*!
+ * Value for the file size when the size of a file is not known in advance, such
+ * as when reading from the standard input.
+ */
+constexpr size_t unknown_file_size = -1;
+
 /*!
  * Detects the most likely file type for a certain file.
  *
  * This calls upon each available file type to determine what the probability is
  * that it's that file type. Then it picks the type that reports the highest
  * probability.
+ * \param filename The path to the file to detect the type of.
  */
 FileType detect_file_type(const std::string& filename);
 
+/*!
+ * Detects the most likely file type for a file of which only the start is
+ * known.
+ *
+ * This is used for files that are not read from the file system. The file name
+ * is only used as hint for the file type.
+ * \param filename The name of the file, or an empty string if it is unknown.
+ * \param sample The first bytes of the file, up to 1kB.
+ * \param file_size The total size of the file, in bytes, or
+ * `unknown_file_size` if it is not known.
+ */
+FileType detect_file_type(const std::string& filename, const std::string& sample, const size_t file_size);
+
 }
 
 #endif //DETECT_FILE_TYPE_HPP
\ No newline at end of file
@@ -0,0 +1,184 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef ESTIMATE_HPP
+#define ESTIMATE_HPP
+
+#include <string> //To accept file names and produce JSON.
+
+#include "options.hpp" //To take the settings of the conversion into account.
+#include "probe.hpp" //To count the triangles in the input.
+
+namespace convertto3mf {
+
+/*!
+ * A prediction of how much memory and time converting a file will take, made
+ * before converting it.
+ *
+ * The file is probed to count its triangles. Large OBJ and STL files are only
+ * sampled: A few pieces spread over the file are probed, and the counts are
+ * scaled up to the size of the file. The peak memory usage and the duration
+ * are then predicted with a linear model for the format of the file. The
+ * coefficients of these models are calibrated with the end-to-end benchmark.
+ */
+class Estimate {
+	public:
+	/*!
+	 * The coefficients of the model of one format.
+	 *
+	 * The peak memory usage is predicted as a fixed amount, plus an amount per
+	 * byte of input and per triangle. The duration is predicted as a fixed
+	 * time plus a time per triangle.
+	 */
+	struct Coefficients {
+		/*!
+		 * The memory used by any conversion, in bytes.
+		 */
+		double memory_fixed;
+
+		/*!
+		 * The memory used for each byte of the input file, in bytes.
+		 *
+		 * This is how often the input is held in memory at the same time,
+		 * which follows from how the importer reads the file. It is not
+		 * calibrated.
+		 */
+		double memory_per_byte;
+
+		/*!
+		 * The memory used for each triangle, in bytes.
+		 */
+		double memory_per_triangle;
+
+		/*!
+		 * The time taken by any conversion, in seconds.
+		 */
+		double seconds_fixed;
+
+		/*!
+		 * The time taken for each triangle, in seconds.
+		 */
+		double seconds_per_triangle;
+	};
+
+	/*!
+	 * OBJ and STL files larger than this are sampled instead of probed
+	 * completely.
+	 */
+	static constexpr size_t sample_threshold = 64 * 1024 * 1024;
+
+	/*!
+	 * The number of pieces to probe when sampling a file.
+	 */
+	static constexpr size_t num_samples = 64;
+
+	/*!
+	 * The size of each piece to probe when sampling a file, in bytes.
+	 */
+	static constexpr size_t sample_size = 256 * 1024;
+
+	/*!
+	 * The numbers found in the input file.
+	 *
+	 * If the file was sampled, the numbers of triangles and vertices are
+	 * extrapolated, and the bounding box only covers the samples.
+	 */
+	Probe probe;
+
+	/*!
+	 * Whether the file was only sampled, rather than probed completely.
+	 */
+	bool sampled = false;
+
+	/*!
+	 * Whether the faces of OBJ files will be streamed, which takes less
+	 * memory.
+	 */
+	bool streaming = false;
+
+	/*!
+	 * The predicted peak memory usage of the conversion, in bytes.
+	 */
+	size_t peak_memory = 0;
+
+	/*!
+	 * The predicted duration of the conversion, in seconds.
+	 */
+	double duration = 0;
+
+	/*!
+	 * Predict how much memory and time converting a file on the file system
+	 * will take.
+	 * \param filename The file to convert.
+	 * \param options The settings for the conversion.
+	 * \return The prediction for that file.
+	 */
+	static Estimate estimate(const std::string& filename, const Options& options);
+
+	/*!
+	 * Predict how much memory and time converting a file in memory will take.
+	 * \param data The contents of the file.
+	 * \param size The number of bytes in the file.
+	 * \param filename The name of the file, which helps to detect the file
+	 * type. This may be empty if the name is unknown.
+	 * \param options The settings for the conversion.
+	 * \return The prediction for that file.
+	 */
+	static Estimate estimate(const char* data, const size_t size, const std::string& filename, const Options& options);
+
+	/*!
+	 * Get the coefficients of the model of a format.
+	 * \param file_type The format of the input file.
+	 * \param streaming Whether the faces of OBJ files are streamed.
+	 * \return The coefficients for that format.
+	 */
+	static const Coefficients& coefficients(const FileType file_type, const bool streaming);
+
+	/*!
+	 * Predict the peak memory usage and the duration from the probe.
+	 *
+	 * This can be called again to predict them for other settings, without
+	 * probing the file again.
+	 * \param options The settings for the conversion.
+	 */
+	void predict(const Options& options);
+
+	/*!
+	 * Add the prediction of another file that is converted along with this
+	 * one.
+	 *
+	 * All input files are imported at the same time, so the memory and time
+	 * add up.
+	 * \param other The prediction for the other file.
+	 */
+	void include(const Estimate& other);
+
+	/*!
+	 * Describe the estimate as a JSON object on a single line.
+	 * \param filename The name of the file that was estimated.
+	 * \return The JSON object of the probe, with whether the file was sampled,
+	 * the predicted peak memory usage in bytes and the predicted duration in
+	 * seconds added to it.
+	 */
+	std::string to_json(const std::string& filename) const;
+
+	protected:
+	/*!
+	 * Probe pieces spread evenly over a large file, and scale the numbers up to
+	 * the size of the whole file.
+	 * \param data The contents of the file.
+	 * \param size The number of bytes in the file.
+	 * \param result The probe to store the numbers in. Its file type must
+	 * already be set.
+	 */
+	static void sample(const char* data, const size_t size, Probe& result);
+};
+
+}
+
+#endif //ESTIMATE_HPP
\ No newline at end of file
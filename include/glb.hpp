@@ -0,0 +1,245 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef GLB_HPP
+#define GLB_HPP
+
+#include <array> //To store transformation matrices.
+#include <string> //To accept filenames.
+#include <vector> //To store the meshes to place in the model.
+
+#include "json.hpp" //To read the description of the scene.
+#include "model.hpp" //To construct 3D models from the file.
+#include "monitor.hpp" //To report progress while importing.
+#include "probe.hpp" //To summarise files without converting them.
+
+namespace convertto3mf {
+
+/*!
+ * Collection of functions for handling binary glTF (GLB) files.
+ *
+ * A GLB file consists of a JSON document that describes the scene, followed by
+ * a binary buffer. The vertices and indices of the meshes are stored in that
+ * buffer as tightly packed arrays, which are read directly from the file mapped
+ * into memory.
+ *
+ * Each node of the default scene that refers to a mesh becomes a mesh in the
+ * model, transformed to its place in the scene. Meshes that are placed by
+ * multiple nodes are included once for each of them.
+ */
+class Glb {
+	public:
+	/*!
+	 * Determines the likelihood of this file being a GLB file.
+	 * \param filename The name of the file to check. This may be empty if the
+	 * name of the file is unknown.
+	 * \param sample The first bytes of the file, up to 1kB.
+	 * \return The likelihood of this file being a GLB file. This is a rather
+	 * arbitrary guess of probability between 0 and 1.
+	 */
+	static float is_glb(const std::string& filename, const std::string& sample);
+
+	/*!
+	 * Read a GLB file, storing it in memory as a `Model` instance.
+	 * \param filename The GLB file to read.
+	 * \param monitor Reports how far the import got, and aborts it if the
+	 * conversion is cancelled. This may be `nullptr`.
+	 */
+	static Model import(const std::string& filename, Monitor* monitor = nullptr);
+
+	/*!
+	 * Read a GLB file from memory, storing it as a `Model` instance.
+	 * \param data The contents of the GLB file.
+	 * \param size The number of bytes in the GLB file.
+	 * \param monitor Reports how far the import got, and aborts it if the
+	 * conversion is cancelled. This may be `nullptr`.
+	 */
+	static Model import(const char* data, const size_t size, Monitor* monitor = nullptr);
+
+	/*!
+	 * Find the number of triangles and vertices and the bounding box of a GLB
+	 * file in memory, without building a model.
+	 *
+	 * Only the JSON document is read. It states the number of vertices and
+	 * indices of each primitive, and the bounds of their vertices.
+	 * \param data The contents of the GLB file.
+	 * \param size The number of bytes in the GLB file.
+	 * \param result The probe to store the numbers in.
+	 */
+	static void probe(const char* data, const size_t size, Probe& result);
+
+	protected:
+	/*!
+	 * A transformation, as a 4x4 matrix stored in column-major order, like
+	 * glTF stores them.
+	 */
+	typedef std::array<double, 16> Matrix;
+
+	/*!
+	 * A mesh placed in the scene by a node.
+	 */
+	struct Instance {
+		/*!
+		 * The index of the mesh in the glTF document.
+		 */
+		size_t mesh_index;
+
+		/*!
+		 * Where the mesh is placed, combining the transformations of the node
+		 * and all of its parents.
+		 */
+		Matrix transformation;
+
+		/*!
+		 * A name for the mesh in the model: The name of the node, or of the
+		 * mesh if the node has no name.
+		 */
+		std::string name;
+	};
+
+	/*!
+	 * A typed array in the binary buffer, as described by an accessor.
+	 */
+	struct Accessor {
+		/*!
+		 * Where the first element starts.
+		 */
+		const char* start;
+
+		/*!
+		 * The number of elements.
+		 */
+		size_t count;
+
+		/*!
+		 * The distance between the starts of two elements, in bytes.
+		 */
+		size_t stride;
+
+		/*!
+		 * The glTF component type of the elements, e.g. 5126 for 32-bit floats.
+		 */
+		size_t component_type;
+	};
+
+	/*!
+	 * The glTF component type of unsigned bytes.
+	 */
+	static constexpr size_t unsigned_byte = 5121;
+
+	/*!
+	 * The glTF component type of unsigned 16-bit integers.
+	 */
+	static constexpr size_t unsigned_short = 5123;
+
+	/*!
+	 * The glTF component type of unsigned 32-bit integers.
+	 */
+	static constexpr size_t unsigned_int = 5125;
+
+	/*!
+	 * The glTF component type of 32-bit floats.
+	 */
+	static constexpr size_t float32 = 5126;
+
+	/*!
+	 * Reports how far the import got, and aborts it if the conversion is
+	 * cancelled, or `nullptr` if nothing needs to be reported.
+	 */
+	Monitor* monitor = nullptr;
+
+	/*!
+	 * The JSON document describing the scene.
+	 */
+	Json document;
+
+	/*!
+	 * The binary buffer with the vertices and indices, within the file.
+	 */
+	const char* binary = nullptr;
+
+	/*!
+	 * The number of bytes in the binary buffer.
+	 */
+	size_t binary_size = 0;
+
+	/*!
+	 * The meshes placed in the scene.
+	 */
+	std::vector<Instance> instances;
+
+	/*!
+	 * Read the header and the chunks of the file.
+	 * \param data The contents of the file.
+	 * \param size The number of bytes in the file.
+	 * \return `true` if the file has a valid header and JSON document, or
+	 * `false` if it's not a valid GLB file.
+	 */
+	bool load_chunks(const char* data, const size_t size);
+
+	/*!
+	 * Find all meshes placed in the default scene.
+	 */
+	void find_instances();
+
+	/*!
+	 * Find the meshes placed by a node and its children.
+	 * \param node_index The index of the node in the glTF document.
+	 * \param parent The transformation of the parent of the node.
+	 * \param depth How many parents the node has. This protects against
+	 * nodes that are their own ancestor.
+	 */
+	void add_node(const size_t node_index, const Matrix& parent, const size_t depth);
+
+	/*!
+	 * Find where a typed array is stored in the binary buffer.
+	 * \param accessor_index The index of the accessor in the glTF document.
+	 * \param num_components The number of components in each element, such as
+	 * 3 for vectors or 1 for scalars.
+	 * \param accessor The location of the array is stored here.
+	 * \return `true` if the array is stored in the binary buffer, or `false` if
+	 * it doesn't exist, doesn't fit in the buffer or is stored elsewhere.
+	 */
+	bool find_accessor(const size_t accessor_index, const size_t num_components, Accessor& accessor) const;
+
+	/*!
+	 * Add the triangles of a primitive of a mesh to a mesh in the model.
+	 * \param primitive The primitive in the glTF document.
+	 * \param transformation The transformation to apply to the vertices.
+	 * \param mesh The mesh to add the vertices and triangles to.
+	 */
+	void add_primitive(const Json& primitive, const Matrix& transformation, Mesh& mesh) const;
+
+	/*!
+	 * Convert the GLB-specific representation into the common 3D model
+	 * representation.
+	 */
+	Model to_model() const;
+
+	/*!
+	 * Get the transformation of a node relative to its parent.
+	 * \param node The node in the glTF document.
+	 * \return The transformation of that node, either from its matrix or from
+	 * its translation, rotation and scale.
+	 */
+	static Matrix node_transformation(const Json& node);
+
+	/*!
+	 * Combine two transformations.
+	 * \param first The transformation that is applied last, such as that of
+	 * the parent.
+	 * \param second The transformation that is applied first, such as that of
+	 * the child.
+	 * \return The combined transformation.
+	 */
+	static Matrix multiply(const Matrix& first, const Matrix& second);
+};
+
+}
+
+#endif //GLB_HPP
\ No newline at end of file
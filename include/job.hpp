@@ -9,32 +9,86 @@
 #ifndef JOB_HPP
 #define JOB_HPP
 
+#include <string> //To store file names.
+#include <vector> //To store multiple input file names.
+
+#include "model.hpp" //To return imported models.
+#include "options.hpp" //To store the settings for the conversion.
+
 namespace convertto3mf {
 
 /*!
- * This class represents a conversion job: One file that needs to be converted.
+ * This class represents a conversion job: One or more files that need to be
+ * converted into a single 3MF file.
  */
 class Job {
 	public:
 		/*!
-		 * The input file to convert.
+		 * The input files to convert.
+		 *
+		 * The meshes of all of these files are combined into one 3MF file. If
+		 * one of these is "-", that input is read from the standard input.
 		 */
-		std::string input_filename;
+		std::vector<std::string> input_filenames;
 
 		/*!
 		 * The output file name to store the resulting 3MF file in.
+		 *
+		 * If this is "-", the 3MF file is written to the standard output.
 		 */
 		std::string output_filename;
 
+		/*!
+		 * The settings for how to convert the file.
+		 */
+		Options options;
+
 		/*!
 		 * Construct a new conversion job.
 		 */
-		Job(const std::string& input_filename, const std::string& output_filename);
+		Job(const std::string& input_filename, const std::string& output_filename, const Options& options = Options());
+
+		/*!
+		 * Construct a new conversion job that combines multiple files.
+		 */
+		Job(const std::vector<std::string>& input_filenames, const std::string& output_filename, const Options& options = Options());
 
 		/*!
 		 * Starts the conversion process.
+		 *
+		 * If the options have a monitor, the conversion reports its progress and
+		 * its messages to it, including why it failed, and stops when it gets
+		 * cancelled or its deadline passes. The output file is then not
+		 * written.
+		 * \return `true` if the conversion completed, or `false` if it was
+		 * cancelled, the standard input was given as input more than once, an
+		 * input could not be read or was too big for the memory, or the output
+		 * could not be written.
+		 */
+		bool run();
+
+	protected:
+		/*!
+		 * Check whether the conversion fits in the memory budget of the options.
+		 *
+		 * If the estimated peak memory usage exceeds the budget, the options are
+		 * changed to stream the faces of OBJ files if that helps. Inputs from
+		 * the standard input can't be estimated, so they are always admitted.
+		 * \throws Cancelled The conversion doesn't fit in the budget.
+		 */
+		void admit();
+
+		/*!
+		 * Import one of the input files.
+		 *
+		 * The meshes in the resulting model are named after the file, unless the
+		 * file gives them a name of its own.
+		 * \param input_filename The file to import, or "-" to import from the
+		 * standard input.
+		 * \param options The settings for how to import the file.
+		 * \return The model in that file.
 		 */
-		void run();
+		static Model import(const std::string& input_filename, const Options& options);
 };
 
 }
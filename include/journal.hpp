@@ -0,0 +1,182 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <chrono> //To sync the journal to disk regularly.
+#include <cstdint> //For fixed-size file sizes and modification times.
+#include <cstdio> //To append to the journal file.
+#include <string> //To store file names.
+#include <unordered_map> //To look up completed conversions by their input file.
+
+namespace convertto3mf {
+
+/*!
+ * An append-only record of which conversions of a batch have completed.
+ *
+ * Each line of the journal records one completed conversion: the input file,
+ * its size and modification time, the output file and its size. When a batch
+ * is restarted after being interrupted, the conversions in the journal can be
+ * skipped, as long as the input didn't change and the output is still intact.
+ *
+ * Records are flushed to the operating system right away, but only synced to
+ * the disk every few records, since syncing is slow. A crash of the whole
+ * system may lose the last few records, which only means that those
+ * conversions are done again.
+ */
+class Journal {
+	public:
+	/*!
+	 * One completed conversion.
+	 */
+	struct Entry {
+		/*!
+		 * The size of the input file, in bytes.
+		 */
+		uint64_t input_size;
+
+		/*!
+		 * When the input file was last modified, in nanoseconds since the
+		 * epoch.
+		 */
+		int64_t input_mtime;
+
+		/*!
+		 * The file that the input was converted to.
+		 */
+		std::string output_filename;
+
+		/*!
+		 * The size of the output file, in bytes.
+		 */
+		uint64_t output_size;
+	};
+
+	/*!
+	 * The maximum number of records to write before syncing them to disk.
+	 */
+	static constexpr size_t sync_records = 64;
+
+	/*!
+	 * The maximum time to wait before syncing new records to disk.
+	 */
+	static constexpr std::chrono::seconds sync_interval = std::chrono::seconds(5);
+
+	/*!
+	 * Read the completed conversions from a journal file, and open it to
+	 * append new records.
+	 *
+	 * If the file doesn't exist yet, it is created.
+	 * \param filename The journal file.
+	 */
+	Journal(const std::string& filename);
+
+	/*!
+	 * Sync the remaining records to disk and close the journal.
+	 */
+	~Journal();
+
+	//Journals can't be copied, since they would both append to the same file.
+	Journal(const Journal& other) = delete;
+	Journal& operator =(const Journal& other) = delete;
+
+	/*!
+	 * Whether the journal file could be opened for appending.
+	 * \return `true` if completed conversions can be recorded.
+	 */
+	bool is_open() const;
+
+	/*!
+	 * Get the number of completed conversions that were read from the journal.
+	 * \return The number of distinct input files that were converted before.
+	 */
+	size_t size() const;
+
+	/*!
+	 * Whether a conversion was completed before and doesn't need to be done
+	 * again.
+	 *
+	 * This is only the case if the journal has a record of it, the input file
+	 * still has the same size and modification time, and the output file still
+	 * has the same size and is a complete archive of which every file matches
+	 * its CRC-32.
+	 * \param input_filename The file to convert.
+	 * \param output_filename The file to convert it to.
+	 * \return `true` if the conversion can be skipped.
+	 */
+	bool is_completed(const std::string& input_filename, const std::string& output_filename) const;
+
+	/*!
+	 * Record that a conversion was completed.
+	 * \param input_filename The file that was converted.
+	 * \param output_filename The file that it was converted to.
+	 * \return `true` if it was recorded, or `false` if the input or output
+	 * file could not be found.
+	 */
+	bool record(const std::string& input_filename, const std::string& output_filename);
+
+	/*!
+	 * Write all records to disk.
+	 */
+	void sync();
+
+	protected:
+	/*!
+	 * The completed conversions, by their input file.
+	 *
+	 * If an input file was converted multiple times, only the last record is
+	 * kept.
+	 */
+	std::unordered_map<std::string, Entry> completed;
+
+	/*!
+	 * The journal file, opened for appending.
+	 */
+	std::FILE* file;
+
+	/*!
+	 * The number of records written since the last sync.
+	 */
+	size_t unsynced_records;
+
+	/*!
+	 * When the journal was last synced to disk.
+	 */
+	std::chrono::steady_clock::time_point last_sync;
+
+	/*!
+	 * Find the size and modification time of a file.
+	 * \param filename The file to inspect.
+	 * \param size The size of the file, in bytes, is stored here.
+	 * \param mtime When the file was last modified, in nanoseconds since the
+	 * epoch, is stored here. If the system can't tell, this is 0.
+	 * \return `true` if the file exists, or `false` if it doesn't.
+	 */
+	static bool stat_file(const std::string& filename, uint64_t& size, int64_t& mtime);
+
+	/*!
+	 * Escape a file name so that it fits in one field of a record.
+	 *
+	 * Backslashes, tabs and newlines are replaced by escape sequences.
+	 * \param field The file name to escape.
+	 * \return The escaped file name.
+	 */
+	static std::string escape(const std::string& field);
+
+	/*!
+	 * Reverse the escaping of a file name.
+	 * \param field The escaped file name.
+	 * \return The original file name.
+	 */
+	static std::string unescape(const std::string& field);
+};
+
+}
+
+#endif //JOURNAL_HPP
\ No newline at end of file
@@ -0,0 +1,158 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef JSON_HPP
+#define JSON_HPP
+
+#include <string> //To store strings and the keys of objects.
+#include <vector> //To store the elements of arrays and objects.
+
+namespace convertto3mf {
+
+/*!
+ * A value in a JSON document, such as the scene description in glTF files.
+ *
+ * This is a small parser that reads the whole document into a tree of values.
+ * It is only meant for the small documents that describe the structure of
+ * binary files, not for bulk data.
+ */
+class Json {
+	public:
+	/*!
+	 * The types of values that JSON can store.
+	 */
+	enum Type {
+		NUL,
+		BOOLEAN,
+		NUMBER,
+		STRING,
+		ARRAY,
+		OBJECT
+	};
+
+	/*!
+	 * The type of this value.
+	 */
+	Type type = Type::NUL;
+
+	/*!
+	 * If this is a boolean, its value.
+	 */
+	bool boolean = false;
+
+	/*!
+	 * If this is a number, its value.
+	 */
+	double number = 0;
+
+	/*!
+	 * If this is a string, its contents.
+	 */
+	std::string string;
+
+	/*!
+	 * If this is an array, its elements. If this is an object, the values of its
+	 * members, in the same order as the `keys`.
+	 */
+	std::vector<Json> elements;
+
+	/*!
+	 * If this is an object, the names of its members.
+	 */
+	std::vector<std::string> keys;
+
+	/*!
+	 * Parse a JSON document.
+	 * \param text The JSON document.
+	 * \return The value in the document. If the document is invalid, this is
+	 * null.
+	 */
+	static Json parse(const std::string& text);
+
+	/*!
+	 * Get a member of this object.
+	 * \param key The name of the member.
+	 * \return The value of that member, or null if this is not an object or it
+	 * has no such member.
+	 */
+	const Json& operator [](const std::string& key) const;
+
+	/*!
+	 * Get an element of this array.
+	 * \param index The position of the element in the array.
+	 * \return The element, or null if this is not an array or it is too short.
+	 */
+	const Json& operator [](const size_t index) const;
+
+	/*!
+	 * Get the number of elements in this array.
+	 * \return The number of elements, or 0 if this is not an array.
+	 */
+	size_t size() const;
+
+	/*!
+	 * Get this value as a number.
+	 * \param fallback The number to return if this is not a number.
+	 * \return The number.
+	 */
+	double as_number(const double fallback) const;
+
+	/*!
+	 * Get this value as an index into an array.
+	 * \param fallback The index to return if this is not a non-negative whole
+	 * number.
+	 * \return The index.
+	 */
+	size_t as_index(const size_t fallback) const;
+
+	protected:
+	/*!
+	 * The deepest nesting of arrays and objects that is parsed, to protect the
+	 * stack against malicious files.
+	 */
+	static constexpr size_t max_depth = 256;
+
+	/*!
+	 * A null value, to refer to when asking for values that don't exist.
+	 */
+	static const Json null;
+
+	/*!
+	 * Parse a value, including any whitespace around it.
+	 * \param cursor Where the value starts. This is moved to the end of the
+	 * value.
+	 * \param end The end of the document.
+	 * \param value The value that was parsed is stored here.
+	 * \param depth How many arrays and objects this value is nested in.
+	 * \return `true` if a valid value was parsed, or `false` if it is invalid.
+	 */
+	static bool parse_value(const char*& cursor, const char* end, Json& value, const size_t depth);
+
+	/*!
+	 * Parse a string, including its quotes.
+	 * \param cursor Where the opening quote is. This is moved to after the
+	 * closing quote.
+	 * \param end The end of the document.
+	 * \param result The contents of the string, with escape sequences
+	 * replaced, are stored here.
+	 * \return `true` if a valid string was parsed, or `false` if it is invalid.
+	 */
+	static bool parse_string(const char*& cursor, const char* end, std::string& result);
+
+	/*!
+	 * Skip over whitespace.
+	 * \param cursor Where to start skipping. This is moved to the first
+	 * character that is not whitespace.
+	 * \param end The end of the document.
+	 */
+	static void skip_whitespace(const char*& cursor, const char* end);
+};
+
+}
+
+#endif //JSON_HPP
\ No newline at end of file
@@ -0,0 +1,81 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string> //To accept filenames.
+#include <vector> //As fallback if the file can't be mapped into memory.
+
+namespace convertto3mf {
+
+/*!
+ * This class gives read access to the contents of a file as one block of
+ * memory.
+ *
+ * Where possible, the file is mapped into memory, so that the operating system
+ * loads the contents on demand without copying them. If that is not possible,
+ * the whole file is read into a buffer instead.
+ */
+class MappedFile {
+	public:
+	/*!
+	 * Open a file and map it into memory.
+	 *
+	 * If the file can't be opened, the contents will be empty.
+	 * \param filename The path to the file to open.
+	 */
+	MappedFile(const std::string& filename);
+
+	/*!
+	 * Unmaps the file again.
+	 */
+	~MappedFile();
+
+	//Mapped files can't be copied, since they would both unmap the same memory.
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator =(const MappedFile& other) = delete;
+
+	/*!
+	 * Get the contents of the file.
+	 * \return A pointer to the first byte of the file.
+	 */
+	const char* data() const;
+
+	/*!
+	 * Get the size of the file.
+	 * \return The number of bytes in the file.
+	 */
+	size_t size() const;
+
+	protected:
+	/*!
+	 * The contents of the file, either mapped or in the buffer.
+	 */
+	const char* contents;
+
+	/*!
+	 * The number of bytes in the contents.
+	 */
+	size_t length;
+
+	/*!
+	 * Whether the contents are mapped into memory, and so need to be unmapped
+	 * afterwards.
+	 */
+	bool is_mapped;
+
+	/*!
+	 * If the file could not be mapped, this holds the contents of the file.
+	 */
+	std::vector<char> buffer;
+};
+
+}
+
+#endif //MAPPED_FILE_HPP
\ No newline at end of file
@@ -0,0 +1,61 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef MEMORY_BUFFER_HPP
+#define MEMORY_BUFFER_HPP
+
+#include <cstddef> //For size_t.
+#include <streambuf> //To provide the memory as a stream.
+
+namespace convertto3mf {
+
+/*!
+ * A stream buffer that reads from a block of memory.
+ *
+ * This allows the importers that read from streams to read from memory without
+ * copying the data first. The memory needs to stay valid for as long as the
+ * buffer is used.
+ */
+class MemoryBuffer : public std::streambuf {
+	public:
+	/*!
+	 * Create a stream buffer that reads from a block of memory.
+	 * \param data The start of the memory to read.
+	 * \param size The number of bytes to read.
+	 */
+	MemoryBuffer(const char* data, const size_t size);
+
+	protected:
+	/*!
+	 * Move the read position to a position relative to the start, the end or
+	 * the current position.
+	 *
+	 * This also allows streams to report their position in the memory.
+	 * \param offset How far to move the read position.
+	 * \param direction Where to move the read position relative to.
+	 * \param which Whether to move the read or write position. Only reading
+	 * is supported.
+	 * \return The new read position, or -1 if it would be outside of the
+	 * memory.
+	 */
+	pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which = std::ios_base::in) override;
+
+	/*!
+	 * Move the read position to an absolute position.
+	 * \param position The new read position, relative to the start.
+	 * \param which Whether to move the read or write position. Only reading
+	 * is supported.
+	 * \return The new read position, or -1 if it would be outside of the
+	 * memory.
+	 */
+	pos_type seekpos(pos_type position, std::ios_base::openmode which = std::ios_base::in) override;
+};
+
+}
+
+#endif //MEMORY_BUFFER_HPP
\ No newline at end of file
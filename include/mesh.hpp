@@ -9,6 +9,10 @@
 #ifndef MESH_HPP
 #define MESH_HPP
 
+#include <array> //To store indexed triangles.
+#include <functional> //To produce triangles on demand.
+#include <string> //To store the name of the mesh.
+
 #include "face.hpp" //To store faces.
 
 namespace convertto3mf {
@@ -18,13 +22,56 @@ namespace convertto3mf {
  *
  * A mesh consists of a collection of faces that belong together. The faces are
  * not necessarily all connected to each other.
+ *
+ * Some file formats already store their meshes with indexed vertices. Those
+ * can fill the `vertices` and `triangles` of the mesh instead of the faces, so
+ * that the vertices don't need to be made unique again.
  */
 class Mesh {
 	public:
+	/*!
+	 * A name for this mesh, to identify it to the user.
+	 *
+	 * This may be empty if the mesh has no name.
+	 */
+	std::string name;
+
 	/*!
 	 * All of the faces within this model.
 	 */
 	std::vector<Face> faces;
+
+	/*!
+	 * The vertices of the indexed part of this mesh.
+	 */
+	std::vector<Point3> vertices;
+
+	/*!
+	 * The triangles of the indexed part of this mesh.
+	 *
+	 * Each triangle refers to three of the vertices in `vertices` by their
+	 * index.
+	 */
+	std::vector<std::array<size_t, 3>> triangles;
+
+	/*!
+	 * A function that produces a batch of triangles of this mesh on demand,
+	 * adding them to a list.
+	 *
+	 * The triangles refer to the indexed `vertices` of the mesh. A batch must
+	 * produce the same triangles every time it is called, and it must be safe
+	 * to call multiple batches at the same time from different threads.
+	 */
+	typedef std::function<void(std::vector<std::array<size_t, 3>>&)> TriangleBatch;
+
+	/*!
+	 * More triangles of the indexed part of this mesh, which are only produced
+	 * when they are needed.
+	 *
+	 * This allows importers to convert huge files without keeping all of the
+	 * triangles in memory. These triangles come after the `triangles`.
+	 */
+	std::vector<TriangleBatch> triangle_batches;
 };
 
 }
@@ -0,0 +1,247 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef MONITOR_HPP
+#define MONITOR_HPP
+
+#include <atomic> //To update the progress and cancel from multiple threads.
+#include <chrono> //To enforce deadlines.
+#include <functional> //To report progress and messages to callbacks.
+#include <mutex> //To call the callbacks from one thread at a time.
+#include <stdexcept> //To abort cancelled conversions with an exception.
+#include <string> //To describe why a conversion was cancelled, and to pass messages.
+
+namespace convertto3mf {
+
+/*!
+ * Thrown from the conversion when it was cancelled or when its deadline passed.
+ *
+ * The conversion then stops as soon as possible, without writing any output.
+ */
+class Cancelled : public std::runtime_error {
+public:
+	/*!
+	 * Create the exception.
+	 * \param reason Why the conversion was cancelled.
+	 */
+	Cancelled(const std::string& reason);
+};
+
+/*!
+ * Tracks the progress of a conversion, and allows cancelling it.
+ *
+ * The importers and the writer regularly report how far they got, which gets
+ * passed on to a callback. Whenever they do, they also check whether the
+ * conversion was cancelled or its deadline passed, and if so they abort by
+ * throwing `Cancelled`.
+ *
+ * The conversion also describes what it does and what it found in messages,
+ * such as which file it imports, which get passed on to a log callback. The
+ * conversion doesn't print anything itself, so without a log callback it is
+ * silent.
+ *
+ * All of the functions may be called from multiple threads at the same time.
+ */
+class Monitor {
+public:
+	/*!
+	 * The phases that a conversion goes through.
+	 */
+	enum Phase {
+		IMPORT,
+		WELD,
+		WRITE
+	};
+
+	/*!
+	 * How far the conversion got.
+	 */
+	struct Progress {
+		/*!
+		 * The phase that the conversion is in.
+		 */
+		Phase phase;
+
+		/*!
+		 * How many bytes were processed in this phase so far. While importing,
+		 * these are bytes of input. While writing, these are bytes of the 3D
+		 * model, before compression.
+		 */
+		size_t bytes;
+
+		/*!
+		 * How many bytes will be processed in this phase in total, or 0 if
+		 * that is unknown.
+		 */
+		size_t total_bytes;
+
+		/*!
+		 * How many triangles or faces were processed in this phase so far.
+		 * While importing, these are faces of the input. While welding and
+		 * writing, these are the welded triangles that the 3MF file gets.
+		 */
+		size_t triangles;
+	};
+
+	/*!
+	 * A function that gets called with the progress whenever it changes.
+	 *
+	 * This is never called from multiple threads at the same time.
+	 */
+	typedef std::function<void(const Progress&)> Callback;
+
+	/*!
+	 * How important a message is.
+	 *
+	 * Information tells what the conversion does and what it found. Failures
+	 * tell why a conversion failed or was cancelled.
+	 */
+	enum Severity {
+		INFO,
+		FAILURE
+	};
+
+	/*!
+	 * A function that gets called with each message of the conversion.
+	 *
+	 * The message has no line break at the end, but may span multiple lines.
+	 * This is never called from multiple threads at the same time, so the
+	 * messages of different threads don't get mixed up.
+	 */
+	typedef std::function<void(const std::string& message, const Severity severity)> LogCallback;
+
+	/*!
+	 * The number of items, such as lines, faces or triangles, that the hot
+	 * loops process between reporting their progress.
+	 */
+	static constexpr size_t report_interval = 65536;
+
+	/*!
+	 * Create a monitor without deadline.
+	 * \param callback A function to call whenever the progress changes. This
+	 * may be empty to only allow cancelling.
+	 * \param log_callback A function to call with each message of the
+	 * conversion. This may be empty to keep the conversion silent.
+	 */
+	Monitor(const Callback& callback = Callback(), const LogCallback& log_callback = LogCallback());
+
+	/*!
+	 * Cancel the conversion.
+	 *
+	 * The conversion aborts the next time that it checks.
+	 */
+	void cancel();
+
+	/*!
+	 * Cancel the conversion automatically when a point in time has passed.
+	 * \param deadline When to cancel the conversion.
+	 */
+	void set_deadline(const std::chrono::steady_clock::time_point deadline);
+
+	/*!
+	 * Whether the conversion was cancelled or its deadline passed.
+	 * \return `true` if the conversion must stop.
+	 */
+	bool is_cancelled() const;
+
+	/*!
+	 * Abort the conversion if it was cancelled or its deadline passed.
+	 *
+	 * This throws `Cancelled` if the conversion must stop.
+	 */
+	void check() const;
+
+	/*!
+	 * Start a new phase of the conversion, resetting the progress.
+	 * \param phase The new phase.
+	 * \param total_bytes How many bytes will be processed in this phase, or 0
+	 * if that is unknown.
+	 */
+	void start_phase(const Phase phase, const size_t total_bytes = 0);
+
+	/*!
+	 * Report that more of the current phase was processed.
+	 *
+	 * This calls the callback with the new progress, and then checks whether
+	 * the conversion must stop.
+	 * \param bytes How many more bytes were processed.
+	 * \param triangles How many more triangles or faces were processed.
+	 */
+	void advance(const size_t bytes, const size_t triangles);
+
+	/*!
+	 * Pass a message about the conversion on to the log callback.
+	 * \param message The message, without line break at the end.
+	 * \param severity How important the message is.
+	 */
+	void log(const std::string& message, const Severity severity = Severity::INFO);
+
+	/*!
+	 * Get a name for a phase, to show to the user.
+	 * \param phase The phase to get the name of.
+	 * \return A name for that phase.
+	 */
+	static const char* name(const Phase phase);
+
+protected:
+	/*!
+	 * The function to call whenever the progress changes.
+	 */
+	Callback callback;
+
+	/*!
+	 * Serialises the calls to the callback.
+	 */
+	std::mutex callback_mutex;
+
+	/*!
+	 * The function to call with each message of the conversion.
+	 */
+	LogCallback log_callback;
+
+	/*!
+	 * Serialises the calls to the log callback.
+	 */
+	std::mutex log_mutex;
+
+	/*!
+	 * Whether the conversion was cancelled explicitly.
+	 */
+	std::atomic<bool> cancelled;
+
+	/*!
+	 * When the conversion must be cancelled, as the time since the epoch of
+	 * the steady clock. If there is no deadline, this is the largest possible
+	 * time.
+	 */
+	std::atomic<std::chrono::steady_clock::rep> deadline;
+
+	/*!
+	 * The phase that the conversion is in.
+	 */
+	std::atomic<Phase> phase;
+
+	/*!
+	 * How many bytes were processed in the current phase.
+	 */
+	std::atomic<size_t> bytes;
+
+	/*!
+	 * How many bytes will be processed in the current phase, or 0 if unknown.
+	 */
+	std::atomic<size_t> total_bytes;
+
+	/*!
+	 * How many triangles were processed in the current phase.
+	 */
+	std::atomic<size_t> triangles;
+};
+
+}
+
+#endif //MONITOR_HPP
\ No newline at end of file
@@ -9,9 +9,15 @@
 #ifndef OBJ_HPP
 #define OBJ_HPP
 
+#include <array> //To produce triangles while streaming.
+#include <istream> //To read OBJ files from streams.
+#include <string> //To parse lines of OBJ files.
 #include <vector> //To store the data structure contained within the OBJ file format.
 
+#include "mapped_file.hpp" //To read the faces of OBJ files on demand while streaming.
+#include "monitor.hpp" //To report progress while importing.
 #include "point3.hpp" //To store vertices from the OBJ file.
+#include "probe.hpp" //To summarise files without converting them.
 
 namespace convertto3mf {
 
@@ -24,40 +30,212 @@ class Obj {
 public:
 	/*!
 	 * Determines the likelihood of this file being an OBJ file.
-	 * \param filename The name of the file to check.
+	 * \param filename The name of the file to check. This may be empty if the
+	 * name of the file is unknown.
+	 * \param sample The first bytes of the file, up to 1kB.
 	 * \return The likelihood of this file being an OBJ file. This is a rather
 	 * arbitrary guess of probability between 0 and 1.
 	 */
-	static float is_obj(const std::string& filename);
+	static float is_obj(const std::string& filename, const std::string& sample);
 
 	/*!
 	 * Read an OBJ file, storing it in memory as a `Model` instance.
+	 * \param filename The OBJ file to read.
+	 * \param monitor Reports how far the import got, and aborts it if the
+	 * conversion is cancelled. This may be `nullptr`.
 	 */
-	static Model import(const std::string& filename);
+	static Model import(const std::string& filename, Monitor* monitor = nullptr);
+
+	/*!
+	 * Read an OBJ file from a stream, storing it in memory as a `Model`
+	 * instance.
+	 * \param stream The stream providing the contents of the OBJ file.
+	 * \param monitor Reports how far the import got, and aborts it if the
+	 * conversion is cancelled. This may be `nullptr`.
+	 */
+	static Model import(std::istream& stream, Monitor* monitor = nullptr);
+
+	/*!
+	 * Read an OBJ file without keeping its faces in memory.
+	 *
+	 * Only the vertices are read right away, and made unique. The faces are
+	 * read again from the file when the model is written, in batches that can
+	 * be processed in parallel. This saves a lot of memory for files with many
+	 * faces. The file is read twice though.
+	 * \param filename The OBJ file to read.
+	 * \param monitor Reports how far the import got, and aborts it if the
+	 * conversion is cancelled. This may be `nullptr`.
+	 * \return A model with a single mesh, whose triangles are produced on
+	 * demand. Objects and groups are not separated while streaming.
+	 */
+	static Model import_streaming(const std::string& filename, Monitor* monitor = nullptr);
+
+	/*!
+	 * Find the number of triangles and vertices and the bounding box of an OBJ
+	 * file in memory, without building a model.
+	 *
+	 * The lines of the file are scanned in parallel. Only the coordinates of
+	 * the vertices are parsed, and the vertices of faces are only counted.
+	 * \param data The contents of the OBJ file.
+	 * \param size The number of bytes in the OBJ file.
+	 * \param result The probe to store the numbers in.
+	 */
+	static void probe(const char* data, const size_t size, Probe& result);
 
 protected:
+	/*!
+	 * The number of faces that are read in one batch while streaming.
+	 */
+	static constexpr size_t stream_batch_size = 65536;
+
+	/*!
+	 * The information needed to read the faces of an OBJ file on demand.
+	 *
+	 * This is shared by all batches of faces, and stays alive for as long as
+	 * any of those batches may still be read.
+	 */
+	struct StreamedFaces {
+		/*!
+		 * The contents of the OBJ file.
+		 */
+		MappedFile file;
+
+		/*!
+		 * For each vertex in the OBJ file, the index of the unique vertex in
+		 * the mesh.
+		 */
+		std::vector<size_t> vertex_remap;
+
+		/*!
+		 * The positions in the file where each batch of faces starts, followed
+		 * by the size of the file.
+		 */
+		std::vector<size_t> batch_starts;
+
+		/*!
+		 * For each batch of faces, the number of vertices that were defined in
+		 * the file before that batch starts.
+		 *
+		 * This is needed to resolve negative vertex indices.
+		 */
+		std::vector<size_t> batch_vertex_counts;
+
+		/*!
+		 * Open the OBJ file to read the faces from.
+		 * \param filename The OBJ file.
+		 */
+		StreamedFaces(const std::string& filename);
+
+		/*!
+		 * Read a batch of faces from the file, and add them as triangles.
+		 * \param batch The index of the batch to read.
+		 * \param triangles The list of triangles to add the triangles to. The
+		 * triangles refer to the unique vertices.
+		 */
+		void triangulate(const size_t batch, std::vector<std::array<size_t, 3>>& triangles) const;
+	};
+
+	/*!
+	 * Reports how far the import got, and aborts it if the conversion is
+	 * cancelled, or `nullptr` if nothing needs to be reported.
+	 */
+	Monitor* monitor = nullptr;
+
 	/*!
 	 * The list of vertices found in the OBJ file.
 	 */
 	std::vector<Point3> vertices;
 
 	/*!
-	 * The list of faces found in the OBJ file.
+	 * An object or group in the OBJ file, which becomes a separate mesh.
+	 */
+	struct Group {
+		/*!
+		 * The name of the object or group, as given in the OBJ file.
+		 *
+		 * This is empty for the faces that are not part of any object or group.
+		 */
+		std::string name;
+
+		/*!
+		 * The list of faces in this group.
+		 *
+		 * Each face is a list of indices referring to one of the vertices each.
+		 */
+		std::vector<std::vector<size_t>> faces;
+	};
+
+	/*!
+	 * The objects and groups found in the OBJ file, in the order in which they
+	 * first occur in the file.
 	 *
-	 * Each face is a list of indices referring to one of the vertices each.
+	 * If an object or group is mentioned multiple times, the faces of all of
+	 * those parts of the file are combined into one group.
 	 */
-	std::vector<std::vector<size_t>> faces;
+	std::vector<Group> groups;
 
 	/*!
 	 * Reads lines from an OBJ file and pre-processes them.
 	 *
 	 * This combines lines that have a continuation slash between them, and
 	 * trims whitespace from these lines.
-	 * \param filename The path to the file to read from.
+	 * \param stream The stream to read the file from.
 	 * \return A list of lines from the file, slightly pre-processed for easier
 	 * parsing.
 	 */
-	std::vector<std::string> preprocess(const std::string& filename) const;
+	std::vector<std::string> preprocess(std::istream& stream) const;
+
+	/*!
+	 * Reads one line from an OBJ file and pre-processes it.
+	 *
+	 * Whitespace is trimmed from the line, and if the line ends in a
+	 * continuation slash, the next line is added to it.
+	 * \param stream The stream to read the file from.
+	 * \param line Output parameter for the pre-processed line.
+	 * \return `true` if a line was read, or `false` if the end of the file was
+	 * reached.
+	 */
+	static bool read_line(std::istream& stream, std::string& line);
+
+	/*!
+	 * Remove whitespace from the start and end of a line.
+	 * \param line The line to trim, in-place.
+	 */
+	static void trim(std::string& line);
+
+	/*!
+	 * Parse a line that defines a vertex.
+	 * \param line A pre-processed line from the OBJ file.
+	 * \param vertex Output parameter for the vertex defined by this line.
+	 * \return `true` if the line defines a vertex, or `false` if it is a
+	 * different kind of line or if it is malformed.
+	 */
+	static bool parse_vertex(const std::string& line, Point3& vertex);
+
+	/*!
+	 * Parse a line that defines a face.
+	 *
+	 * Malformed vertex references are skipped.
+	 * \param line A pre-processed line from the OBJ file, starting with "f ".
+	 * \param num_vertices The number of vertices defined before this face,
+	 * which negative indices are relative to.
+	 * \param vertex_indices Output parameter to add the 0-based indices of
+	 * the vertices of the face to.
+	 */
+	static void parse_face(const std::string& line, const size_t num_vertices, std::vector<size_t>& vertex_indices);
+
+	/*!
+	 * Parse a line that starts a new object or group.
+	 *
+	 * Both objects (`o`) and groups (`g`) are treated the same way. If a group
+	 * has multiple names, the whole list of names is used as its name.
+	 * \param line A pre-processed line from the OBJ file.
+	 * \param name Output parameter for the name of the object or group. This
+	 * is empty if the object or group has no name.
+	 * \return `true` if the line starts an object or group, or `false` if it
+	 * is a different kind of line.
+	 */
+	static bool parse_group(const std::string& line, std::string& name);
 
 	/*!
 	 * Loads the contents of the OBJ file from pre-processed lines.
@@ -69,6 +247,10 @@ protected:
 
 	/*!
 	 * Converts the OBJ file to a Model class in our internal data format.
+	 *
+	 * Each object or group becomes a separate mesh, named after the object or
+	 * group, with indexed vertices and triangles. The groups are converted in
+	 * parallel.
 	 * \return A 3D model.
 	 */
 	Model to_model() const;
@@ -0,0 +1,153 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <cstddef> //For size_t.
+#include <memory> //To share the monitor with the caller that cancels the conversion.
+#include <string> //To store the file name of the trace.
+
+#include "monitor.hpp" //To report progress and allow cancelling.
+
+namespace convertto3mf {
+
+/*!
+ * The settings that change how a conversion is performed.
+ *
+ * By default, all of these settings produce a plain 3MF file with all meshes in
+ * a single model file.
+ */
+class Options {
+	public:
+	/*!
+	 * Whether to write each mesh to its own model part in the archive.
+	 *
+	 * The root model then refers to those parts via components of the 3MF
+	 * Production extension. The parts are serialised independently, so this
+	 * allows writing and loading them in parallel.
+	 */
+	bool split_parts = false;
+
+	/*!
+	 * When splitting the meshes into parts, the maximum number of triangles to
+	 * put in one part.
+	 *
+	 * Meshes with more triangles than this are split into multiple parts. If
+	 * this is 0, meshes are never split up, only put in separate parts.
+	 */
+	size_t part_max_triangles = 1000000;
+
+	/*!
+	 * Whether to reorder the vertices and triangles of each mesh for locality
+	 * before writing them.
+	 *
+	 * This makes the output compress better and load faster, but costs some
+	 * time during the conversion.
+	 */
+	bool reorder = false;
+
+	/*!
+	 * Whether to store meshes that are identical apart from their position
+	 * only once.
+	 *
+	 * The copies are then built by placing the same object multiple times,
+	 * with a transformation.
+	 */
+	bool instancing = false;
+
+	/*!
+	 * Whether to check the meshes for holes, flipped triangles, non-manifold
+	 * edges and degenerate triangles, and report what was found.
+	 *
+	 * The report is passed to the log callback of the monitor. This doesn't
+	 * change the output. The meshes are still written as they
+	 * are.
+	 */
+	bool validate = false;
+
+	/*!
+	 * The maximum number of triangles to write, or 0 to write all triangles.
+	 *
+	 * If the meshes have more triangles than this, they are simplified until
+	 * they fit. Each mesh gets a share of this budget in proportion to its
+	 * number of triangles. This is useful to make light previews.
+	 */
+	size_t max_triangles = 0;
+
+	/*!
+	 * Whether to split each mesh into its connected components, writing each
+	 * component as a separate object.
+	 *
+	 * This is useful for formats that can only store a single mesh, such as
+	 * STL, when the file contains multiple separate parts.
+	 */
+	bool split_components = false;
+
+	/*!
+	 * Whether to stream the faces of OBJ files straight into the 3MF file.
+	 *
+	 * Only the vertices of the OBJ file are kept in memory. The faces are read
+	 * from the file a second time while writing the 3MF file. This saves a lot
+	 * of memory, but only works if no other options need all triangles in
+	 * memory, such as reordering, instancing, validating, simplifying or
+	 * splitting.
+	 */
+	bool streaming = false;
+
+	/*!
+	 * The most memory the conversion may use, in bytes, or 0 for no limit.
+	 *
+	 * Jobs estimate the peak memory usage before converting. If it exceeds
+	 * this budget, the faces of OBJ files are streamed if possible. If it
+	 * still exceeds the budget then, the conversion is refused.
+	 */
+	size_t max_memory = 0;
+
+	/*!
+	 * The number of significant digits to write coordinates with.
+	 *
+	 * This has no effect when quantising the coordinates, since those are
+	 * always written exactly.
+	 */
+	size_t precision = 6;
+
+	/*!
+	 * The size of the grid to snap all coordinates to, in micrometres.
+	 *
+	 * The coordinates are snapped before making the vertices unique, so
+	 * vertices that end up in the same place are merged, and triangles that
+	 * collapse are removed. The snapped coordinates are written with the fewest
+	 * decimals that represent them exactly. If this is 0, coordinates are not
+	 * snapped.
+	 */
+	double quantize = 0;
+
+	/*!
+	 * A file to write a trace of the conversion to, in the Chrome trace event
+	 * format.
+	 *
+	 * The trace shows how long each stage of the conversion took on each
+	 * thread. If this is empty, no trace is recorded. In a batch, one trace
+	 * is written for all conversions together.
+	 */
+	std::string trace_filename;
+
+	/*!
+	 * Receives the progress and the messages of the conversion, and allows
+	 * cancelling it or setting a deadline.
+	 *
+	 * If this is empty, no progress is reported, the conversion is silent and
+	 * it can't be cancelled.
+	 */
+	std::shared_ptr<Monitor> monitor;
+};
+
+}
+
+#endif //OPTIONS_HPP
\ No newline at end of file
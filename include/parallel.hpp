@@ -0,0 +1,108 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm> //For std::min and std::max.
+#include <atomic> //To hand out work items to the threads.
+#include <exception> //To pass exceptions from the threads on to the caller.
+#include <mutex> //To store the first exception of any of the threads.
+#include <thread> //To run work on multiple threads.
+#include <vector> //To keep track of the started threads.
+
+namespace convertto3mf {
+
+/*!
+ * Get how many threads the current thread may spread its work over.
+ *
+ * This is 0 outside of any `parallel_for`, meaning that all hardware threads
+ * may be used. Within a `parallel_for`, each of its threads gets an equal
+ * share of the threads of that loop, so that nested loops together don't start
+ * more threads than there are hardware threads.
+ * \return A reference to the share of the current thread, to change it.
+ */
+inline size_t& thread_budget() {
+	thread_local size_t budget = 0;
+	return budget;
+}
+
+/*!
+ * Get the number of threads that work should be spread over.
+ *
+ * This is the number of hardware threads, or 1 if that is unknown. Within a
+ * `parallel_for`, it is the share of the hardware threads that the current
+ * thread got, which is 1 if the loop already uses all hardware threads.
+ */
+inline size_t num_worker_threads() {
+	const size_t budget = thread_budget();
+	return (budget > 0) ? budget : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/*!
+ * Execute a function for each index in a range, spread over multiple threads.
+ *
+ * The indices are handed out one by one to whichever thread is done first, so
+ * work items may take different amounts of time without leaving threads idle.
+ * The current thread takes part in the work as well. This function returns
+ * when all indices have been processed.
+ *
+ * This may be called from within the function of another `parallel_for`. The
+ * inner loop then only uses the share of the threads that its thread got from
+ * the outer loop. If the outer loop uses all hardware threads, the inner loop
+ * runs on the current thread alone.
+ * \param count The number of work items. The function gets called with every
+ * index from 0 up to but not including this count.
+ *
+ * If the function throws an exception, no more indices are handed out. The
+ * exception is thrown again from this function once all threads are done.
+ * \param function The function to execute for each index. It must be safe to
+ * call this from multiple threads at the same time.
+ */
+template<typename Function>
+void parallel_for(const size_t count, Function function) {
+	const size_t budget = num_worker_threads();
+	const size_t num_threads = std::min(count, budget);
+	const size_t worker_budget = std::max(size_t(1), budget / std::max(size_t(1), num_threads)); //Each thread may use its share of the threads for nested loops.
+	std::atomic<size_t> next_index(0);
+	std::exception_ptr exception; //The first exception thrown by any of the threads.
+	std::mutex exception_mutex;
+	auto worker = [&next_index, &function, &exception, &exception_mutex, count, worker_budget]() {
+		const size_t previous_budget = thread_budget();
+		thread_budget() = worker_budget;
+		try {
+			for(size_t index = next_index++; index < count; index = next_index++) {
+				function(index);
+			}
+		} catch(...) {
+			next_index = count; //Stop the other threads too.
+			std::lock_guard<std::mutex> lock(exception_mutex);
+			if(!exception) {
+				exception = std::current_exception();
+			}
+		}
+		thread_budget() = previous_budget; //The current thread continues with its own share after the loop.
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(num_threads);
+	for(size_t thread = 1; thread < num_threads; ++thread) { //Start at 1, since the current thread also works.
+		threads.emplace_back(worker);
+	}
+	worker();
+	for(std::thread& thread : threads) {
+		thread.join();
+	}
+	if(exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+}
+
+#endif //PARALLEL_HPP
\ No newline at end of file
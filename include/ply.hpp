@@ -0,0 +1,282 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef PLY_HPP
+#define PLY_HPP
+
+#include <array> //To store triangles.
+#include <string> //To accept filenames.
+#include <vector> //To store the elements and properties of the file.
+
+#include "model.hpp" //To construct 3D models from the file.
+#include "monitor.hpp" //To report progress while importing.
+#include "probe.hpp" //To summarise files without converting them.
+
+namespace convertto3mf {
+
+/*!
+ * Collection of functions for handling Stanford PLY files.
+ *
+ * Both the binary and the ASCII variants of PLY are supported. Binary files
+ * are read directly from the file mapped into memory, which is much faster
+ * than parsing the ASCII variant.
+ */
+class Ply {
+	public:
+	/*!
+	 * Determines the likelihood of this file being a PLY file.
+	 * \param filename The name of the file to check. This may be empty if the
+	 * name of the file is unknown.
+	 * \param sample The first bytes of the file, up to 1kB.
+	 * \return The likelihood of this file being a PLY file. This is a rather
+	 * arbitrary guess of probability between 0 and 1.
+	 */
+	static float is_ply(const std::string& filename, const std::string& sample);
+
+	/*!
+	 * Read a PLY file, storing it in memory as a `Model` instance.
+	 * \param filename The PLY file to read.
+	 * \param monitor Reports how far the import got, and aborts it if the
+	 * conversion is cancelled. This may be `nullptr`.
+	 */
+	static Model import(const std::string& filename, Monitor* monitor = nullptr);
+
+	/*!
+	 * Read a PLY file from memory, storing it as a `Model` instance.
+	 * \param data The contents of the PLY file.
+	 * \param size The number of bytes in the PLY file.
+	 * \param monitor Reports how far the import got, and aborts it if the
+	 * conversion is cancelled. This may be `nullptr`.
+	 */
+	static Model import(const char* data, const size_t size, Monitor* monitor = nullptr);
+
+	/*!
+	 * Find the number of triangles and vertices and the bounding box of a PLY
+	 * file in memory, without building a model.
+	 *
+	 * The numbers of vertices and faces are read from the header. Only the
+	 * coordinates of the vertices and the lengths of the faces are read from
+	 * the data.
+	 * \param data The contents of the PLY file.
+	 * \param size The number of bytes in the PLY file.
+	 * \param result The probe to store the numbers in.
+	 */
+	static void probe(const char* data, const size_t size, Probe& result);
+
+	protected:
+	/*!
+	 * The ways in which the data of a PLY file can be stored.
+	 */
+	enum Format {
+		ASCII,
+		BINARY_LITTLE_ENDIAN,
+		BINARY_BIG_ENDIAN
+	};
+
+	/*!
+	 * The data types that properties can have in a PLY file.
+	 */
+	enum Type {
+		INT8,
+		UINT8,
+		INT16,
+		UINT16,
+		INT32,
+		UINT32,
+		FLOAT32,
+		FLOAT64,
+		UNKNOWN
+	};
+
+	/*!
+	 * A property of an element in the PLY file, as described in the header.
+	 */
+	struct Property {
+		/*!
+		 * The name of the property, e.g. "x" or "vertex_indices".
+		 */
+		std::string name;
+
+		/*!
+		 * The data type of the property, or of the items in the list if this
+		 * is a list property.
+		 */
+		Type type;
+
+		/*!
+		 * Whether this property is a list of values rather than one value.
+		 */
+		bool is_list;
+
+		/*!
+		 * If this is a list property, the data type of the length of the list.
+		 */
+		Type count_type;
+	};
+
+	/*!
+	 * A type of element in the PLY file, as described in the header.
+	 */
+	struct Element {
+		/*!
+		 * The name of the element, e.g. "vertex" or "face".
+		 */
+		std::string name;
+
+		/*!
+		 * How many of these elements are stored in the file.
+		 */
+		size_t count;
+
+		/*!
+		 * The properties that each of these elements has.
+		 */
+		std::vector<Property> properties;
+	};
+
+	/*!
+	 * Reports how far the import got, and aborts it if the conversion is
+	 * cancelled, or `nullptr` if nothing needs to be reported.
+	 */
+	Monitor* monitor = nullptr;
+
+	/*!
+	 * How far the file was read when progress was last reported, in bytes.
+	 */
+	size_t reported_position = 0;
+
+	/*!
+	 * How many triangles were found when progress was last reported.
+	 */
+	size_t reported_triangles = 0;
+
+	/*!
+	 * How the data of this file is stored.
+	 */
+	Format format;
+
+	/*!
+	 * The elements in the file, in the order in which they are stored.
+	 */
+	std::vector<Element> elements;
+
+	/*!
+	 * The vertices found in the PLY file.
+	 */
+	std::vector<Point3> vertices;
+
+	/*!
+	 * The triangles found in the PLY file.
+	 *
+	 * Faces with more than three vertices are split into triangles as a
+	 * triangle fan.
+	 */
+	std::vector<std::array<size_t, 3>> triangles;
+
+	/*!
+	 * Read the header of the PLY file, describing which elements it contains.
+	 * \param data The contents of the file.
+	 * \param size The number of bytes in the file.
+	 * \return The position in the file where the data of the elements starts,
+	 * or 0 if the header is invalid.
+	 */
+	size_t load_header(const char* data, const size_t size);
+
+	/*!
+	 * Read the elements from a binary PLY file.
+	 * \param data The contents of the file.
+	 * \param size The number of bytes in the file.
+	 * \param position The position where the data of the elements starts.
+	 */
+	void load_binary(const char* data, const size_t size, size_t position);
+
+	/*!
+	 * Read the elements from an ASCII PLY file.
+	 * \param data The contents of the file.
+	 * \param size The number of bytes in the file.
+	 * \param position The position where the data of the elements starts.
+	 */
+	void load_ascii(const char* data, const size_t size, size_t position);
+
+	/*!
+	 * Report to the monitor how far the import got, if there is a monitor.
+	 *
+	 * This aborts the import if the conversion was cancelled.
+	 * \param position How far the file has been read, in bytes.
+	 */
+	void report_progress(const size_t position);
+
+	/*!
+	 * Add a face to the triangles, splitting it up as a triangle fan.
+	 * \param face The vertex indices of the face.
+	 */
+	void add_face(const std::vector<size_t>& face);
+
+	/*!
+	 * Convert the PLY-specific representation into the common 3D model
+	 * representation.
+	 *
+	 * The vertices and triangles are moved into the model, since they are
+	 * already indexed the way that the model stores them.
+	 */
+	Model to_model();
+
+	/*!
+	 * Get the data type with a certain name in the PLY header.
+	 * \param name The name of the type, such as "float" or "uint8".
+	 * \return The data type, or `UNKNOWN` if the name is not recognised.
+	 */
+	static Type parse_type(const std::string& name);
+
+	/*!
+	 * Get the number of bytes that a value of a certain data type occupies in
+	 * binary PLY files.
+	 * \param type The data type.
+	 * \return The size of that type in bytes.
+	 */
+	static size_t type_size(const Type type);
+
+	/*!
+	 * Read a binary value from the file and convert it to a double.
+	 * \param position Where in the file the value is stored.
+	 * \param type The data type of the value.
+	 * \param swap_bytes Whether the value is stored in the opposite endianness
+	 * of this computer.
+	 * \return The value that was stored there.
+	 */
+	static double read_value(const char* position, const Type type, const bool swap_bytes);
+
+	/*!
+	 * Read a number from the elements of an ASCII PLY file.
+	 *
+	 * The file is read where it is mapped, without copying all of it, so the
+	 * number doesn't need to be followed by a null terminator.
+	 * \param cursor Where to start reading, skipping any white space. This is
+	 * moved past the number.
+	 * \param end The end of the file.
+	 * \param value The number that was read.
+	 * \return `true` if a number was read, or `false` if the file ended or the
+	 * next word is not a number.
+	 */
+	static bool read_ascii_value(const char*& cursor, const char* end, double& value);
+
+	/*!
+	 * Convert a vertex index or list length that was read as a number to an
+	 * integer.
+	 *
+	 * Converting negative numbers, numbers that are too large and NaN to an
+	 * integer is undefined, so those become `size_t(-1)` instead.
+	 * \param value The number to convert.
+	 * \return The number as an integer, or `size_t(-1)` if it can't be one.
+	 */
+	static size_t to_size(const double value);
+};
+
+}
+
+#endif //PLY_HPP
\ No newline at end of file
@@ -0,0 +1,127 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef PREFETCHER_HPP
+#define PREFETCHER_HPP
+
+#include <condition_variable> //To wake up the threads when more files may be prefetched.
+#include <mutex> //To hand out files to the threads.
+#include <string> //To store file names.
+#include <thread> //To prefetch in the background.
+#include <vector> //To store the queue of files and the threads.
+
+namespace convertto3mf {
+
+/*!
+ * Loads the next few files of a queue into the page cache of the operating
+ * system in the background, while the current file is being converted.
+ *
+ * The importers map their input files into memory, so by the time a file is
+ * converted, its pages are already in memory and reading it doesn't stall on
+ * the disk. This matters most for cold files on network mounts or spinning
+ * disks, where opening and reading each file takes a long time.
+ *
+ * Each file is opened on a background thread and the operating system is asked
+ * to read all of it ahead. Only a limited number of files ahead of the current
+ * one are prefetched, so that they aren't evicted from the cache again before
+ * they are converted.
+ */
+class Prefetcher {
+public:
+	/*!
+	 * How many files ahead of the current one to prefetch by default.
+	 */
+	static constexpr size_t default_lookahead = 4;
+
+	/*!
+	 * Start prefetching the first files of a queue.
+	 * \param filenames The files that will be read, in order.
+	 * \param lookahead How many files ahead of the current one to prefetch.
+	 * This many threads are started to open and read them.
+	 */
+	Prefetcher(const std::vector<std::string>& filenames, const size_t lookahead = default_lookahead);
+
+	/*!
+	 * Stop prefetching, waiting for the files that are being prefetched.
+	 */
+	~Prefetcher();
+
+	//The threads refer to this instance, so it can't be copied.
+	Prefetcher(const Prefetcher& other) = delete;
+	Prefetcher& operator =(const Prefetcher& other) = delete;
+
+	/*!
+	 * Indicate that a file of the queue is being read now.
+	 *
+	 * The files up to that file are not prefetched any more, and more files
+	 * after it may be prefetched.
+	 * \param index The index of the file in the queue.
+	 */
+	void advance(const size_t index);
+
+	/*!
+	 * Ask the operating system to read a whole file into its cache.
+	 *
+	 * This returns once the reading has been started. It doesn't wait for the
+	 * data to arrive.
+	 * \param filename The file to read.
+	 */
+	static void prefetch(const std::string& filename);
+
+protected:
+	/*!
+	 * The files that will be read, in order.
+	 */
+	std::vector<std::string> filenames;
+
+	/*!
+	 * How many files ahead of the current one to prefetch.
+	 */
+	size_t lookahead;
+
+	/*!
+	 * The index of the next file to prefetch.
+	 */
+	size_t next;
+
+	/*!
+	 * Files are only prefetched if their index is below this limit.
+	 */
+	size_t limit;
+
+	/*!
+	 * Whether the threads must stop.
+	 */
+	bool stopping;
+
+	/*!
+	 * Protects the queue and the state of the threads.
+	 */
+	std::mutex mutex;
+
+	/*!
+	 * Wakes up the threads when they may prefetch more files, or must stop.
+	 */
+	std::condition_variable condition;
+
+	/*!
+	 * The threads that prefetch the files.
+	 */
+	std::vector<std::thread> threads;
+
+	/*!
+	 * Prefetch files from the queue until stopped.
+	 *
+	 * This is what each of the threads does.
+	 */
+	void work();
+};
+
+}
+
+#endif //PREFETCHER_HPP
\ No newline at end of file
@@ -0,0 +1,67 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef PREFIXED_BUFFER_HPP
+#define PREFIXED_BUFFER_HPP
+
+#include <streambuf> //To provide the data as a stream.
+#include <string> //To store the prefix.
+#include <vector> //To buffer the data from the source.
+
+namespace convertto3mf {
+
+/*!
+ * A stream buffer that first produces a prefix, and then continues with the
+ * rest of another stream.
+ *
+ * This is used for streams that can't seek back, such as the standard input.
+ * The start of such a stream can be read to detect the file type, and then be
+ * prepended again when the file is imported.
+ */
+class PrefixedBuffer : public std::streambuf {
+	public:
+	/*!
+	 * Create a stream buffer that produces a prefix before the rest of a
+	 * stream.
+	 * \param prefix The data to produce first.
+	 * \param source The stream buffer to continue with after the prefix. This
+	 * needs to stay valid for as long as this buffer is used.
+	 */
+	PrefixedBuffer(const std::string& prefix, std::streambuf& source);
+
+	protected:
+	/*!
+	 * The data to produce before the rest of the source.
+	 */
+	std::string prefix;
+
+	/*!
+	 * The stream buffer to continue with after the prefix.
+	 */
+	std::streambuf& source;
+
+	/*!
+	 * Whether the prefix has already been produced.
+	 */
+	bool prefix_done;
+
+	/*!
+	 * Blocks of data read from the source.
+	 */
+	std::vector<char> buffer;
+
+	/*!
+	 * Called when all available data has been read, to get more data.
+	 * \return The next character, or EOF if the source has ended.
+	 */
+	int_type underflow() override;
+};
+
+}
+
+#endif //PREFIXED_BUFFER_HPP
\ No newline at end of file
@@ -0,0 +1,155 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef PROBE_HPP
+#define PROBE_HPP
+
+#include <functional> //To visit the lines of text files.
+#include <string> //To accept file names and produce JSON.
+
+#include "detect_file_type.hpp" //To report the file type.
+#include "point3.hpp" //To store the bounding box.
+
+namespace convertto3mf {
+
+/*!
+ * A quick summary of a 3D model file, found without converting it.
+ *
+ * The importers only scan the file for these numbers, without building a
+ * model. This is much faster than converting the file, so it can be used to
+ * decide how to handle the file.
+ */
+class Probe {
+	public:
+	/*!
+	 * The type of file that was detected.
+	 */
+	FileType file_type = FileType::OBJ;
+
+	/*!
+	 * The size of the file, in bytes.
+	 */
+	size_t file_size = 0;
+
+	/*!
+	 * The number of triangles in the model, after splitting polygons into
+	 * triangles.
+	 */
+	size_t num_triangles = 0;
+
+	/*!
+	 * The number of vertices in the model.
+	 *
+	 * For formats that store each triangle with its own vertices, such as STL,
+	 * this is the number of vertices in the file, not the number of unique
+	 * vertices.
+	 */
+	size_t num_vertices = 0;
+
+	/*!
+	 * Whether the vertices are shared between triangles in the file, so that
+	 * the number of vertices is about the number of unique vertices.
+	 */
+	bool indexed = false;
+
+	/*!
+	 * Whether any vertex was found, so that the bounding box is valid.
+	 */
+	bool has_bounds = false;
+
+	/*!
+	 * The lowest coordinates of any vertex.
+	 */
+	Point3 minimum = Point3(0, 0, 0);
+
+	/*!
+	 * The highest coordinates of any vertex.
+	 */
+	Point3 maximum = Point3(0, 0, 0);
+
+	/*!
+	 * A function that looks at one line of a text file.
+	 *
+	 * The line is not null-terminated and doesn't include the line break. The
+	 * function may update the number of triangles, vertices and the bounding
+	 * box of the probe it gets.
+	 */
+	typedef std::function<void(const char* line, const size_t length, Probe& probe)> LineVisitor;
+
+	/*!
+	 * Probe a file on the file system.
+	 * \param filename The file to probe.
+	 * \return The summary of that file.
+	 */
+	static Probe probe(const std::string& filename);
+
+	/*!
+	 * Probe a file in memory.
+	 * \param data The contents of the file.
+	 * \param size The number of bytes in the file.
+	 * \param filename The name of the file, which helps to detect the file
+	 * type. This may be empty if the name is unknown.
+	 * \return The summary of that file.
+	 */
+	static Probe probe(const char* data, const size_t size, const std::string& filename);
+
+	/*!
+	 * Grow the bounding box to include a vertex.
+	 * \param vertex The vertex to include.
+	 */
+	void include(const Point3& vertex);
+
+	/*!
+	 * Add the numbers of another probe of a part of the same file.
+	 * \param other The probe of the other part.
+	 */
+	void include(const Probe& other);
+
+	/*!
+	 * Estimate how big the 3MF file will be after converting.
+	 *
+	 * This is a rough estimate, assuming typical compression of the 3D model.
+	 * \return The estimated size of the 3MF file, in bytes.
+	 */
+	size_t estimate_output_size() const;
+
+	/*!
+	 * Describe the probe as a JSON object on a single line.
+	 * \param filename The name of the file that was probed.
+	 * \return A JSON object with the file name, the file type, the size, the
+	 * number of triangles and vertices, the bounding box and the estimated
+	 * output size.
+	 */
+	std::string to_json(const std::string& filename) const;
+
+	/*!
+	 * Visit all lines of a text file in parallel.
+	 *
+	 * The file is divided into pieces at line breaks, which are scanned on
+	 * separate threads, each with their own probe. Those are combined into the
+	 * result afterwards.
+	 * \param data The text to visit the lines of.
+	 * \param size The number of bytes in the text.
+	 * \param visitor The function to call for each line.
+	 * \param result The probe to add the results of the visitor to.
+	 */
+	static void visit_lines(const char* data, const size_t size, const LineVisitor& visitor, Probe& result);
+
+	/*!
+	 * Read three coordinates from a line of text.
+	 * \param start Where the first coordinate starts.
+	 * \param end The end of the line.
+	 * \param vertex The coordinates are stored here.
+	 * \return `true` if three coordinates were found, or `false` if not.
+	 */
+	static bool parse_vertex(const char* start, const char* end, Point3& vertex);
+};
+
+}
+
+#endif //PROBE_HPP
\ No newline at end of file
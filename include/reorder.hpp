@@ -0,0 +1,94 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef REORDER_HPP
+#define REORDER_HPP
+
+#include <array> //To store triangles.
+#include <cstdint> //For fixed-width Morton codes.
+#include <vector> //To store lists of vertices and triangles.
+
+#include "point3.hpp" //To sort vertices by their position.
+
+namespace convertto3mf {
+
+/*!
+ * Collection of functions to reorder the vertices and triangles of a mesh for
+ * better locality.
+ *
+ * Vertices that are close together in space get stored close together in the
+ * list, and triangles that share vertices get stored close together too. This
+ * makes the output compress better, and helps the vertex caches of whatever
+ * loads the 3MF file later.
+ */
+class Reorder {
+public:
+	/*!
+	 * The number of vertices in the simulated vertex cache.
+	 */
+	static constexpr size_t cache_size = 16;
+
+	/*!
+	 * Reorder the vertices and triangles of a mesh.
+	 *
+	 * The vertices get sorted along a Morton curve, and then the triangles get
+	 * sorted for vertex cache locality.
+	 * \param vertices The vertices of the mesh. These get reordered in-place.
+	 * \param triangles The triangles of the mesh, referring to the vertices by
+	 * their index. These get reordered in-place, and the indices are adjusted
+	 * to the new order of the vertices.
+	 */
+	static void reorder(std::vector<Point3>& vertices, std::vector<std::array<size_t, 3>>& triangles);
+
+	/*!
+	 * Calculates the average cache miss ratio of a list of triangles.
+	 *
+	 * This simulates a FIFO vertex cache. The result is the number of cache
+	 * misses per triangle. This is between 0.5 for an ideal mesh and 3 for the
+	 * worst possible order.
+	 * \param triangles The triangles to calculate the ratio for.
+	 * \param num_vertices The number of vertices referred to by the triangles.
+	 * \return The average number of cache misses per triangle.
+	 */
+	static double average_cache_miss_ratio(const std::vector<std::array<size_t, 3>>& triangles, const size_t num_vertices);
+
+protected:
+	/*!
+	 * Sort the vertices of a mesh along a Morton curve (Z-order curve).
+	 * \param vertices The vertices of the mesh. These get reordered in-place.
+	 * \param triangles The triangles of the mesh. The indices in these
+	 * triangles get adjusted to the new order of the vertices.
+	 */
+	static void reorder_vertices(std::vector<Point3>& vertices, std::vector<std::array<size_t, 3>>& triangles);
+
+	/*!
+	 * Sort the triangles of a mesh for vertex cache locality.
+	 *
+	 * This uses the Tipsify algorithm by Sander, Nehab and Barczak, which runs
+	 * in linear time. It starts from the first vertex and keeps emitting the
+	 * triangles around vertices that are still in the cache.
+	 * \param triangles The triangles to reorder in-place.
+	 * \param num_vertices The number of vertices referred to by the triangles.
+	 */
+	static void reorder_triangles(std::vector<std::array<size_t, 3>>& triangles, const size_t num_vertices);
+
+	/*!
+	 * Spread out the lowest 21 bits of a number, so that there are two zero bits
+	 * in between every bit.
+	 *
+	 * This is used to interleave the bits of three coordinates into a Morton
+	 * code.
+	 * \param value The number to spread out.
+	 * \return The same bits, but spread out over 63 bits.
+	 */
+	static uint64_t spread_bits(uint64_t value);
+};
+
+}
+
+#endif //REORDER_HPP
\ No newline at end of file
@@ -0,0 +1,166 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef SIMPLIFY_HPP
+#define SIMPLIFY_HPP
+
+#include <array> //To store triangles.
+#include <vector> //To store lists of vertices and triangles.
+
+#include "point3.hpp" //To move vertices when collapsing edges.
+
+namespace convertto3mf {
+
+/*!
+ * Collection of functions to reduce the number of triangles of a mesh, while
+ * keeping its shape as much as possible.
+ *
+ * This uses the quadric error metric by Garland and Heckbert. Each vertex keeps
+ * the sum of the squared distances to the planes of the triangles around it,
+ * as a quadric. The edges are collapsed one by one into a single vertex, at the
+ * position where the sum of the quadrics of both ends is smallest, starting
+ * with the edges that change the shape least. The edges are kept in a priority
+ * queue by their cost. When an edge is collapsed, the costs of the edges around
+ * it change. Instead of updating those edges in the queue, they are pushed
+ * again with their new cost, and the old entries are skipped when they come up.
+ *
+ * Large meshes are divided into partitions of nearby triangles, which are
+ * simplified in parallel. The vertices on the borders between partitions are
+ * kept in place then, so that the partitions still fit together. If that
+ * doesn't remove enough triangles, the whole mesh is simplified further
+ * afterwards.
+ */
+class Simplify {
+public:
+	/*!
+	 * Meshes with more triangles than this are divided into partitions that are
+	 * simplified in parallel.
+	 */
+	static constexpr size_t partition_size = 65536;
+
+	/*!
+	 * How much the length of an edge adds to the cost of collapsing it, so that
+	 * of edges that change the shape equally little, the shortest one is
+	 * collapsed first.
+	 *
+	 * This is small enough that it only decides between edges in (nearly) flat
+	 * areas, where collapses cost nothing otherwise.
+	 */
+	static constexpr double tie_breaker_weight = 1e-6;
+
+	/*!
+	 * Reduce the number of triangles of a mesh.
+	 *
+	 * Edges are collapsed until the mesh has at most the target number of
+	 * triangles, or until no edge can be collapsed any more without flipping
+	 * triangles or tearing the mesh. The borders of holes in the mesh are kept
+	 * in place.
+	 * \param vertices The vertices of the mesh. These get moved, and the
+	 * vertices that are no longer used get removed.
+	 * \param triangles The triangles of the mesh, referring to the vertices by
+	 * their index. These get replaced by the simplified triangles.
+	 * \param target The number of triangles to reduce the mesh to.
+	 */
+	static void simplify(std::vector<Point3>& vertices, std::vector<std::array<size_t, 3>>& triangles, const size_t target);
+
+protected:
+	/*!
+	 * The sum of squared distances to a set of planes.
+	 *
+	 * This is stored as the upper half of the symmetric 4x4 matrix that
+	 * computes the sum for a point in homogeneous coordinates.
+	 */
+	struct Quadric {
+		/*!
+		 * The elements of the matrix: xx, xy, xz, xw, yy, yz, yw, zz, zw, ww.
+		 */
+		std::array<double, 10> elements = {};
+
+		/*!
+		 * Add the squared distance to a plane, scaled by a weight.
+		 * \param normal The normal of the plane, with length 1.
+		 * \param point A point on the plane.
+		 * \param weight How much the plane counts, for instance the area of
+		 * the triangle it came from.
+		 */
+		void add_plane(const Point3& normal, const Point3& point, const double weight);
+
+		/*!
+		 * Add another quadric to this one.
+		 * \param other The quadric to add.
+		 */
+		void add(const Quadric& other);
+
+		/*!
+		 * The sum of squared distances from a point to the planes.
+		 * \param point The point to measure from.
+		 * \return The error of moving a vertex to that point.
+		 */
+		double error(const Point3& point) const;
+
+		/*!
+		 * Find the point where the error is smallest.
+		 * \param optimum Is set to the point with the smallest error, if it is
+		 * well defined.
+		 * \return `true` if the point is well defined, or `false` if the planes
+		 * are (nearly) parallel, so that there is a line or plane of optimal
+		 * points.
+		 */
+		bool minimum(Point3& optimum) const;
+	};
+
+	/*!
+	 * Collapse edges in a mesh until it has at most the target number of
+	 * triangles.
+	 *
+	 * The collapsed triangles are removed from the list, but the vertices are
+	 * kept in the same place in the list, even if they are no longer used.
+	 * \param vertices The vertices of the mesh. These get moved.
+	 * \param triangles The triangles of the mesh. These get replaced by the
+	 * remaining triangles.
+	 * \param quadrics For each vertex, the quadric of the planes around it in
+	 * the original mesh. The quadrics of merged vertices get added up.
+	 * \param locked For each vertex, whether it must stay in place. Edges
+	 * between two locked vertices are not collapsed, and edges to a locked
+	 * vertex are collapsed into that vertex.
+	 * \param target The number of triangles to reduce the mesh to.
+	 */
+	static void collapse_edges(std::vector<Point3>& vertices, std::vector<std::array<size_t, 3>>& triangles, std::vector<Quadric>& quadrics, std::vector<bool> locked, const size_t target);
+
+	/*!
+	 * Compute the quadric of each vertex: The planes of the triangles around
+	 * it, weighted by their area.
+	 * \param vertices The vertices of the mesh.
+	 * \param triangles The triangles of the mesh.
+	 * \return For each vertex, its quadric.
+	 */
+	static std::vector<Quadric> compute_quadrics(const std::vector<Point3>& vertices, const std::vector<std::array<size_t, 3>>& triangles);
+
+	/*!
+	 * Divide the triangles of a mesh into partitions of nearby triangles.
+	 *
+	 * The bounding box of the triangles is split in half repeatedly at the
+	 * median along its longest side, until the partitions are small enough.
+	 * \param vertices The vertices of the mesh.
+	 * \param triangles The triangles of the mesh.
+	 * \return For each partition, the indices of its triangles.
+	 */
+	static std::vector<std::vector<size_t>> partition(const std::vector<Point3>& vertices, const std::vector<std::array<size_t, 3>>& triangles);
+
+	/*!
+	 * Remove the vertices that no triangle refers to any more.
+	 * \param vertices The vertices of the mesh. The unused ones get removed.
+	 * \param triangles The triangles of the mesh. Their indices get adjusted
+	 * to the new positions of the vertices.
+	 */
+	static void remove_unused_vertices(std::vector<Point3>& vertices, std::vector<std::array<size_t, 3>>& triangles);
+};
+
+}
+
+#endif //SIMPLIFY_HPP
\ No newline at end of file
@@ -9,7 +9,11 @@
 #ifndef STL_ASCII_HPP
 #define STL_ASCII_HPP
 
+#include <istream> //To read ASCII STL files from streams.
+
 #include "model.hpp" //To convert ASCII STLs into our internal model representation.
+#include "monitor.hpp" //To report progress while importing.
+#include "probe.hpp" //To summarise files without converting them.
 
 namespace convertto3mf {
 
@@ -20,18 +24,50 @@ class StlAscii {
 	public:
 	/*!
 	 * Determines the likelihood of this file being an ASCII STL file.
-	 * \param filename The name of the file to check.
+	 * \param filename The name of the file to check. This may be empty if the
+	 * name of the file is unknown.
+	 * \param sample The first bytes of the file, up to 1kB.
 	 * \return The likelihood of this file being an ASCII STL file. This is a
 	 * rather arbitrary guess of probability between 0 and 1.
 	 */
-	static float is_stl_ascii(const std::string& filename);
+	static float is_stl_ascii(const std::string& filename, const std::string& sample);
 
 	/*!
 	 * Read an ASCII STL file, storing it in memory as a `Model` instance.
+	 * \param filename The ASCII STL file to read.
+	 * \param monitor Reports how far the import got, and aborts it if the
+	 * conversion is cancelled. This may be `nullptr`.
+	 */
+	static Model import(const std::string& filename, Monitor* monitor = nullptr);
+
+	/*!
+	 * Read an ASCII STL file from a stream, storing it in memory as a `Model`
+	 * instance.
+	 * \param stream The stream providing the contents of the STL file.
+	 * \param monitor Reports how far the import got, and aborts it if the
+	 * conversion is cancelled. This may be `nullptr`.
 	 */
-	static Model import(const std::string& filename);
+	static Model import(std::istream& stream, Monitor* monitor = nullptr);
+
+	/*!
+	 * Find the number of triangles and the bounding box of an ASCII STL file
+	 * in memory, without building a model.
+	 *
+	 * The lines of the file are scanned in parallel. Only the coordinates of
+	 * the vertices are parsed.
+	 * \param data The contents of the ASCII STL file.
+	 * \param size The number of bytes in the ASCII STL file.
+	 * \param result The probe to store the numbers in.
+	 */
+	static void probe(const char* data, const size_t size, Probe& result);
 
 	protected:
+	/*!
+	 * Reports how far the import got, and aborts it if the conversion is
+	 * cancelled, or `nullptr` if nothing needs to be reported.
+	 */
+	Monitor* monitor = nullptr;
+
 	/*!
 	 * Data structure for an ASCII STL file.
 	 *
@@ -45,8 +81,9 @@ class StlAscii {
 
 	/*!
 	 * Read the contents of an ASCII STL file and load it into this instance.
+	 * \param stream The stream to read the file from.
 	 */
-	void load(const std::string& filename);
+	void load(std::istream& stream);
 
 	/*!
 	 * Convert the STL-specific representation into the common 3D model
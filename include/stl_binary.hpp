@@ -12,6 +12,8 @@
 #include <string> //To accept filenames.
 
 #include "model.hpp" //To construct 3D models from the file.
+#include "monitor.hpp" //To report progress while importing.
+#include "probe.hpp" //To summarise files without converting them.
 
 namespace convertto3mf {
 
@@ -22,18 +24,57 @@ class StlBinary {
 	public:
 	/*!
 	 * Determines the likelihood of this file being a binary STL file.
-	 * \param filename The name of the file to check.
+	 * \param filename The name of the file to check. This may be empty if the
+	 * name of the file is unknown.
+	 * \param sample The first bytes of the file, up to 1kB.
+	 * \param file_size The total size of the file, in bytes, or
+	 * `unknown_file_size` if it is not known.
 	 * \return The likelihood of this file being a binary STL file. This is a
 	 * rather arbitrary guess of probability between 0 and 1.
 	 */
-	static float is_stl_binary(const std::string& filename);
+	static float is_stl_binary(const std::string& filename, const std::string& sample, const size_t file_size);
 
 	/*!
 	 * Read a binary STL file, storing it in memory as a `Model` instance.
+	 * \param filename The binary STL file to read.
+	 * \param monitor Reports how far the import got, and aborts it if the
+	 * conversion is cancelled. This may be `nullptr`.
 	 */
-	static Model import(const std::string& filename);
+	static Model import(const std::string& filename, Monitor* monitor = nullptr);
+
+	/*!
+	 * Read a binary STL file from memory, storing it as a `Model` instance.
+	 * \param data The contents of the STL file.
+	 * \param size The number of bytes in the STL file.
+	 * \param monitor Reports how far the import got, and aborts it if the
+	 * conversion is cancelled. This may be `nullptr`.
+	 */
+	static Model import(const char* data, const size_t size, Monitor* monitor = nullptr);
+
+	/*!
+	 * Find the number of triangles and the bounding box of a binary STL file
+	 * in memory, without building a model.
+	 *
+	 * The number of triangles is read from the header. The bounding box is
+	 * found by unpacking the triangles in parallel.
+	 * \param data The contents of the binary STL file.
+	 * \param size The number of bytes in the binary STL file.
+	 * \param result The probe to store the numbers in.
+	 */
+	static void probe(const char* data, const size_t size, Probe& result);
 
 	protected:
+	/*!
+	 * The number of triangles to unpack at a time.
+	 */
+	static constexpr size_t batch_size = 4096;
+
+	/*!
+	 * Reports how far the import got, and aborts it if the conversion is
+	 * cancelled, or `nullptr` if nothing needs to be reported.
+	 */
+	Monitor* monitor = nullptr;
+
 	/*!
 	 * All of the triangles stored in this STL file.
 	 */
@@ -41,8 +82,10 @@ class StlBinary {
 
 	/*!
 	 * Read the contents of a binary STL file and load it into this instance.
+	 * \param data The contents of the STL file.
+	 * \param size The number of bytes in the STL file.
 	 */
-	void load(const std::string& filename);
+	void load(const char* data, const size_t size);
 
 	/*!
 	 * Convert the STL-specific representation into the common 3D model
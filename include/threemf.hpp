@@ -10,11 +10,14 @@
 #define THREEMF_HPP
 
 #include <array> //To store triangles.
+#include <cstdio> //To write the 3MF file to an open file.
+#include <functional> //To write the 3MF file to a callback.
 #include <sstream> //A buffer to write the 3D model data into before zipping it.
 #include <string> //To accept a file name.
-#include <zip.h> //To write zip archives to file, part of the format of 3MF.
 
 #include "model.hpp" //To convert from 3D models.
+#include "options.hpp" //To change how the 3MF file is written.
+#include "zip_writer.hpp" //To write zip archives, part of the format of 3MF.
 
 namespace convertto3mf {
 
@@ -30,10 +33,54 @@ public:
 	 * Writes a model to a file in the 3MF format.
 	 * \param filename The path to the file to write.
 	 * \param model The model to write to this file.
+	 * \param options Settings for how to write the file.
+	 * \throws std::runtime_error The file could not be written.
 	 */
-	static void export_to_file(const std::string& filename, const Model& model);
+	static void export_to_file(const std::string& filename, const Model& model, const Options& options = Options());
+
+	/*!
+	 * Writes a model in the 3MF format to a callback.
+	 *
+	 * This is useful to produce 3MF files without storing them on the file
+	 * system.
+	 * \param model The model to write.
+	 * \param options Settings for how to write the file.
+	 * \param output A function that gets called with consecutive blocks of
+	 * the 3MF file, in order, until the whole file is written.
+	 */
+	static void export_to_callback(const Model& model, const Options& options, const std::function<void(const char*, size_t)>& output);
+
+	/*!
+	 * Estimate how big the serialised data of one mesh is in the 3D model
+	 * file, before compression.
+	 * \param num_vertices The number of unique vertices in the mesh.
+	 * \param num_triangles The number of triangles in the mesh.
+	 * \param precision The number of significant digits of the coordinates.
+	 * \return The approximate size of the mesh in the 3D model file, in bytes.
+	 */
+	static size_t estimate_mesh_size(const size_t num_vertices, const size_t num_triangles, const size_t precision);
+
+	/*!
+	 * Whether the triangles of the meshes need to be in memory before writing
+	 * them, because the options require processing them.
+	 * \param options The settings for how to write the file.
+	 * \return `true` if all triangles need to be produced before writing, or
+	 * `false` if they may be produced on demand.
+	 */
+	static bool needs_all_triangles(const Options& options);
 
 protected:
+	/*!
+	 * The number of vertices or triangles to serialise in one chunk of the 3D
+	 * model file.
+	 */
+	static constexpr size_t chunk_size = 65536;
+
+	/*!
+	 * The settings for how to write the file.
+	 */
+	Options options;
+
 	/*!
 	 * For each mesh, a list of vertices.
 	 *
@@ -52,27 +99,281 @@ protected:
 	 */
 	std::vector<std::vector<std::array<size_t, 3>>> triangles;
 
+	/*!
+	 * For each mesh, the name to give its object, or an empty string if it
+	 * has no name.
+	 */
+	std::vector<std::string> names;
+
+	/*!
+	 * For each mesh, functions that produce more of its triangles on demand,
+	 * while the 3D model is being written.
+	 *
+	 * These triangles come after the `triangles` of the mesh. They are only
+	 * kept as functions if nothing needs to process the triangles before
+	 * writing them.
+	 */
+	std::vector<std::vector<Mesh::TriangleBatch>> triangle_batches;
+
+	/*!
+	 * An item in the build plate, placing one of the meshes.
+	 */
+	struct BuildItem {
+		/*!
+		 * The index of the mesh to place.
+		 */
+		size_t mesh_index;
+
+		/*!
+		 * How far to move the mesh from its original position.
+		 */
+		Point3 translation;
+	};
+
+	/*!
+	 * The items to build.
+	 *
+	 * Normally each mesh gets built once, without moving it. If there are
+	 * multiple copies of the same mesh, the mesh may be stored only once and
+	 * be placed multiple times.
+	 */
+	std::vector<BuildItem> items;
+
+	/*!
+	 * When quantising, the number of decimals needed to write multiples of the
+	 * grid size exactly.
+	 */
+	size_t quantize_decimals;
+
+	/*!
+	 * Construct an empty 3MF file.
+	 * \param options Settings for how to write the file.
+	 */
+	ThreeMF(const Options& options);
+
 	/*!
 	 * Fill the 3MF file from the common model data structure.
+	 *
+	 * The meshes are converted in parallel.
 	 */
 	void fill_from_model(const Model& model);
 
+	/*!
+	 * Fill the vertices and triangles of one mesh in the 3MF file.
+	 *
+	 * This makes the vertices of the mesh unique and converts the faces to
+	 * triangles referring to those vertices.
+	 * \param mesh The mesh from the common model data structure.
+	 * \param mesh_index The index of the mesh in the 3MF file to fill. The
+	 * lists of vertices and triangles must already contain an empty entry for
+	 * this mesh.
+	 */
+	void fill_from_mesh(const Mesh& mesh, const size_t mesh_index);
+
+	/*!
+	 * Snap a vertex to the grid, if quantising.
+	 * \param vertex The vertex to snap.
+	 * \return The nearest point on the grid, or the vertex itself if not
+	 * quantising.
+	 */
+	Point3 snap(const Point3& vertex) const;
+
+	/*!
+	 * Split every mesh into its connected components, making each component a
+	 * separate mesh.
+	 *
+	 * The components keep the name of the mesh they came from.
+	 */
+	void split_components();
+
+	/*!
+	 * Find meshes that are identical except for their position, and store them
+	 * only once.
+	 *
+	 * The copies are removed from the meshes, and instead the build items
+	 * place the original mesh multiple times, with a translation.
+	 *
+	 * To find the copies quickly, a fingerprint is made of each mesh that
+	 * doesn't depend on its position. Only meshes with the same fingerprint
+	 * are compared in detail.
+	 */
+	void find_instances();
+
+	/*!
+	 * Calculate a fingerprint of a mesh, which is the same for meshes that are
+	 * identical apart from their position.
+	 *
+	 * Meshes with different fingerprints are never identical, but meshes with
+	 * the same fingerprint still need to be compared to see if they are.
+	 * \param mesh_index The mesh to calculate the fingerprint of.
+	 * \return A hash of the shape of the mesh.
+	 */
+	size_t fingerprint(const size_t mesh_index) const;
+
+	/*!
+	 * Checks whether a mesh is a translated copy of another mesh.
+	 * \param original_index The mesh that may have been copied.
+	 * \param copy_index The mesh that may be a copy.
+	 * \return `true` if the meshes are identical apart from their position, or
+	 * `false` if they aren't.
+	 */
+	bool is_translated_copy(const size_t original_index, const size_t copy_index) const;
+
 	/*!
 	 * Write the 3MF file to a file.
+	 *
+	 * The archive is written to a temporary file in the same directory, which
+	 * only replaces the file once it's complete and synced to disk. If writing
+	 * fails or the conversion is cancelled, any existing file stays unchanged.
+	 * Devices and pipes are written to directly.
 	 * \param filename The path to the file to write.
+	 * \throws std::runtime_error The file could not be written.
 	 */
 	void write(const std::string& filename) const;
 
 	/*!
-	 * Write the 3D model data to a string stream.
+	 * Write the 3MF file to an open file, sync it to disk and close it.
+	 * \param file The file to write to. It gets closed, also if writing fails.
+	 * \param filename The path to the file, to report errors.
+	 * \throws std::runtime_error The file could not be written.
+	 */
+	void write_to_file(std::FILE* file, const std::string& filename) const;
+
+	/*!
+	 * Write the 3MF file to a callback.
+	 * \param output A function that gets called with consecutive blocks of
+	 * the 3MF file, in order, until the whole file is written.
+	 */
+	void write(const std::function<void(const char*, size_t)>& output) const;
+
+	/*!
+	 * Write the contents of the 3MF file into a zip archive, and close the
+	 * archive.
+	 * \param archive The archive to write to.
+	 */
+	void write_archive(ZipWriter& archive) const;
+
+	/*!
+	 * Divide the 3D model data into chunks that can be serialised separately.
 	 *
-	 * This serialises the contents of this `ThreeMF` instance into a stream.
-	 * The archive can then later read out the contents of this stream to
-	 * compress it into the archive. This way the data does not get deallocated
-	 * before the zip archive is closed.
+	 * Each chunk serialises a limited number of vertices or triangles, so that
+	 * the chunks can be serialised in parallel, and so that the model doesn't
+	 * need to be in memory all at once. Concatenated in order, the chunks form
+	 * the 3D model file.
+	 * \return Functions that serialise the consecutive chunks of the 3D model.
+	 * These refer to this `ThreeMF` instance, so they may only be called while
+	 * it exists.
+	 */
+	std::vector<ZipWriter::Chunk> model_chunks() const;
+
+	/*!
+	 * Let a chunk of the 3D model report to the monitor how much it wrote, if
+	 * there is a monitor.
+	 * \param chunk The chunk to report the progress of.
+	 * \param num_triangles How many triangles the chunk writes.
+	 * \return A chunk that writes the same data, and then reports it.
+	 */
+	ZipWriter::Chunk monitored(ZipWriter::Chunk&& chunk, const size_t num_triangles) const;
+
+	/*!
+	 * Write the root 3D model to a string stream, referring to parts stored in
+	 * separate files.
+	 *
+	 * This is used when splitting the meshes into parts. Each mesh becomes an
+	 * object consisting of components, which refer to the objects in the parts
+	 * using the 3MF Production extension.
 	 * \param model_data An empty string stream to write into.
+	 * \param part_paths For each mesh, the paths to the parts containing the
+	 * triangles of that mesh.
+	 */
+	void write_root_model_data(std::stringstream& model_data, const std::vector<std::vector<std::string>>& part_paths) const;
+
+	/*!
+	 * Divide a model part into chunks that can be serialised separately. The
+	 * part contains a single object with a range of the triangles of a mesh.
+	 *
+	 * Only the vertices that are used by these triangles are written. If not
+	 * all triangles are written, the indices of the triangles are adjusted to
+	 * refer to the written vertices. Like the chunks of the 3D model without
+	 * parts, each chunk serialises a limited number of vertices or triangles.
+	 * \param mesh_index The mesh to write triangles of.
+	 * \param triangles_begin The first triangle to write.
+	 * \param triangles_end The end of the range of triangles to write. This
+	 * triangle itself is not written.
+	 * \return Functions that serialise the consecutive chunks of the part.
+	 * These refer to this `ThreeMF` instance, so they may only be called while
+	 * it exists.
+	 */
+	std::vector<ZipWriter::Chunk> part_chunks(const size_t mesh_index, const size_t triangles_begin, const size_t triangles_end) const;
+
+	/*!
+	 * Write a range of the vertices of a mesh.
+	 * \param model_data The stream to write into.
+	 * \param mesh_index The mesh to write vertices of.
+	 * \param vertices_begin The first vertex to write.
+	 * \param vertices_end The end of the range of vertices to write. This
+	 * vertex itself is not written.
+	 */
+	void write_vertices(std::ostream& model_data, const size_t mesh_index, const size_t vertices_begin, const size_t vertices_end) const;
+
+	/*!
+	 * Write one vertex.
+	 *
+	 * When quantising, the coordinates are written exactly with the fewest
+	 * decimals. Otherwise they are written with the precision of the stream.
+	 * \param model_data The stream to write into.
+	 * \param vertex The vertex to write.
+	 */
+	void write_vertex(std::ostream& model_data, const Point3& vertex) const;
+
+	/*!
+	 * Format a number as decimal, given as a whole number of a fraction of a
+	 * millimetre, without trailing zeroes.
+	 * \param buffer The buffer to write into. This must have room for at least
+	 * 32 characters.
+	 * \param value The number, multiplied by 10 to the power of `decimals`.
+	 * \param decimals The number of decimals in the value.
+	 * \return The number of characters written.
+	 */
+	static size_t format_fixed(char* buffer, long long value, const size_t decimals);
+
+	/*!
+	 * Write a range of triangles, without changing the indices of their
+	 * vertices.
+	 * \param model_data The stream to write into.
+	 * \param triangles The triangles to write a range of.
+	 * \param triangles_begin The first triangle to write.
+	 * \param triangles_end The end of the range of triangles to write. This
+	 * triangle itself is not written.
+	 */
+	static void write_triangles(std::ostream& model_data, const std::vector<std::array<size_t, 3>>& triangles, const size_t triangles_begin, const size_t triangles_end);
+
+	/*!
+	 * Create a new random universally unique identifier.
+	 *
+	 * The 3MF Production extension requires these to identify objects,
+	 * components and build items.
+	 * \return A version 4 UUID, formatted as string.
+	 */
+	static std::string generate_uuid();
+
+	/*!
+	 * Write the attributes of a build item.
+	 *
+	 * This refers to the object of the mesh to build, and moves it if
+	 * necessary. The translation is written with enough digits to be exact.
+	 * \param model_data The stream to write into.
+	 * \param item The build item to write.
+	 */
+	static void write_item_attributes(std::ostream& model_data, const BuildItem& item);
+
+	/*!
+	 * Write the name attribute of the object of a mesh, if the mesh has a
+	 * name.
+	 * \param model_data The stream to write into.
+	 * \param mesh_index The mesh to write the name of.
 	 */
-	void write_model_data(std::stringstream& model_data) const;
+	void write_name_attribute(std::ostream& model_data, const size_t mesh_index) const;
 };
 
 }
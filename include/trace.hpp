@@ -0,0 +1,248 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic> //To check cheaply whether recording is on.
+#include <chrono> //To measure the duration of spans.
+#include <cstdint> //For fixed-size timestamps.
+#include <map> //To keep the spans of threads that ended.
+#include <mutex> //To register threads from multiple threads at the same time.
+#include <set> //To reuse the identifiers of threads that ended.
+#include <string> //To write the trace to a file.
+#include <vector> //To store recorded events.
+
+namespace convertto3mf {
+
+/*!
+ * Records how long each stage of a conversion takes on each thread, to write
+ * it as a trace in the Chrome trace event format.
+ *
+ * The trace can be viewed in Chrome's about:tracing page or in Perfetto. It
+ * shows where the worker threads spend their time, and where they wait.
+ *
+ * Recording is off until `start` is called. While it's off, spans cost only a
+ * single check. While it's on, each thread records its spans in its own list,
+ * so the threads don't need to wait on each other. Only writing the trace
+ * waits for each thread to finish recording its current span.
+ *
+ * Recording should be started and written once for all work that is traced,
+ * such as once for a whole batch of conversions, so that the trace contains
+ * every thread that worked on it.
+ */
+class Trace {
+public:
+	/*!
+	 * A stage of the conversion that is being measured.
+	 *
+	 * The span starts when it's constructed and ends when it's destroyed. If
+	 * recording is off, nothing is recorded.
+	 */
+	class Span {
+	public:
+		/*!
+		 * Start measuring a stage.
+		 * \param name The name of the stage. This must be a string literal, or
+		 * at least live until the trace is written.
+		 */
+		Span(const char* name);
+
+		/*!
+		 * Stop measuring the stage and record it.
+		 */
+		~Span();
+
+		/*!
+		 * Indicate how many bytes were processed in this stage.
+		 * \param bytes The number of bytes.
+		 */
+		void set_bytes(const size_t bytes);
+
+		/*!
+		 * Indicate how many items, such as vertices or triangles, were
+		 * processed in this stage.
+		 * \param items The number of items.
+		 */
+		void set_items(const size_t items);
+
+	protected:
+		/*!
+		 * The name of the stage.
+		 */
+		const char* name;
+
+		/*!
+		 * When the stage started.
+		 */
+		std::chrono::steady_clock::time_point start;
+
+		/*!
+		 * Whether recording was on when the stage started.
+		 */
+		bool enabled;
+
+		/*!
+		 * The number of bytes processed in this stage.
+		 */
+		size_t bytes;
+
+		/*!
+		 * The number of items processed in this stage.
+		 */
+		size_t items;
+	};
+
+	/*!
+	 * Start recording spans.
+	 *
+	 * Any spans that were recorded before are discarded. This is safe to call
+	 * while other threads are recording spans.
+	 */
+	static void start();
+
+	/*!
+	 * Stop recording spans, and write the recorded spans to a file.
+	 *
+	 * This is safe to call while other threads are recording spans. Spans that
+	 * end after this are not recorded.
+	 * \param filename The file to write the trace to, as JSON.
+	 */
+	static void write(const std::string& filename);
+
+protected:
+	/*!
+	 * One span that was recorded.
+	 */
+	struct Event {
+		/*!
+		 * The name of the stage.
+		 */
+		const char* name;
+
+		/*!
+		 * When the stage started, in microseconds since recording started.
+		 */
+		int64_t start;
+
+		/*!
+		 * How long the stage took, in microseconds.
+		 */
+		int64_t duration;
+
+		/*!
+		 * The number of bytes processed in this stage.
+		 */
+		size_t bytes;
+
+		/*!
+		 * The number of items processed in this stage.
+		 */
+		size_t items;
+	};
+
+	/*!
+	 * The spans recorded by one thread.
+	 */
+	struct ThreadEvents {
+		/*!
+		 * A number identifying the thread in the trace.
+		 *
+		 * When a thread ends, its number is given to the next thread that
+		 * starts recording. Worker threads that are started anew for each
+		 * parallel loop then keep appearing as the same few threads in the
+		 * trace.
+		 */
+		size_t thread_id;
+
+		/*!
+		 * The spans recorded by this thread.
+		 */
+		std::vector<Event> events;
+
+		/*!
+		 * Protects the spans of this thread, so that they can be written or
+		 * discarded while the thread is recording.
+		 */
+		std::mutex mutex;
+	};
+
+	/*!
+	 * Whether spans are being recorded.
+	 */
+	static std::atomic<bool> recording;
+
+	/*!
+	 * When recording started, as the time since the epoch of the steady clock.
+	 * Spans are recorded relative to this.
+	 */
+	static std::atomic<std::chrono::steady_clock::rep> recording_start;
+
+	/*!
+	 * Owns the spans of the current thread, and hands them over to the trace
+	 * when the thread ends.
+	 */
+	struct ThreadOwner {
+		/*!
+		 * The spans of this thread, or `nullptr` if it hasn't recorded anything
+		 * yet.
+		 */
+		ThreadEvents* events = nullptr;
+
+		/*!
+		 * Move the spans of the thread to the spans of ended threads, and free
+		 * its list.
+		 */
+		~ThreadOwner();
+	};
+
+	/*!
+	 * Protects the lists of threads and of the spans of ended threads.
+	 */
+	static std::mutex threads_mutex;
+
+	/*!
+	 * The spans of every running thread that recorded something.
+	 *
+	 * Each thread removes its own list when it ends.
+	 */
+	static std::vector<ThreadEvents*> threads;
+
+	/*!
+	 * The spans of threads that ended since recording started, by the number
+	 * of the thread in the trace.
+	 */
+	static std::map<size_t, std::vector<Event>> ended_threads;
+
+	/*!
+	 * Numbers of threads that ended, to give to the next threads that start
+	 * recording.
+	 */
+	static std::set<size_t> free_thread_ids;
+
+	/*!
+	 * Get the list of spans of the current thread, creating it if this thread
+	 * hasn't recorded anything yet.
+	 * \return The spans recorded by the current thread.
+	 */
+	static ThreadEvents& thread_events();
+
+	/*!
+	 * Record a finished span.
+	 * \param name The name of the stage.
+	 * \param start When the stage started.
+	 * \param end When the stage ended.
+	 * \param bytes The number of bytes processed in this stage.
+	 * \param items The number of items processed in this stage.
+	 */
+	static void record(const char* name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const size_t bytes, const size_t items);
+};
+
+}
+
+#endif //TRACE_HPP
\ No newline at end of file
@@ -0,0 +1,130 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef UNPACK_HPP
+#define UNPACK_HPP
+
+#include <cstddef> //For size_t.
+
+#include "coordinate.hpp" //To output coordinates.
+
+namespace convertto3mf {
+
+/*!
+ * Collection of functions to unpack triangles stored as 32-bit floats in
+ * fixed-size records, such as in binary STL files.
+ *
+ * There are multiple implementations of this, using different sets of vector
+ * instructions. The best one that the processor supports is chosen at run
+ * time. There is always a portable scalar implementation to fall back on.
+ */
+class Unpack {
+public:
+	/*!
+	 * The sets of instructions that the triangles can be unpacked with.
+	 */
+	enum Instructions {
+		SCALAR,
+		SSE2,
+		AVX2,
+		AVX512
+	};
+
+	/*!
+	 * Unpack the vertices of a number of triangles.
+	 *
+	 * Each record must contain the nine coordinates of a triangle at its start,
+	 * as consecutive little-endian 32-bit floats: X, Y and Z of the first
+	 * vertex, then of the second and the third vertex.
+	 * \param records The first record to unpack.
+	 * \param stride The distance between the starts of two records, in bytes.
+	 * \param count The number of records to unpack.
+	 * \param output The array to store the coordinates in. It must have room
+	 * for nine coordinates per record, which are stored in the same order.
+	 */
+	static void unpack_triangles(const char* records, const size_t stride, const size_t count, coord_t* output);
+
+	/*!
+	 * Unpack the vertices of a number of triangles with a specific set of
+	 * instructions.
+	 *
+	 * This is mostly useful to compare the implementations to each other. The
+	 * processor must support the instructions.
+	 * \param instructions The set of instructions to use.
+	 * \param records The first record to unpack.
+	 * \param stride The distance between the starts of two records, in bytes.
+	 * \param count The number of records to unpack.
+	 * \param output The array to store the coordinates in.
+	 */
+	static void unpack_triangles(const Instructions instructions, const char* records, const size_t stride, const size_t count, coord_t* output);
+
+	/*!
+	 * Checks whether the processor supports a set of instructions.
+	 * \param instructions The set of instructions to check.
+	 * \return `true` if the triangles can be unpacked with these
+	 * instructions, or `false` if they can't.
+	 */
+	static bool is_supported(const Instructions instructions);
+
+	/*!
+	 * Find the fastest set of instructions that the processor supports.
+	 * \return The set of instructions to unpack triangles with.
+	 */
+	static Instructions best_supported();
+
+	/*!
+	 * Get a name for a set of instructions, to show to the user.
+	 * \param instructions The set of instructions to get the name of.
+	 * \return The name of the set of instructions.
+	 */
+	static const char* name(const Instructions instructions);
+
+protected:
+	/*!
+	 * Unpack triangles one coordinate at a time, without vector instructions.
+	 * \param records The first record to unpack.
+	 * \param stride The distance between the starts of two records, in bytes.
+	 * \param count The number of records to unpack.
+	 * \param output The array to store the coordinates in.
+	 */
+	static void unpack_scalar(const char* records, const size_t stride, const size_t count, coord_t* output);
+
+	/*!
+	 * Unpack triangles with SSE2 instructions, widening two coordinates at a
+	 * time.
+	 * \param records The first record to unpack.
+	 * \param stride The distance between the starts of two records, in bytes.
+	 * \param count The number of records to unpack.
+	 * \param output The array to store the coordinates in.
+	 */
+	static void unpack_sse2(const char* records, const size_t stride, const size_t count, coord_t* output);
+
+	/*!
+	 * Unpack triangles with AVX2 instructions, widening four coordinates at a
+	 * time.
+	 * \param records The first record to unpack.
+	 * \param stride The distance between the starts of two records, in bytes.
+	 * \param count The number of records to unpack.
+	 * \param output The array to store the coordinates in.
+	 */
+	static void unpack_avx2(const char* records, const size_t stride, const size_t count, coord_t* output);
+
+	/*!
+	 * Unpack triangles with AVX-512 instructions, widening eight coordinates at
+	 * a time.
+	 * \param records The first record to unpack.
+	 * \param stride The distance between the starts of two records, in bytes.
+	 * \param count The number of records to unpack.
+	 * \param output The array to store the coordinates in.
+	 */
+	static void unpack_avx512(const char* records, const size_t stride, const size_t count, coord_t* output);
+};
+
+}
+
+#endif //UNPACK_HPP
\ No newline at end of file
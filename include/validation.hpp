@@ -0,0 +1,175 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef VALIDATION_HPP
+#define VALIDATION_HPP
+
+#include <array> //To store triangles.
+#include <ostream> //To report the problems.
+#include <vector> //To store lists of vertices, triangles and problems.
+
+#include "point3.hpp" //To locate the problems.
+
+namespace convertto3mf {
+
+/*!
+ * Checks whether meshes are closed and consistently oriented, and counts the
+ * problems that prevent that.
+ *
+ * The edges of all triangles are sorted, so that the triangles sharing an
+ * edge end up next to each other. In a closed, consistently oriented mesh,
+ * each edge is shared by exactly two triangles, which traverse it in opposite
+ * directions. The edges are divided over buckets by their first vertex, and
+ * the buckets are sorted in parallel.
+ */
+class Validation {
+public:
+	/*!
+	 * A problem at a specific place in the model.
+	 */
+	struct Problem {
+		/*!
+		 * The index of the mesh that has the problem.
+		 */
+		size_t mesh_index;
+
+		/*!
+		 * Where the problem is: The middle of the edge, or the first vertex
+		 * of the triangle.
+		 */
+		Point3 location;
+	};
+
+	/*!
+	 * The maximum number of problems of each kind to keep as samples.
+	 */
+	static constexpr size_t max_samples = 5;
+
+	/*!
+	 * The number of triangles that were checked.
+	 */
+	size_t num_triangles = 0;
+
+	/*!
+	 * The number of triangles without area: Triangles that use the same vertex
+	 * twice, or whose vertices are on one line.
+	 */
+	size_t degenerate_triangles = 0;
+
+	/*!
+	 * The number of edges that are shared by more than two triangles.
+	 */
+	size_t non_manifold_edges = 0;
+
+	/*!
+	 * The number of edges shared by two triangles that traverse it in the same
+	 * direction, meaning that one of the triangles is flipped.
+	 */
+	size_t flipped_edges = 0;
+
+	/*!
+	 * The number of edges of only one triangle, which border on a hole.
+	 */
+	size_t boundary_edges = 0;
+
+	/*!
+	 * The first few degenerate triangles.
+	 */
+	std::vector<Problem> degenerate_samples;
+
+	/*!
+	 * The first few non-manifold edges.
+	 */
+	std::vector<Problem> non_manifold_samples;
+
+	/*!
+	 * The first few edges of flipped triangles.
+	 */
+	std::vector<Problem> flipped_samples;
+
+	/*!
+	 * The first few edges bordering on holes.
+	 */
+	std::vector<Problem> boundary_samples;
+
+	/*!
+	 * Check one mesh for problems.
+	 * \param vertices The vertices of the mesh.
+	 * \param triangles The triangles of the mesh, referring to the indices of
+	 * the vertices. The indices must be valid.
+	 * \param mesh_index The index of the mesh, to report with the problems.
+	 * \return The problems found in the mesh.
+	 */
+	static Validation validate(const std::vector<Point3>& vertices, const std::vector<std::array<size_t, 3>>& triangles, const size_t mesh_index);
+
+	/*!
+	 * Add the problems of another mesh to these.
+	 * \param other The problems of another mesh.
+	 */
+	void include(const Validation& other);
+
+	/*!
+	 * Whether no problems were found.
+	 * \return `true` if all meshes are closed and consistently oriented,
+	 * without degenerate triangles.
+	 */
+	bool is_valid() const;
+
+	/*!
+	 * Write a report of the problems, with their samples.
+	 * \param report The stream to write the report to.
+	 */
+	void write_report(std::ostream& report) const;
+
+protected:
+	/*!
+	 * One side of a triangle.
+	 */
+	struct Edge {
+		/*!
+		 * The vertex with the lowest index.
+		 */
+		size_t low;
+
+		/*!
+		 * The vertex with the highest index, shifted up by one bit. The lowest
+		 * bit is set if the triangle goes from the highest to the lowest index.
+		 *
+		 * This keeps the edges small, which makes sorting them faster.
+		 */
+		size_t high_reversed;
+
+		/*!
+		 * Orders edges by their vertices, so that equal edges end up next to
+		 * each other.
+		 * \param other The edge to compare with.
+		 * \return `true` if this edge comes before the other.
+		 */
+		bool operator <(const Edge& other) const;
+	};
+
+	/*!
+	 * Record a problem as a sample, if there are not enough samples yet.
+	 * \param samples The samples of the problems of this kind.
+	 * \param problem The problem to record.
+	 */
+	static void add_sample(std::vector<Problem>& samples, const Problem& problem);
+
+	/*!
+	 * Check whether a triangle has no area.
+	 * \param a The first vertex of the triangle.
+	 * \param b The second vertex of the triangle.
+	 * \param c The third vertex of the triangle.
+	 * \return `true` if the vertices are on one line, within rounding errors.
+	 */
+	static bool is_degenerate(const Point3& a, const Point3& b, const Point3& c);
+};
+
+}
+
+#endif //VALIDATION_HPP
\ No newline at end of file
@@ -0,0 +1,181 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef ZIP_READER_HPP
+#define ZIP_READER_HPP
+
+#include <cstdint> //For the fixed-size fields of the zip format.
+#include <functional> //To pass the contents of files to a callback.
+#include <string> //To store file names.
+#include <vector> //To store the entries of the central directory.
+
+#include "mapped_file.hpp" //To read the archive without loading it into memory.
+
+namespace convertto3mf {
+
+/*!
+ * Reads zip archives, such as the ones written by the ZipWriter, to check
+ * whether they are complete and to read the files in them.
+ *
+ * The archive is mapped into memory. The central directory is found via the
+ * end of central directory record at the end of the archive, with ZIP64
+ * extensions if needed. Files are inflated in pieces, so even files that are
+ * too big to fit in memory can be checked.
+ */
+class ZipReader {
+public:
+	/*!
+	 * A file or directory in the archive, as it is listed in the central
+	 * directory.
+	 */
+	struct Entry {
+		/*!
+		 * The path of the file in the archive.
+		 */
+		std::string name;
+
+		/*!
+		 * The compression method: 0 for stored, 8 for deflated.
+		 */
+		uint16_t method;
+
+		/*!
+		 * The CRC-32 of the uncompressed contents.
+		 */
+		uint32_t crc;
+
+		/*!
+		 * The size of the file after compression, in bytes.
+		 */
+		uint64_t compressed_size;
+
+		/*!
+		 * The size of the file before compression, in bytes.
+		 */
+		uint64_t uncompressed_size;
+
+		/*!
+		 * Where the local header of the file starts in the archive.
+		 */
+		uint64_t offset;
+	};
+
+	/*!
+	 * How many bytes to inflate at a time when reading a file.
+	 */
+	static constexpr size_t piece_size = 1 << 20;
+
+	/*!
+	 * Open an archive and read its central directory.
+	 *
+	 * If the file doesn't exist or is not a complete zip archive, the archive
+	 * is not valid.
+	 * \param filename The path to the archive.
+	 */
+	ZipReader(const std::string& filename);
+
+	/*!
+	 * Whether the archive has a complete central directory that is consistent
+	 * with the local headers of its files.
+	 * \return `true` if the archive could be opened.
+	 */
+	bool is_valid() const;
+
+	/*!
+	 * Get the files and directories in the archive.
+	 * \return The entries of the central directory, in order.
+	 */
+	const std::vector<Entry>& entries() const;
+
+	/*!
+	 * Find a file in the archive.
+	 * \param name The path of the file in the archive.
+	 * \return The entry of that file, or `nullptr` if it isn't in the archive.
+	 */
+	const Entry* find(const std::string& name) const;
+
+	/*!
+	 * Decompress a file in the archive, and check it against its size and
+	 * CRC-32 in the central directory.
+	 * \param entry The file to read. This must be one of the entries of this
+	 * archive.
+	 * \param output A function that gets called with consecutive blocks of the
+	 * contents, in order.
+	 * \return `true` if the file was complete and undamaged, or `false` if it
+	 * could not be decompressed or doesn't match its size or CRC-32.
+	 */
+	bool read(const Entry& entry, const std::function<void(const char*, size_t)>& output) const;
+
+	/*!
+	 * Decompress a file in the archive into memory.
+	 * \param name The path of the file in the archive.
+	 * \param contents Is set to the contents of the file.
+	 * \return `true` if the file exists and is complete and undamaged.
+	 */
+	bool read(const std::string& name, std::string& contents) const;
+
+	/*!
+	 * Check whether the archive is complete and all files in it are undamaged.
+	 * \return `true` if the archive is valid and every file matches its size
+	 * and CRC-32.
+	 */
+	bool verify() const;
+
+protected:
+	/*!
+	 * The contents of the archive.
+	 */
+	MappedFile file;
+
+	/*!
+	 * The files and directories in the archive.
+	 */
+	std::vector<Entry> directory;
+
+	/*!
+	 * For each entry, where its data starts in the archive.
+	 */
+	std::vector<uint64_t> data_offsets;
+
+	/*!
+	 * Whether the central directory could be read.
+	 */
+	bool valid;
+
+	/*!
+	 * Find and read the central directory, and check the local header of each
+	 * file against it.
+	 * \return `true` if the archive is complete and consistent.
+	 */
+	bool read_directory();
+
+	/*!
+	 * Read a 16-bit number in little-endian byte order.
+	 * \param data Where the number is.
+	 * \return The number.
+	 */
+	static uint16_t get16(const char* data);
+
+	/*!
+	 * Read a 32-bit number in little-endian byte order.
+	 * \param data Where the number is.
+	 * \return The number.
+	 */
+	static uint32_t get32(const char* data);
+
+	/*!
+	 * Read a 64-bit number in little-endian byte order.
+	 * \param data Where the number is.
+	 * \return The number.
+	 */
+	static uint64_t get64(const char* data);
+};
+
+}
+
+#endif //ZIP_READER_HPP
\ No newline at end of file
@@ -0,0 +1,293 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#ifndef ZIP_WRITER_HPP
+#define ZIP_WRITER_HPP
+
+#include <cstdint> //For the fixed-size fields of the zip format.
+#include <functional> //To write the archive to a callback, and to generate files in chunks.
+#include <ostream> //To generate the chunks into.
+#include <string> //To store file names and file contents.
+#include <vector> //To store the list of chunks and the entries of the central directory.
+
+namespace convertto3mf {
+
+/*!
+ * Writes a zip archive sequentially to an output, while its files are being
+ * generated.
+ *
+ * Each file is written as soon as it is added: a local header, then the
+ * deflated contents, then the central directory when the archive is closed.
+ * Nothing is ever written twice or out of order, so the output can be a file,
+ * a pipe or a buffer in memory, and the start of the archive is already
+ * written while the rest is still being generated.
+ *
+ * Files can be generated in chunks, which are serialised and compressed in
+ * parallel. Each chunk is deflated separately and ends on a byte boundary, so
+ * that the compressed chunks form one deflate stream when concatenated.
+ */
+class ZipWriter {
+public:
+	/*!
+	 * A function that gets called with consecutive blocks of the archive, in
+	 * order.
+	 *
+	 * It may throw an exception to abort writing the archive.
+	 */
+	typedef std::function<void(const char*, size_t)> Output;
+
+	/*!
+	 * A function that generates one chunk of a file, writing it to a stream.
+	 *
+	 * Each chunk is generated only once, but the chunks may be generated in any
+	 * order and on any thread.
+	 */
+	typedef std::function<void(std::ostream&)> Chunk;
+
+	/*!
+	 * The compression level to deflate files with.
+	 *
+	 * This is the default level of libzip, which used to write the archives,
+	 * so that they stay as small as they were. Compressing the pieces in
+	 * parallel makes up for the time this level takes.
+	 */
+	static constexpr int compression_level = 9;
+
+	/*!
+	 * How many bytes of a file in memory to compress in one piece.
+	 *
+	 * Larger files are split into pieces of this size, which are compressed in
+	 * parallel.
+	 */
+	static constexpr size_t piece_size = 1 << 20;
+
+	/*!
+	 * Start a new archive.
+	 *
+	 * Nothing is written until the first file is added.
+	 * \param output The function to write the archive to.
+	 */
+	ZipWriter(const Output& output);
+
+	/*!
+	 * Add a directory to the archive.
+	 * \param name The path of the directory in the archive, without trailing
+	 * slash.
+	 */
+	void add_directory(const std::string& name);
+
+	/*!
+	 * Add a file that is completely in memory to the archive.
+	 *
+	 * Its size is known in advance, so it only gets ZIP64 extensions if it is
+	 * too big without them.
+	 * \param name The path of the file in the archive.
+	 * \param data The contents of the file.
+	 */
+	void add_file(const std::string& name, const std::string& data);
+
+	/*!
+	 * Add a file to the archive that is generated in chunks while it is being
+	 * written.
+	 *
+	 * This allows writing files that are too big to keep in memory at once.
+	 * Only a few chunks are in memory at any time. The size of the file is not
+	 * known when its header is written, so the size and checksum are written
+	 * after the data instead. An exception thrown by a chunk aborts writing the
+	 * archive.
+	 *
+	 * Since the size is not known in advance, the file always gets ZIP64
+	 * extensions. They only add a few bytes, and the file can't turn out to be
+	 * too big for the archive after it has been written.
+	 * \param name The path of the file in the archive.
+	 * \param chunks The functions that generate the consecutive chunks of the
+	 * file.
+	 */
+	void add_file(const std::string& name, const std::vector<Chunk>& chunks);
+
+	/*!
+	 * Write the central directory, which completes the archive.
+	 *
+	 * No more files may be added after this.
+	 */
+	void close();
+
+	/*!
+	 * Get how many bytes of the archive were written so far.
+	 * \return The size of the archive so far.
+	 */
+	uint64_t size() const;
+
+protected:
+	/*!
+	 * A file or directory in the archive, as it is listed in the central
+	 * directory.
+	 */
+	struct Entry {
+		/*!
+		 * The path of the file in the archive.
+		 */
+		std::string name;
+
+		/*!
+		 * The compression method: 0 for stored, 8 for deflated.
+		 */
+		uint16_t method;
+
+		/*!
+		 * The general purpose flags of the zip format.
+		 */
+		uint16_t flags;
+
+		/*!
+		 * The version of the zip format needed to extract the file.
+		 */
+		uint16_t version_needed;
+
+		/*!
+		 * The CRC-32 of the uncompressed contents.
+		 */
+		uint32_t crc;
+
+		/*!
+		 * The size of the file after compression, in bytes.
+		 */
+		uint64_t compressed_size;
+
+		/*!
+		 * The size of the file before compression, in bytes.
+		 */
+		uint64_t uncompressed_size;
+
+		/*!
+		 * Where the local header of the file starts in the archive.
+		 */
+		uint64_t offset;
+
+		/*!
+		 * The attributes of the file. Directories are marked as such.
+		 */
+		uint32_t external_attributes;
+	};
+
+	/*!
+	 * One piece of a file, deflated separately.
+	 */
+	struct Piece {
+		/*!
+		 * The deflated data, ending on a byte boundary without a final block.
+		 */
+		std::string data;
+
+		/*!
+		 * The CRC-32 of the uncompressed data.
+		 */
+		uint32_t crc;
+
+		/*!
+		 * The size of the uncompressed data, in bytes.
+		 */
+		uint64_t size;
+	};
+
+	/*!
+	 * The largest size or offset that fits in the fields of the zip format
+	 * without ZIP64 extensions. This value itself indicates that the real
+	 * value is in the ZIP64 extensions.
+	 */
+	static constexpr uint64_t max_zip32 = 0xFFFFFFFF;
+
+	/*!
+	 * General purpose flag indicating that the file name is encoded in UTF-8.
+	 */
+	static constexpr uint16_t utf8_flag = 0x0800;
+
+	/*!
+	 * General purpose flag indicating that the size and checksum of the file
+	 * are written in a data descriptor after its data.
+	 */
+	static constexpr uint16_t data_descriptor_flag = 0x0008;
+
+	/*!
+	 * A final deflate block without any data, which ends the concatenated
+	 * pieces of a file.
+	 */
+	static const char final_block[2];
+
+	/*!
+	 * The function to write the archive to.
+	 */
+	Output output;
+
+	/*!
+	 * How many bytes were written so far.
+	 */
+	uint64_t position;
+
+	/*!
+	 * The files and directories written so far.
+	 */
+	std::vector<Entry> entries;
+
+	/*!
+	 * The modification time to store for all files, in the MS-DOS format.
+	 */
+	uint16_t dos_time;
+
+	/*!
+	 * The modification date to store for all files, in the MS-DOS format.
+	 */
+	uint16_t dos_date;
+
+	/*!
+	 * Write data to the output.
+	 * \param data The data to write.
+	 * \param size The number of bytes to write.
+	 */
+	void write(const char* data, const size_t size);
+
+	/*!
+	 * Write the local header of a file.
+	 * \param entry The file to write the header of. Its offset is filled in.
+	 * \param zip64 Whether the header needs ZIP64 extensions.
+	 */
+	void write_local_header(Entry& entry, const bool zip64);
+
+	/*!
+	 * Deflate a piece of a file.
+	 * \param data The uncompressed data.
+	 * \param size The number of bytes of uncompressed data.
+	 * \return The compressed piece.
+	 */
+	static Piece compress(const char* data, const size_t size);
+
+	/*!
+	 * Append a 16-bit number to a record, in little-endian byte order.
+	 * \param record The record to append to.
+	 * \param value The number to append.
+	 */
+	static void put16(std::string& record, const uint16_t value);
+
+	/*!
+	 * Append a 32-bit number to a record, in little-endian byte order.
+	 * \param record The record to append to.
+	 * \param value The number to append.
+	 */
+	static void put32(std::string& record, const uint32_t value);
+
+	/*!
+	 * Append a 64-bit number to a record, in little-endian byte order.
+	 * \param record The record to append to.
+	 * \param value The number to append.
+	 */
+	static void put64(std::string& record, const uint64_t value);
+};
+
+}
+
+#endif //ZIP_WRITER_HPP
\ No newline at end of file
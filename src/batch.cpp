@@ -0,0 +1,142 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <string> //To format messages about the batch.
+#include <unordered_map> //To detect input files that would be converted to the same 3MF file.
+
+#include "batch.hpp" //The definitions for this file.
+#include "job.hpp" //To convert each of the files.
+#include "journal.hpp" //To skip the conversions that were completed before.
+#include "prefetcher.hpp" //To read the next input files in the background.
+#include "trace.hpp" //To trace the whole batch.
+
+namespace convertto3mf {
+
+Batch::Batch(const std::vector<std::string>& input_filenames, const std::string& output_directory, const std::string& journal_filename, const Options& options) :
+		input_filenames(input_filenames),
+		output_directory(output_directory),
+		journal_filename(journal_filename),
+		options(options),
+		prefetch(Prefetcher::default_lookahead) {};
+
+bool Batch::run() {
+	Journal journal(journal_filename);
+	if(!journal.is_open()) {
+		if(options.monitor) {
+			options.monitor->log("Could not open the journal: " + journal_filename, Monitor::Severity::FAILURE);
+		}
+		return false;
+	}
+	if(journal.size() > 0 && options.monitor) {
+		options.monitor->log("Resuming from journal " + journal_filename + " with " + std::to_string(journal.size()) + " completed conversions.");
+	}
+
+	//Find which files still need to be converted first, so that only those are prefetched.
+	size_t skipped = 0;
+	size_t failed = 0;
+	std::vector<std::string> pending;
+	std::unordered_map<std::string, std::string> output_inputs; //For each 3MF file, which input file is converted to it.
+	for(const std::string& input_filename : input_filenames) {
+		if(input_filename == "-") {
+			if(options.monitor) {
+				options.monitor->log("Can't convert the standard input in a batch.", Monitor::Severity::FAILURE);
+			}
+			failed++;
+			continue;
+		}
+		const std::string output = output_filename(input_filename, output_directory);
+		const std::pair<std::unordered_map<std::string, std::string>::iterator, bool> claimed = output_inputs.emplace(output, input_filename);
+		if(!claimed.second) { //Another input file is already converted to this 3MF file.
+			if(claimed.first->second == input_filename) { //The same file was given twice. Only convert it once.
+				skipped++;
+				continue;
+			}
+			if(options.monitor) {
+				options.monitor->log("Can't convert " + input_filename + ": " + claimed.first->second + " is converted to the same file, " + output, Monitor::Severity::FAILURE);
+			}
+			failed++;
+			continue;
+		}
+		if(journal.is_completed(input_filename, output)) {
+			skipped++;
+			continue;
+		}
+		pending.push_back(input_filename);
+	}
+
+	//Trace the whole batch at once, rather than letting each conversion start a new trace and overwrite the trace of the previous one.
+	Options job_options = options;
+	job_options.trace_filename.clear();
+	if(!options.trace_filename.empty()) {
+		Trace::start();
+	}
+	bool cancelled = false;
+	{
+		Prefetcher prefetcher(pending, prefetch);
+		for(size_t input_index = 0; input_index < pending.size(); ++input_index) {
+			prefetcher.advance(input_index);
+			const std::string& input_filename = pending[input_index];
+			const std::string output = output_filename(input_filename, output_directory);
+			Job job(input_filename, output, job_options);
+			if(!job.run()) {
+				if(options.monitor && options.monitor->is_cancelled()) { //Cancelled. Keep the journal of what was completed so far, to resume later.
+					cancelled = true;
+					break;
+				}
+				if(options.monitor) { //Only this file failed, such as when its output could not be written. Any earlier output of it is not recorded as completed.
+					options.monitor->log("Failed to convert " + input_filename, Monitor::Severity::FAILURE);
+				}
+				failed++;
+				continue;
+			}
+			if(!journal.record(input_filename, output)) { //The output was not written.
+				if(options.monitor) {
+					options.monitor->log("Failed to convert " + input_filename, Monitor::Severity::FAILURE);
+				}
+				failed++;
+			}
+		}
+	} //The prefetch threads are stopped here, so they don't record spans while the trace is written.
+	if(!options.trace_filename.empty()) {
+		Trace::write(options.trace_filename);
+		if(options.monitor) {
+			options.monitor->log("Wrote trace to " + options.trace_filename);
+		}
+	}
+	if(cancelled) {
+		return false;
+	}
+	if(options.monitor) {
+		std::string summary = "Converted " + std::to_string(input_filenames.size() - skipped - failed) + " files, skipped " + std::to_string(skipped) + " files that were converted before";
+		if(failed > 0) {
+			summary += ", failed to convert " + std::to_string(failed) + " files";
+		}
+		options.monitor->log(summary + ".");
+	}
+	return true;
+}
+
+std::string Batch::output_filename(const std::string& input_filename, const std::string& output_directory) {
+	std::string result = input_filename;
+	const size_t directory_end = result.find_last_of("/\\");
+	const size_t extension_start = result.rfind('.');
+	if(extension_start != std::string::npos && (directory_end == std::string::npos || extension_start > directory_end)) { //Remove the extension if there is one.
+		result = result.substr(0, extension_start);
+	}
+	result += ".3mf";
+	if(!output_directory.empty()) {
+		if(directory_end != std::string::npos) {
+			result = result.substr(directory_end + 1);
+		}
+		const char last = output_directory.back();
+		result = output_directory + ((last == '/' || last == '\\') ? "" : "/") + result;
+	}
+	return result;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //For std::min.
+#include <utility> //For std::swap.
+
+#include "components.hpp" //The definitions for this file.
+#include "parallel.hpp" //To merge and look up sets in parallel.
+
+namespace convertto3mf {
+
+void Components::split(const std::vector<Point3>& vertices, const std::vector<std::array<size_t, 3>>& triangles, std::vector<std::vector<Point3>>& component_vertices, std::vector<std::vector<std::array<size_t, 3>>>& component_triangles) {
+	component_vertices.clear();
+	component_triangles.clear();
+
+	//Start with each vertex in its own set.
+	std::vector<std::atomic<size_t>> parents(vertices.size());
+	parallel_for(vertices.size(), [&parents](const size_t vertex) {
+		parents[vertex].store(vertex, std::memory_order_relaxed);
+	});
+
+	//Merge the sets of the vertices of each triangle. The triangles are handed out to the threads in batches.
+	const size_t num_batches = (triangles.size() + batch_size - 1) / batch_size;
+	parallel_for(num_batches, [&parents, &triangles](const size_t batch) {
+		const size_t end = std::min(triangles.size(), (batch + 1) * batch_size);
+		for(size_t triangle_index = batch * batch_size; triangle_index < end; ++triangle_index) {
+			const std::array<size_t, 3>& triangle = triangles[triangle_index];
+			unite(parents, triangle[0], triangle[1]);
+			unite(parents, triangle[0], triangle[2]);
+		}
+	});
+
+	//Now that all sets are complete, look up the representative of every vertex.
+	std::vector<size_t> representatives(vertices.size());
+	parallel_for(vertices.size(), [&parents, &representatives](const size_t vertex) {
+		representatives[vertex] = find(parents, vertex);
+	});
+
+	//Number the components. Only sets with triangles in them become components.
+	constexpr size_t no_component = -1;
+	std::vector<size_t> component_of(vertices.size(), no_component); //For each representative, the index of its component.
+	for(const std::array<size_t, 3>& triangle : triangles) {
+		component_of[representatives[triangle[0]]] = 0; //Mark it as used for now.
+	}
+	size_t num_components = 0;
+	for(size_t vertex = 0; vertex < vertices.size(); ++vertex) {
+		if(component_of[vertex] != no_component) { //Only representatives can be marked, and they are the lowest vertex of their set, so this is in order of the lowest vertex.
+			component_of[vertex] = num_components++;
+		}
+	}
+	component_vertices.resize(num_components);
+	component_triangles.resize(num_components);
+
+	//Distribute the vertices over the components, keeping track of their new indices.
+	std::vector<size_t> new_index(vertices.size());
+	for(size_t vertex = 0; vertex < vertices.size(); ++vertex) {
+		const size_t component = component_of[representatives[vertex]];
+		if(component == no_component) { //Not used by any triangle.
+			continue;
+		}
+		new_index[vertex] = component_vertices[component].size();
+		component_vertices[component].push_back(vertices[vertex]);
+	}
+
+	//Distribute the triangles over the components.
+	for(const std::array<size_t, 3>& triangle : triangles) {
+		const size_t component = component_of[representatives[triangle[0]]];
+		component_triangles[component].push_back({new_index[triangle[0]], new_index[triangle[1]], new_index[triangle[2]]});
+	}
+}
+
+size_t Components::find(std::vector<std::atomic<size_t>>& parents, size_t vertex) {
+	size_t parent = parents[vertex].load(std::memory_order_relaxed);
+	while(parent != vertex) {
+		const size_t grandparent = parents[parent].load(std::memory_order_relaxed);
+		//Point this vertex to its grandparent instead. If another thread changed the parent in the meanwhile, that's fine too: Parents only ever move closer to the representative.
+		parents[vertex].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+		vertex = parent;
+		parent = parents[vertex].load(std::memory_order_relaxed);
+	}
+	return vertex;
+}
+
+void Components::unite(std::vector<std::atomic<size_t>>& parents, size_t a, size_t b) {
+	while(true) {
+		a = find(parents, a);
+		b = find(parents, b);
+		if(a == b) { //Already in the same set.
+			return;
+		}
+		if(a < b) {
+			std::swap(a, b);
+		}
+		//Link the higher representative to the lower one. This fails if another thread linked it somewhere in the meanwhile, and then we have to try again with the new representative.
+		size_t expected = a;
+		if(parents[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) {
+			return;
+		}
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //For std::min.
+#include <istream> //To read text formats from memory.
+#include <iterator> //To read binary formats from streams into memory.
+
+#include "convert.hpp" //The definitions for this file.
+#include "detect_file_type.hpp" //To detect which type of file this is.
+#include "glb.hpp" //To import binary glTF files.
+#include "memory_buffer.hpp" //To read text formats from memory without copying.
+#include "obj.hpp" //To import OBJ files.
+#include "prefixed_buffer.hpp" //To continue reading streams after detecting their file type.
+#include "ply.hpp" //To import PLY files.
+#include "stl_ascii.hpp" //To import ASCII STL files.
+#include "stl_binary.hpp" //To import binary STL files.
+#include "threemf.hpp" //To write 3MF files.
+
+namespace convertto3mf {
+
+Model import_from_memory(const char* data, const size_t size, const std::string& filename, Monitor* monitor) {
+	const std::string sample(data, std::min(size, detection_sample_size));
+	const FileType file_type = detect_file_type(filename, sample, size);
+
+	MemoryBuffer buffer(data, size);
+	std::istream stream(&buffer);
+	switch(file_type) {
+		case FileType::OBJ: return Obj::import(stream, monitor);
+		case FileType::STL_BINARY: return StlBinary::import(data, size, monitor);
+		case FileType::STL_ASCII: return StlAscii::import(stream, monitor);
+		case FileType::PLY: return Ply::import(data, size, monitor);
+		case FileType::GLB: return Glb::import(data, size, monitor);
+	}
+	return Model();
+}
+
+Model import_from_stream(std::istream& stream, Monitor* monitor) {
+	//Read the start of the stream to detect the file type from.
+	std::string sample(detection_sample_size, '\0');
+	stream.read(&sample[0], sample.size());
+	sample.resize(stream.gcount());
+	const FileType file_type = detect_file_type("", sample, unknown_file_size);
+
+	//Continue reading with the sample put in front again.
+	PrefixedBuffer buffer(sample, *stream.rdbuf());
+	std::istream prefixed_stream(&buffer);
+	switch(file_type) {
+		case FileType::OBJ: return Obj::import(prefixed_stream, monitor);
+		case FileType::STL_ASCII: return StlAscii::import(prefixed_stream, monitor);
+		case FileType::STL_BINARY:
+		case FileType::PLY:
+		case FileType::GLB: {
+			//Binary formats are read from memory.
+			const std::string contents((std::istreambuf_iterator<char>(prefixed_stream)), std::istreambuf_iterator<char>());
+			if(file_type == FileType::STL_BINARY) {
+				return StlBinary::import(contents.data(), contents.size(), monitor);
+			}
+			if(file_type == FileType::GLB) {
+				return Glb::import(contents.data(), contents.size(), monitor);
+			}
+			return Ply::import(contents.data(), contents.size(), monitor);
+		}
+	}
+	return Model();
+}
+
+std::string convert(const char* data, const size_t size, const Options& options, const std::string& filename) {
+	std::string result;
+	convert(data, size, [&result](const char* block, const size_t block_size) {
+		result.append(block, block_size);
+	}, options, filename);
+	return result;
+}
+
+void convert(const char* data, const size_t size, const std::function<void(const char*, size_t)>& output, const Options& options, const std::string& filename) {
+	if(options.monitor) {
+		options.monitor->start_phase(Monitor::Phase::IMPORT, size);
+	}
+	const Model model = import_from_memory(data, size, filename, options.monitor.get());
+	ThreeMF::export_to_callback(model, options, output);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <cstdlib> //To allocate output buffers that can be freed from C.
+#include <cstring> //To copy the output into those buffers.
+#include <memory> //To give the options a monitor that passes on the messages.
+#include <new> //To catch allocation failures.
+
+#include "convert.hpp" //To perform the conversions.
+#include "convertto3mf.h" //The definitions for this file.
+
+/*!
+ * The hidden contents of the options of the C interface.
+ */
+struct convertto3mf_options {
+	/*!
+	 * The options of the C++ interface that these wrap.
+	 */
+	convertto3mf::Options options;
+};
+
+namespace {
+
+/*!
+ * Thrown from the write callback to abort a conversion when the callback
+ * reports an error.
+ */
+struct WriteFailed {};
+
+}
+
+extern "C" {
+
+convertto3mf_options* convertto3mf_options_create(void) {
+	return new(std::nothrow) convertto3mf_options();
+}
+
+void convertto3mf_options_destroy(convertto3mf_options* options) {
+	delete options;
+}
+
+void convertto3mf_options_set_split_parts(convertto3mf_options* options, int split_parts, size_t part_max_triangles) {
+	if(!options) {
+		return;
+	}
+	options->options.split_parts = split_parts != 0;
+	options->options.part_max_triangles = part_max_triangles;
+}
+
+void convertto3mf_options_set_reorder(convertto3mf_options* options, int reorder) {
+	if(!options) {
+		return;
+	}
+	options->options.reorder = reorder != 0;
+}
+
+void convertto3mf_options_set_instancing(convertto3mf_options* options, int instancing) {
+	if(!options) {
+		return;
+	}
+	options->options.instancing = instancing != 0;
+}
+
+void convertto3mf_options_set_validate(convertto3mf_options* options, int validate) {
+	if(!options) {
+		return;
+	}
+	options->options.validate = validate != 0;
+}
+
+void convertto3mf_options_set_max_triangles(convertto3mf_options* options, size_t max_triangles) {
+	if(!options) {
+		return;
+	}
+	options->options.max_triangles = max_triangles;
+}
+
+void convertto3mf_options_set_split_components(convertto3mf_options* options, int split_components) {
+	if(!options) {
+		return;
+	}
+	options->options.split_components = split_components != 0;
+}
+
+void convertto3mf_options_set_precision(convertto3mf_options* options, size_t precision, double quantize) {
+	if(!options) {
+		return;
+	}
+	options->options.precision = precision;
+	options->options.quantize = quantize;
+}
+
+void convertto3mf_options_set_log(convertto3mf_options* options, convertto3mf_log_callback log, void* user_data) {
+	if(!options) {
+		return;
+	}
+	if(!log) {
+		options->options.monitor.reset();
+		return;
+	}
+	options->options.monitor = std::make_shared<convertto3mf::Monitor>(convertto3mf::Monitor::Callback(), [log, user_data](const std::string& message, const convertto3mf::Monitor::Severity) {
+		log(message.c_str(), user_data);
+	});
+}
+
+int convertto3mf_convert(const void* input, size_t input_size, const char* filename, const convertto3mf_options* options, convertto3mf_write_callback write, void* user_data) {
+	if((!input && input_size > 0) || !write) {
+		return CONVERTTO3MF_INVALID_ARGUMENT;
+	}
+	//Exceptions must not escape into C code.
+	try {
+		convertto3mf::convert(static_cast<const char*>(input), input_size, [write, user_data](const char* block, const size_t block_size) {
+			if(write(block, block_size, user_data) != 0) {
+				throw WriteFailed();
+			}
+		}, options ? options->options : convertto3mf::Options(), filename ? filename : "");
+	} catch(const WriteFailed&) {
+		return CONVERTTO3MF_WRITE_FAILED;
+	} catch(const std::bad_alloc&) {
+		return CONVERTTO3MF_OUT_OF_MEMORY;
+	} catch(...) {
+		return CONVERTTO3MF_INTERNAL_ERROR;
+	}
+	return CONVERTTO3MF_OK;
+}
+
+int convertto3mf_convert_to_buffer(const void* input, size_t input_size, const char* filename, const convertto3mf_options* options, void** output, size_t* output_size) {
+	if((!input && input_size > 0) || !output || !output_size) {
+		return CONVERTTO3MF_INVALID_ARGUMENT;
+	}
+	try {
+		const std::string result = convertto3mf::convert(static_cast<const char*>(input), input_size, options ? options->options : convertto3mf::Options(), filename ? filename : "");
+		*output = std::malloc(result.size() > 0 ? result.size() : 1); //Allocate at least one byte, so that a null pointer always indicates failure.
+		if(!*output) {
+			return CONVERTTO3MF_OUT_OF_MEMORY;
+		}
+		std::memcpy(*output, result.data(), result.size());
+		*output_size = result.size();
+	} catch(const std::bad_alloc&) {
+		return CONVERTTO3MF_OUT_OF_MEMORY;
+	} catch(...) {
+		return CONVERTTO3MF_INTERNAL_ERROR;
+	}
+	return CONVERTTO3MF_OK;
+}
+
+void convertto3mf_free(void* buffer) {
+	std::free(buffer);
+}
+
+}
\ No newline at end of file
@@ -6,35 +6,68 @@
  * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
  */
 
+#include <algorithm> //For std::min.
+#include <fstream> //To read the start of the file.
+
 #include "detect_file_type.hpp" //The definitions for this file.
+#include "glb.hpp" //To detect binary glTF files.
 #include "obj.hpp" //To detect OBJ files.
+#include "ply.hpp" //To detect PLY files.
 #include "stl_ascii.hpp" //To detect ASCII STL files.
 #include "stl_binary.hpp" //To detect binary STL files.
+#include "trace.hpp" //To measure how long detection takes.
 
 namespace convertto3mf {
 
 FileType detect_file_type(const std::string& filename) {
+	//Read 1kB from the file once, for all file types to look at.
+	std::ifstream file_handle(filename, std::ios_base::in | std::ios_base::binary);
+	file_handle.seekg(0, file_handle.end);
+	const size_t file_size = file_handle.tellg();
+	file_handle.seekg(file_handle.beg);
+	std::string sample(std::min(file_size, detection_sample_size), '\0');
+	file_handle.read(&sample[0], sample.size());
+	sample.resize(file_handle.gcount());
+
+	return detect_file_type(filename, sample, file_size);
+}
+
+FileType detect_file_type(const std::string& filename, const std::string& sample, const size_t file_size) {
+	Trace::Span span("detect");
+	span.set_bytes(sample.size());
 	float highest_probability = 0.0;
 	FileType result = FileType::OBJ;
 
-	const float obj_probability = Obj::is_obj(filename);
+	const float obj_probability = Obj::is_obj(filename, sample);
 	if(obj_probability > highest_probability) {
 		highest_probability = obj_probability;
 		result = FileType::OBJ;
 	}
 
-	const float stl_binary_probability = StlBinary::is_stl_binary(filename);
+	const float stl_binary_probability = StlBinary::is_stl_binary(filename, sample, file_size);
 	if(stl_binary_probability > highest_probability) {
 		highest_probability = stl_binary_probability;
 		result = FileType::STL_BINARY;
 	}
 
-	const float stl_ascii_probability = StlAscii::is_stl_ascii(filename);
+	const float stl_ascii_probability = StlAscii::is_stl_ascii(filename, sample);
 	if(stl_ascii_probability > highest_probability) {
 		highest_probability = stl_ascii_probability;
 		result = FileType::STL_ASCII;
 	}
 
+	const float ply_probability = Ply::is_ply(filename, sample);
+	if(ply_probability > highest_probability) {
+		highest_probability = ply_probability;
+		result = FileType::PLY;
+	}
+
+	const float glb_probability = Glb::is_glb(filename, sample);
+	if(glb_probability > highest_probability) {
+		highest_probability = glb_probability;
+		result = FileType::GLB;
+	}
+
 	return result;
 }
 
@@ -0,0 +1,159 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //For std::min, and to find line breaks.
+#include <cstdint> //To read the number of triangles of binary STL files.
+#include <cstring> //To copy samples of binary STL files.
+#include <sstream> //To format the JSON output.
+#include <vector> //To probe the samples in parallel.
+
+#include "estimate.hpp" //The definitions for this file.
+#include "mapped_file.hpp" //To read only the samples of large files.
+#include "obj.hpp" //To probe samples of OBJ files.
+#include "parallel.hpp" //To probe the samples in parallel.
+#include "stl_ascii.hpp" //To probe samples of ASCII STL files.
+#include "stl_binary.hpp" //To probe samples of binary STL files.
+#include "threemf.hpp" //To find out whether OBJ files can be streamed.
+#include "trace.hpp" //To measure how long estimating takes.
+
+namespace convertto3mf {
+
+constexpr size_t Estimate::sample_threshold;
+constexpr size_t Estimate::num_samples;
+constexpr size_t Estimate::sample_size;
+
+Estimate Estimate::estimate(const std::string& filename, const Options& options) {
+	const MappedFile file(filename); //Only the pages that are sampled get read from the disk.
+	return estimate(file.data(), file.size(), filename, options);
+}
+
+Estimate Estimate::estimate(const char* data, const size_t size, const std::string& filename, const Options& options) {
+	Trace::Span span("estimate");
+	span.set_bytes(size);
+	Estimate result;
+	const FileType file_type = detect_file_type(filename, std::string(data, std::min(size, detection_sample_size)), size);
+	if(size > sample_threshold && (file_type == FileType::OBJ || file_type == FileType::STL_ASCII || file_type == FileType::STL_BINARY)) {
+		result.probe.file_type = file_type;
+		result.probe.file_size = size;
+		sample(data, size, result.probe);
+		result.sampled = true;
+	} else { //PLY and GLB files state their sizes in their headers, so probing them is fast anyway.
+		result.probe = Probe::probe(data, size, filename);
+	}
+	span.set_items(result.probe.num_triangles);
+	result.predict(options);
+	return result;
+}
+
+const Estimate::Coefficients& Estimate::coefficients(const FileType file_type, const bool streaming) {
+	//Calibrated with the end-to-end benchmark, using --calibrate. The memory per byte follows from how each importer reads its file.
+	//The benchmark has no PLY or GLB files. Those are read like binary STL files, but their vertices are shared, so they take less memory per triangle.
+	static const Coefficients obj = {11.5e6, 1, 147, 0.006, 18.6e-6};
+	static const Coefficients obj_streaming = {11.5e6, 0, 72, 0.005, 17.5e-6};
+	static const Coefficients stl_binary = {11.5e6, 1, 204, 0.004, 18.8e-6};
+	static const Coefficients stl_ascii = {11.5e6, 1, 284, 0.004, 18.6e-6};
+	static const Coefficients ply = {11.5e6, 1, 150, 0.004, 18.8e-6};
+	static const Coefficients glb = {11.5e6, 1, 150, 0.004, 18.8e-6};
+	switch(file_type) {
+		case FileType::OBJ: return streaming ? obj_streaming : obj;
+		case FileType::STL_BINARY: return stl_binary;
+		case FileType::STL_ASCII: return stl_ascii;
+		case FileType::PLY: return ply;
+		case FileType::GLB: return glb;
+	}
+	return obj;
+}
+
+void Estimate::predict(const Options& options) {
+	streaming = options.streaming && probe.file_type == FileType::OBJ && !ThreeMF::needs_all_triangles(options);
+	const Coefficients& model = coefficients(probe.file_type, streaming);
+	peak_memory = model.memory_fixed + model.memory_per_byte * probe.file_size + model.memory_per_triangle * probe.num_triangles;
+	duration = model.seconds_fixed + model.seconds_per_triangle * probe.num_triangles;
+}
+
+void Estimate::include(const Estimate& other) {
+	probe.include(other.probe);
+	probe.file_size += other.probe.file_size;
+	sampled = sampled || other.sampled;
+	streaming = streaming && other.streaming;
+	peak_memory += other.peak_memory;
+	duration += other.duration;
+}
+
+std::string Estimate::to_json(const std::string& filename) const {
+	std::string json = probe.to_json(filename);
+	json.pop_back(); //Continue the object of the probe.
+	std::ostringstream fields;
+	fields << ",\"sampled\":" << (sampled ? "true" : "false");
+	fields << ",\"streaming\":" << (streaming ? "true" : "false");
+	fields << ",\"peak_memory\":" << peak_memory;
+	fields << ",\"duration\":" << duration << "}";
+	return json + fields.str();
+}
+
+void Estimate::sample(const char* data, const size_t size, Probe& result) {
+	std::vector<Probe> samples(num_samples);
+	if(result.file_type == FileType::STL_BINARY) {
+		//The header tells how many triangles there are, so the samples are only needed for the bounding box.
+		uint32_t num_triangles;
+		memcpy(&num_triangles, data + 80, sizeof(num_triangles));
+		if((size - 84) / 50 < num_triangles) { //Number of triangles must be corrupt.
+			num_triangles = (size - 84) / 50;
+		}
+		parallel_for(num_samples, [data, num_triangles, &samples](const size_t sample_index) {
+			//Probe each sample as if it were a small file of its own.
+			const size_t first = size_t(num_triangles) * sample_index / num_samples;
+			const uint32_t count = std::min(sample_size / 50, size_t(num_triangles) - first);
+			std::string piece(data, 80);
+			piece.append(reinterpret_cast<const char*>(&count), sizeof(count));
+			piece.append(data + 84 + first * 50, size_t(count) * 50);
+			StlBinary::probe(piece.data(), piece.size(), samples[sample_index]);
+		});
+		for(const Probe& sample_probe : samples) {
+			result.include(sample_probe);
+		}
+		result.num_triangles = num_triangles;
+		result.num_vertices = size_t(num_triangles) * 3;
+		return;
+	}
+
+	std::vector<size_t> sampled_bytes(num_samples, 0);
+	parallel_for(num_samples, [data, size, &result, &samples, &sampled_bytes](const size_t sample_index) {
+		//Each sample starts and ends at a line break, so that no lines are cut.
+		size_t start = size * sample_index / num_samples;
+		if(sample_index > 0) {
+			start = std::min(size, size_t(std::find(data + start, data + size, '\n') - data) + 1);
+		}
+		size_t end = std::min(size, start + sample_size);
+		if(end < size) {
+			end = std::min(size, size_t(std::find(data + end, data + size, '\n') - data) + 1);
+		}
+		if(start >= end) {
+			return;
+		}
+		if(result.file_type == FileType::OBJ) {
+			Obj::probe(data + start, end - start, samples[sample_index]);
+		} else {
+			StlAscii::probe(data + start, end - start, samples[sample_index]);
+		}
+		sampled_bytes[sample_index] = end - start;
+	});
+	size_t total_sampled = 0;
+	for(size_t sample_index = 0; sample_index < num_samples; ++sample_index) {
+		result.include(samples[sample_index]);
+		result.indexed = result.indexed || samples[sample_index].indexed;
+		total_sampled += sampled_bytes[sample_index];
+	}
+	if(total_sampled > 0) { //Extrapolate to the whole file.
+		const double scale = double(size) / total_sampled;
+		result.num_triangles = result.num_triangles * scale;
+		result.num_vertices = result.num_vertices * scale;
+	}
+}
+
+}
\ No newline at end of file
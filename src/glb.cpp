@@ -0,0 +1,406 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //For std::min.
+#include <cstdint> //To read fixed-width binary values.
+#include <cstring> //To read binary values with memcpy.
+
+#include "glb.hpp" //The definitions for this file.
+#include "mapped_file.hpp" //To read the file without copying it.
+#include "parallel.hpp" //To convert the meshes in parallel.
+#include "trace.hpp" //To measure how long parsing takes.
+
+namespace convertto3mf {
+
+float Glb::is_glb(const std::string& filename, const std::string& sample) {
+	float probability = 1.0 / 3.0; //Final result.
+	//Probability of a file extension being different from the contents of the file. Probably an overestimation but we want to let the magic number determine it more.
+	constexpr float probability_incorrect_extension = 0.01;
+	//Probability of a file starting with the glTF magic number and version while not being a GLB file.
+	constexpr float probability_incorrect_magic = 0.0001;
+
+	//File extension plays a role in likelihood.
+	if(filename.length() >= 4 && filename.compare(filename.length() - 4, 4, ".glb") == 0) {
+		probability = 1 - probability_incorrect_extension;
+	} else {
+		probability = probability_incorrect_extension;
+	}
+
+	//GLB files start with the magic number "glTF", followed by the version as a 32-bit integer.
+	uint32_t version = 0;
+	if(sample.size() >= 8) {
+		memcpy(&version, sample.data() + 4, sizeof(version));
+	}
+	const bool correct_magic = sample.compare(0, 4, "glTF") == 0 && version == 2;
+
+	if(correct_magic) {
+		probability = 1.0 - ((1.0 - probability) * probability_incorrect_magic);
+	} else {
+		probability *= probability_incorrect_magic;
+	}
+
+	return probability;
+}
+
+Model Glb::import(const std::string& filename, Monitor* monitor) {
+	if(monitor) {
+		monitor->log("Importing binary glTF file: " + filename);
+	}
+	const MappedFile file(filename);
+	return import(file.data(), file.size(), monitor);
+}
+
+Model Glb::import(const char* data, const size_t size, Monitor* monitor) {
+	Trace::Span span("parse");
+	span.set_bytes(size);
+	Glb glb; //Store the GLB file in its own representation.
+	glb.monitor = monitor;
+	if(!glb.load_chunks(data, size)) { //Not a valid GLB file. We can't know what the data means.
+		return Model();
+	}
+	glb.find_instances();
+	Model model = glb.to_model();
+	size_t num_triangles = 0;
+	for(const Mesh& mesh : model.meshes) {
+		num_triangles += mesh.triangles.size();
+	}
+	if(monitor) {
+		monitor->advance(size, 0);
+	}
+	span.set_items(num_triangles);
+	return model;
+}
+
+void Glb::probe(const char* data, const size_t size, Probe& result) {
+	result.indexed = true;
+	Glb glb;
+	if(!glb.load_chunks(data, size)) {
+		return;
+	}
+	glb.find_instances();
+	for(const Instance& instance : glb.instances) {
+		const Json& primitives = glb.document["meshes"][instance.mesh_index]["primitives"];
+		for(size_t i = 0; i < primitives.size(); ++i) {
+			const Json& primitive = primitives[i];
+			const size_t mode = primitive["mode"].as_index(4);
+			const Json& positions = glb.document["accessors"][primitive["attributes"]["POSITION"].as_index(-1)];
+			if(mode < 4 || mode > 6 || positions.type != Json::Type::OBJECT) { //Points and lines are not saved.
+				continue;
+			}
+			const size_t num_vertices = positions["count"].as_index(0);
+			result.num_vertices += num_vertices;
+			const Json& indices_json = primitive["indices"];
+			const size_t num_indices = (indices_json.type == Json::Type::NUL) ? num_vertices : glb.document["accessors"][indices_json.as_index(-1)]["count"].as_index(0);
+			if(mode == 4) { //Triangles.
+				result.num_triangles += num_indices / 3;
+			} else if(num_indices >= 3) { //Triangle strip or fan.
+				result.num_triangles += num_indices - 2;
+			}
+
+			//The accessor states the bounding box of the untransformed vertices. Transform its corners to find the bounding box in the scene.
+			const Json& minimum = positions["min"];
+			const Json& maximum = positions["max"];
+			if(minimum.size() != 3 || maximum.size() != 3 || num_vertices == 0) {
+				continue;
+			}
+			const Matrix& m = instance.transformation;
+			for(size_t corner = 0; corner < 8; ++corner) {
+				const double x = ((corner & 1) ? maximum : minimum)[0].as_number(0);
+				const double y = ((corner & 2) ? maximum : minimum)[1].as_number(0);
+				const double z = ((corner & 4) ? maximum : minimum)[2].as_number(0);
+				result.include(Point3(m[0] * x + m[4] * y + m[8] * z + m[12], m[1] * x + m[5] * y + m[9] * z + m[13], m[2] * x + m[6] * y + m[10] * z + m[14]));
+			}
+		}
+	}
+}
+
+bool Glb::load_chunks(const char* data, const size_t size) {
+	constexpr uint32_t json_chunk = 0x4E4F534A; //"JSON" in little-endian.
+	constexpr uint32_t binary_chunk = 0x004E4942; //"BIN\0" in little-endian.
+	if(size < 20 || memcmp(data, "glTF", 4) != 0) {
+		return false;
+	}
+	uint32_t length;
+	memcpy(&length, data + 8, sizeof(length));
+	const size_t end = std::min(size, size_t(length)); //Ignore anything after the stated length, and don't trust it to be shorter than the file.
+
+	size_t position = 12;
+	bool first_chunk = true;
+	while(position + 8 <= end) {
+		uint32_t chunk_length;
+		uint32_t chunk_type;
+		memcpy(&chunk_length, data + position, sizeof(chunk_length));
+		memcpy(&chunk_type, data + position + 4, sizeof(chunk_type));
+		position += 8;
+		if(chunk_length > end - position) { //The chunk was cut off.
+			break;
+		}
+		if(first_chunk) { //The first chunk must be the JSON document.
+			if(chunk_type != json_chunk) {
+				return false;
+			}
+			document = Json::parse(std::string(data + position, chunk_length));
+			first_chunk = false;
+		} else if(chunk_type == binary_chunk && !binary) { //Only the first binary chunk is used. Other chunks are extensions that we don't know.
+			binary = data + position;
+			binary_size = chunk_length;
+		}
+		position += (chunk_length + 3) / 4 * 4; //Chunks are aligned to 4 bytes.
+	}
+	return document.type == Json::Type::OBJECT;
+}
+
+void Glb::find_instances() {
+	const Matrix identity = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+	//glTF uses metres with the Y axis pointing up, while 3MF uses millimetres (as we write it) with the Z axis pointing up.
+	const Matrix to_3mf = {1000, 0, 0, 0, 0, 0, 1000, 0, 0, -1000, 0, 0, 0, 0, 0, 1};
+
+	const Json& nodes = document["nodes"];
+	const Json& scene = document["scenes"][document["scene"].as_index(0)];
+	if(scene.type == Json::Type::OBJECT) {
+		const Json& scene_nodes = scene["nodes"];
+		for(size_t i = 0; i < scene_nodes.size(); ++i) {
+			add_node(scene_nodes[i].as_index(-1), to_3mf, 0);
+		}
+	} else if(nodes.size() > 0) { //No scene, so place all nodes that are not the child of another node.
+		std::vector<bool> is_child(nodes.size(), false);
+		for(size_t node_index = 0; node_index < nodes.size(); ++node_index) {
+			const Json& children = nodes[node_index]["children"];
+			for(size_t i = 0; i < children.size(); ++i) {
+				const size_t child = children[i].as_index(-1);
+				if(child < is_child.size()) {
+					is_child[child] = true;
+				}
+			}
+		}
+		for(size_t node_index = 0; node_index < nodes.size(); ++node_index) {
+			if(!is_child[node_index]) {
+				add_node(node_index, to_3mf, 0);
+			}
+		}
+	} else { //No nodes at all, so place each mesh once as it is.
+		const Json& meshes = document["meshes"];
+		for(size_t mesh_index = 0; mesh_index < meshes.size(); ++mesh_index) {
+			instances.push_back({mesh_index, multiply(to_3mf, identity), meshes[mesh_index]["name"].string});
+		}
+	}
+}
+
+void Glb::add_node(const size_t node_index, const Matrix& parent, const size_t depth) {
+	const Json& node = document["nodes"][node_index];
+	if(node.type != Json::Type::OBJECT || depth > document["nodes"].size()) { //Doesn't exist, or is its own ancestor.
+		return;
+	}
+	const Matrix transformation = multiply(parent, node_transformation(node));
+	const size_t mesh_index = node["mesh"].as_index(-1);
+	const Json& mesh = document["meshes"][mesh_index];
+	if(mesh.type == Json::Type::OBJECT) {
+		const std::string& name = node["name"].string.empty() ? mesh["name"].string : node["name"].string;
+		instances.push_back({mesh_index, transformation, name});
+	}
+	const Json& children = node["children"];
+	for(size_t i = 0; i < children.size(); ++i) {
+		add_node(children[i].as_index(-1), transformation, depth + 1);
+	}
+}
+
+bool Glb::find_accessor(const size_t accessor_index, const size_t num_components, Accessor& accessor) const {
+	const Json& accessor_json = document["accessors"][accessor_index];
+	const std::string expected_type = (num_components == 1) ? "SCALAR" : ("VEC" + std::to_string(num_components));
+	if(accessor_json.type != Json::Type::OBJECT || accessor_json["type"].string != expected_type) {
+		return false;
+	}
+	const Json& buffer_view = document["bufferViews"][accessor_json["bufferView"].as_index(-1)];
+	if(buffer_view.type != Json::Type::OBJECT || buffer_view["buffer"].as_index(-1) != 0 || document["buffers"][0]["uri"].type != Json::Type::NUL) { //Only the first buffer is stored in the file itself, and only if it has no URI.
+		return false;
+	}
+
+	accessor.component_type = accessor_json["componentType"].as_index(0);
+	size_t component_size;
+	switch(accessor.component_type) {
+		case 5120: //Signed byte.
+		case unsigned_byte: component_size = 1; break;
+		case 5122: //Signed short.
+		case unsigned_short: component_size = 2; break;
+		case unsigned_int:
+		case float32: component_size = 4; break;
+		default: return false;
+	}
+	const size_t element_size = component_size * num_components;
+	const size_t view_offset = buffer_view["byteOffset"].as_index(0);
+	const size_t view_length = buffer_view["byteLength"].as_index(0);
+	const size_t offset = accessor_json["byteOffset"].as_index(0);
+	accessor.count = accessor_json["count"].as_index(0);
+	accessor.stride = buffer_view["byteStride"].as_index(0);
+	if(accessor.stride == 0) { //Tightly packed.
+		accessor.stride = element_size;
+	}
+
+	//The whole array must fit in the buffer view, and the buffer view in the binary buffer.
+	if(view_offset > binary_size || view_length > binary_size - view_offset || offset > view_length) {
+		return false;
+	}
+	if(accessor.count > 0 && (view_length - offset < element_size || (accessor.count - 1) > (view_length - offset - element_size) / accessor.stride)) {
+		return false;
+	}
+	accessor.start = binary + view_offset + offset;
+	return true;
+}
+
+void Glb::add_primitive(const Json& primitive, const Matrix& transformation, Mesh& mesh) const {
+	constexpr size_t triangles_mode = 4;
+	constexpr size_t triangle_strip_mode = 5;
+	constexpr size_t triangle_fan_mode = 6;
+	const size_t mode = primitive["mode"].as_index(triangles_mode);
+	if(mode != triangles_mode && mode != triangle_strip_mode && mode != triangle_fan_mode) { //Points and lines are not saved.
+		return;
+	}
+
+	//The vertices are stored as 32-bit floats. Transform them to their place in the scene.
+	Accessor positions;
+	if(!find_accessor(primitive["attributes"]["POSITION"].as_index(-1), 3, positions) || positions.component_type != float32) {
+		return;
+	}
+	const size_t first_vertex = mesh.vertices.size();
+	mesh.vertices.reserve(first_vertex + positions.count);
+	const Matrix& m = transformation;
+	for(size_t vertex_index = 0; vertex_index < positions.count; ++vertex_index) {
+		float coordinates[3];
+		memcpy(coordinates, positions.start + vertex_index * positions.stride, sizeof(coordinates));
+		const double x = coordinates[0];
+		const double y = coordinates[1];
+		const double z = coordinates[2];
+		mesh.vertices.emplace_back(m[0] * x + m[4] * y + m[8] * z + m[12], m[1] * x + m[5] * y + m[9] * z + m[13], m[2] * x + m[6] * y + m[10] * z + m[14]);
+	}
+
+	//Without indices, the vertices are used in order.
+	Accessor indices = {nullptr, positions.count, 0, 0};
+	const Json& indices_json = primitive["indices"];
+	if(indices_json.type != Json::Type::NUL) {
+		if(!find_accessor(indices_json.as_index(-1), 1, indices) || (indices.component_type != unsigned_byte && indices.component_type != unsigned_short && indices.component_type != unsigned_int)) {
+			return;
+		}
+	}
+	auto index = [&indices](const size_t position) -> size_t {
+		switch(indices.component_type) {
+			case unsigned_byte: return static_cast<uint8_t>(indices.start[position * indices.stride]);
+			case unsigned_short: {
+				uint16_t value;
+				memcpy(&value, indices.start + position * indices.stride, sizeof(value));
+				return value;
+			}
+			case unsigned_int: {
+				uint32_t value;
+				memcpy(&value, indices.start + position * indices.stride, sizeof(value));
+				return value;
+			}
+			default: return position;
+		}
+	};
+
+	//Mirroring transformations turn the triangles inside out, so then they need to be turned around.
+	const double determinant = m[0] * (m[5] * m[10] - m[9] * m[6]) - m[4] * (m[1] * m[10] - m[9] * m[2]) + m[8] * (m[1] * m[6] - m[5] * m[2]);
+	const bool mirrored = determinant < 0;
+	auto add_triangle = [&mesh, first_vertex, &positions, mirrored](const size_t a, const size_t b, const size_t c) {
+		if(a >= positions.count || b >= positions.count || c >= positions.count || a == b || b == c || a == c) { //Refers to a vertex that doesn't exist, or is degenerate.
+			return;
+		}
+		if(mirrored) {
+			mesh.triangles.push_back({first_vertex + a, first_vertex + c, first_vertex + b});
+		} else {
+			mesh.triangles.push_back({first_vertex + a, first_vertex + b, first_vertex + c});
+		}
+	};
+	if(mode == triangles_mode) {
+		mesh.triangles.reserve(mesh.triangles.size() + indices.count / 3);
+		for(size_t i = 0; i + 2 < indices.count; i += 3) {
+			add_triangle(index(i), index(i + 1), index(i + 2));
+		}
+	} else if(mode == triangle_strip_mode) {
+		for(size_t i = 0; i + 2 < indices.count; ++i) {
+			if(i % 2 == 0) {
+				add_triangle(index(i), index(i + 1), index(i + 2));
+			} else { //Every other triangle of a strip is in the opposite direction.
+				add_triangle(index(i + 1), index(i), index(i + 2));
+			}
+		}
+	} else { //Triangle fan.
+		for(size_t i = 1; i + 1 < indices.count; ++i) {
+			add_triangle(index(0), index(i), index(i + 1));
+		}
+	}
+}
+
+Model Glb::to_model() const {
+	Model model; //The resulting model.
+	model.meshes.resize(instances.size());
+
+	//The instances are independent of each other, so they can be converted in parallel.
+	parallel_for(instances.size(), [this, &model](const size_t instance_index) {
+		const Instance& instance = instances[instance_index];
+		Mesh& mesh = model.meshes[instance_index];
+		mesh.name = instance.name;
+		const Json& primitives = document["meshes"][instance.mesh_index]["primitives"];
+		for(size_t i = 0; i < primitives.size(); ++i) {
+			add_primitive(primitives[i], instance.transformation, mesh);
+		}
+		if(monitor) {
+			monitor->advance(0, mesh.triangles.size());
+		}
+	});
+	return model;
+}
+
+Glb::Matrix Glb::node_transformation(const Json& node) {
+	Matrix result = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+	const Json& matrix = node["matrix"];
+	if(matrix.size() == 16) {
+		for(size_t i = 0; i < 16; ++i) {
+			result[i] = matrix[i].as_number(result[i]);
+		}
+		return result;
+	}
+
+	//Otherwise the transformation is a translation, a rotation as quaternion and a scale, applied in reverse order.
+	const Json& translation = node["translation"];
+	const Json& rotation = node["rotation"];
+	const Json& scale = node["scale"];
+	const double x = rotation[0].as_number(0);
+	const double y = rotation[1].as_number(0);
+	const double z = rotation[2].as_number(0);
+	const double w = rotation[3].as_number(1);
+	const double rotation_matrix[3][3] = { //Indexed by row, then column.
+		{1 - 2 * (y * y + z * z), 2 * (x * y - z * w), 2 * (x * z + y * w)},
+		{2 * (x * y + z * w), 1 - 2 * (x * x + z * z), 2 * (y * z - x * w)},
+		{2 * (x * z - y * w), 2 * (y * z + x * w), 1 - 2 * (x * x + y * y)}
+	};
+	for(size_t column = 0; column < 3; ++column) {
+		const double column_scale = scale[column].as_number(1);
+		for(size_t row = 0; row < 3; ++row) {
+			result[column * 4 + row] = rotation_matrix[row][column] * column_scale;
+		}
+		result[12 + column] = translation[column].as_number(0);
+	}
+	return result;
+}
+
+Glb::Matrix Glb::multiply(const Matrix& first, const Matrix& second) {
+	Matrix result;
+	for(size_t column = 0; column < 4; ++column) {
+		for(size_t row = 0; row < 4; ++row) {
+			double sum = 0;
+			for(size_t k = 0; k < 4; ++k) {
+				sum += first[k * 4 + row] * second[column * 4 + k];
+			}
+			result[column * 4 + row] = sum;
+		}
+	}
+	return result;
+}
+
+}
\ No newline at end of file
@@ -6,34 +6,190 @@
  * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
  */
 
-#include <iostream> //To communicate progress via stdcout.
+#include <algorithm> //To move the meshes of multiple files into one model, and to count how often the standard input is used.
+#include <fstream> //To find the total size of the input files.
+#include <iostream> //To write the 3MF file to the standard output.
+#include <iterator> //To append the meshes of multiple files to one model.
+#include <exception> //To report any failure of a conversion without stopping the application.
+#include <stdexcept> //To report failures to write the output and invalid inputs.
 
+#include "convert.hpp" //To import from the standard input.
 #include "detect_file_type.hpp" //To detect which type of file this is.
+#include "estimate.hpp" //To estimate whether the conversion fits in the memory budget.
+#include "glb.hpp" //To import binary glTF files.
 #include "job.hpp" //The definitions for this file.
 #include "model.hpp" //To store models as intermediary representation.
 #include "obj.hpp" //To import OBJ files.
+#include "parallel.hpp" //To import multiple files in parallel.
+#include "ply.hpp" //To import PLY files.
 #include "stl_ascii.hpp" //To import ASCII STL files.
 #include "stl_binary.hpp" //To import binary STL files.
 #include "threemf.hpp" //To write 3MF files.
+#include "trace.hpp" //To record a trace of the conversion.
 
 namespace convertto3mf {
 
-Job::Job(const std::string& input_filename, const std::string& output_filename) :
-		input_filename(input_filename),
-		output_filename(output_filename) {};
+Job::Job(const std::string& input_filename, const std::string& output_filename, const Options& options) :
+		input_filenames({input_filename}),
+		output_filename(output_filename),
+		options(options) {};
 
-void Job::run() {
-	std::cout << "Converting " << input_filename << " to " << output_filename << std::endl;
+Job::Job(const std::vector<std::string>& input_filenames, const std::string& output_filename, const Options& options) :
+		input_filenames(input_filenames),
+		output_filename(output_filename),
+		options(options) {};
 
-	FileType file_type = detect_file_type(input_filename);
+bool Job::run() {
+	if(!options.trace_filename.empty()) {
+		Trace::start();
+	}
+	if(options.monitor) {
+		for(const std::string& input_filename : input_filenames) {
+			options.monitor->log("Converting " + input_filename + " to " + output_filename);
+		}
+	}
+
+	bool completed = true;
+	try {
+		if(std::count(input_filenames.begin(), input_filenames.end(), "-") > 1) { //The importers would race to read it, and each would only get part of it.
+			throw std::runtime_error("The standard input can only be converted once.");
+		}
+		if(options.max_memory > 0) {
+			admit();
+		}
+		if(options.monitor) {
+			size_t total_bytes = 0; //Stays 0 if any input is of unknown size.
+			for(const std::string& input_filename : input_filenames) {
+				if(input_filename == "-") {
+					total_bytes = 0;
+					break;
+				}
+				std::ifstream input_file(input_filename, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+				total_bytes += static_cast<size_t>(std::max(std::streamoff(0), std::streamoff(input_file.tellg())));
+			}
+			options.monitor->start_phase(Monitor::Phase::IMPORT, total_bytes);
+		}
+
+		//Import all files in parallel, then combine their meshes in the order of the input files.
+		std::vector<Model> input_models(input_filenames.size());
+		parallel_for(input_filenames.size(), [this, &input_models](const size_t input_index) {
+			input_models[input_index] = import(input_filenames[input_index], options);
+		});
+		Model model;
+		if(input_models.size() == 1) {
+			model = std::move(input_models[0]);
+		} else {
+			for(Model& input_model : input_models) {
+				std::move(input_model.meshes.begin(), input_model.meshes.end(), std::back_inserter(model.meshes));
+				input_model = Model(); //Free the memory of the now-empty meshes.
+			}
+		}
+
+		if(output_filename == "-") {
+			if(options.monitor) {
+				options.monitor->log("Writing 3MF file to standard output.");
+			}
+			std::streambuf* standard_output = std::cout.rdbuf();
+			ThreeMF::export_to_callback(model, options, [standard_output](const char* data, const size_t size) {
+				if(standard_output->sputn(data, size) != std::streamsize(size)) {
+					throw std::runtime_error("Could not write to the standard output.");
+				}
+			});
+			if(standard_output->pubsync() != 0) {
+				throw std::runtime_error("Could not write to the standard output.");
+			}
+		} else {
+			ThreeMF::export_to_file(output_filename, model, options);
+		}
+	} catch(const Cancelled& cancelled) { //No output is left behind. Any existing output file stays unchanged.
+		if(options.monitor) {
+			options.monitor->log(std::string("Conversion cancelled: ") + cancelled.what(), Monitor::Severity::FAILURE);
+		}
+		completed = false;
+	} catch(const std::exception& error) { //The inputs were invalid, too big to fit in memory, or writing the output failed. Any existing output file stays unchanged.
+		if(options.monitor) {
+			options.monitor->log(std::string("Conversion failed: ") + error.what(), Monitor::Severity::FAILURE);
+		}
+		completed = false;
+	}
+	if(!options.trace_filename.empty()) {
+		Trace::write(options.trace_filename);
+		if(options.monitor) {
+			options.monitor->log("Wrote trace to " + options.trace_filename);
+		}
+	}
+	return completed;
+}
+
+void Job::admit() {
+	if(std::find(input_filenames.begin(), input_filenames.end(), "-") != input_filenames.end()) { //The standard input can only be read once, so it can't be estimated beforehand.
+		return;
+	}
+	std::vector<Estimate> estimates;
+	for(const std::string& input_filename : input_filenames) {
+		estimates.push_back(Estimate::estimate(input_filename, options));
+	}
+	auto peak_memory = [this, &estimates]() {
+		size_t total = 0; //All files are imported at the same time, so their memory adds up.
+		for(Estimate& estimate : estimates) {
+			estimate.predict(options);
+			total += estimate.peak_memory;
+		}
+		return total;
+	};
+	constexpr size_t megabyte = 1024 * 1024;
+	size_t estimated = peak_memory();
+	if(estimated > options.max_memory && !options.streaming && !ThreeMF::needs_all_triangles(options)) { //Streaming the faces of OBJ files takes less memory.
+		options.streaming = true;
+		const size_t streamed = peak_memory();
+		if(streamed < estimated) {
+			if(options.monitor) {
+				options.monitor->log("The estimated peak memory usage of " + std::to_string(estimated / megabyte) + "MB exceeds the budget of " + std::to_string(options.max_memory / megabyte) + "MB. Streaming the faces of OBJ files to use " + std::to_string(streamed / megabyte) + "MB instead.");
+			}
+			estimated = streamed;
+		} else { //There are no OBJ files.
+			options.streaming = false;
+		}
+	}
+	if(estimated > options.max_memory) {
+		throw Cancelled("The estimated peak memory usage of " + std::to_string(estimated / megabyte) + "MB exceeds the budget of " + std::to_string(options.max_memory / megabyte) + "MB.");
+	}
+}
+
+Model Job::import(const std::string& input_filename, const Options& options) {
 	Model model;
+	if(input_filename == "-") {
+		if(options.monitor) {
+			options.monitor->log("Importing from standard input.");
+		}
+		model = import_from_stream(std::cin, options.monitor.get());
+		return model; //The standard input has no file name to name the meshes after.
+	}
+	FileType file_type = detect_file_type(input_filename);
 	switch(file_type) {
-		case FileType::OBJ: model = Obj::import(input_filename); break;
-		case FileType::STL_BINARY: model = StlBinary::import(input_filename); break;
-		case FileType::STL_ASCII: model = StlAscii::import(input_filename); break;
+		case FileType::OBJ: model = options.streaming ? Obj::import_streaming(input_filename, options.monitor.get()) : Obj::import(input_filename, options.monitor.get()); break;
+		case FileType::STL_BINARY: model = StlBinary::import(input_filename, options.monitor.get()); break;
+		case FileType::STL_ASCII: model = StlAscii::import(input_filename, options.monitor.get()); break;
+		case FileType::PLY: model = Ply::import(input_filename, options.monitor.get()); break;
+		case FileType::GLB: model = Glb::import(input_filename, options.monitor.get()); break;
 	}
 
-	ThreeMF::export_to_file(output_filename, model);
+	//Name the meshes after the file, without its directory and extension, unless the file gave them a name of its own.
+	std::string name = input_filename;
+	const size_t directory_end = name.find_last_of("/\\");
+	if(directory_end != std::string::npos) {
+		name = name.substr(directory_end + 1);
+	}
+	const size_t extension_start = name.rfind('.');
+	if(extension_start != std::string::npos && extension_start > 0) {
+		name = name.substr(0, extension_start);
+	}
+	for(Mesh& mesh : model.meshes) {
+		if(mesh.name.empty()) {
+			mesh.name = name;
+		}
+	}
+	return model;
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,187 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <cstdlib> //To parse the numbers in records.
+#include <fstream> //To read the existing records, and to find the size of files on other systems.
+#include <vector> //To split records into fields.
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CONVERTTO3MF_POSIX_FILES //Syncing to disk and modification times are only implemented for POSIX systems. Other systems only flush, and compare sizes.
+#include <sys/stat.h> //To find the size and modification time of files.
+#include <unistd.h> //To sync the journal to disk.
+#endif
+
+#include "journal.hpp" //The definitions for this file.
+#include "zip_reader.hpp" //To check whether outputs are complete archives.
+
+namespace convertto3mf {
+
+constexpr std::chrono::seconds Journal::sync_interval;
+
+Journal::Journal(const std::string& filename) :
+		file(nullptr),
+		unsynced_records(0),
+		last_sync(std::chrono::steady_clock::now()) {
+	//Read the records of earlier runs.
+	bool ends_with_newline = true;
+	std::ifstream existing(filename, std::ios_base::in | std::ios_base::binary);
+	std::string line;
+	while(std::getline(existing, line)) {
+		ends_with_newline = !existing.eof(); //The last line may have been cut off by a crash.
+		std::vector<std::string> fields;
+		size_t field_start = 0;
+		size_t field_end;
+		while((field_end = line.find('\t', field_start)) != std::string::npos) {
+			fields.push_back(line.substr(field_start, field_end - field_start));
+			field_start = field_end + 1;
+		}
+		fields.push_back(line.substr(field_start));
+		if(fields.size() != 5 || fields[4].empty()) { //Not a complete record.
+			continue;
+		}
+		Entry entry;
+		entry.input_size = strtoull(fields[1].c_str(), nullptr, 10);
+		entry.input_mtime = strtoll(fields[2].c_str(), nullptr, 10);
+		entry.output_filename = unescape(fields[3]);
+		entry.output_size = strtoull(fields[4].c_str(), nullptr, 10);
+		completed[unescape(fields[0])] = entry;
+	}
+	existing.close();
+
+	file = std::fopen(filename.c_str(), "ab");
+	if(file && !ends_with_newline) { //Don't append to a record that was cut off, but start a new line.
+		std::fputc('\n', file);
+	}
+}
+
+Journal::~Journal() {
+	if(file) {
+		sync();
+		std::fclose(file);
+	}
+}
+
+bool Journal::is_open() const {
+	return file != nullptr;
+}
+
+size_t Journal::size() const {
+	return completed.size();
+}
+
+bool Journal::is_completed(const std::string& input_filename, const std::string& output_filename) const {
+	const std::unordered_map<std::string, Entry>::const_iterator entry = completed.find(input_filename);
+	if(entry == completed.end() || entry->second.output_filename != output_filename) {
+		return false;
+	}
+	uint64_t input_size;
+	int64_t input_mtime;
+	if(!stat_file(input_filename, input_size, input_mtime) || input_size != entry->second.input_size || input_mtime != entry->second.input_mtime) { //The input changed since.
+		return false;
+	}
+	uint64_t output_size;
+	int64_t output_mtime;
+	if(!stat_file(output_filename, output_size, output_mtime) || output_size != entry->second.output_size) { //The output is missing, or was cut off or replaced.
+		return false;
+	}
+
+	//The output must still be a complete archive, with all files intact.
+	return ZipReader(output_filename).verify();
+}
+
+bool Journal::record(const std::string& input_filename, const std::string& output_filename) {
+	Entry entry;
+	int64_t output_mtime;
+	if(!stat_file(input_filename, entry.input_size, entry.input_mtime) || !stat_file(output_filename, entry.output_size, output_mtime)) {
+		return false;
+	}
+	entry.output_filename = output_filename;
+	completed[input_filename] = entry;
+	if(!file) {
+		return true;
+	}
+
+	const std::string line = escape(input_filename) + "\t" + std::to_string(entry.input_size) + "\t" + std::to_string(entry.input_mtime) + "\t" + escape(output_filename) + "\t" + std::to_string(entry.output_size) + "\n";
+	std::fwrite(line.data(), 1, line.size(), file);
+	std::fflush(file); //Survives a crash of this process right away. Only a crash of the system can lose it until it's synced.
+	unsynced_records++;
+	if(unsynced_records >= sync_records || std::chrono::steady_clock::now() - last_sync >= sync_interval) {
+		sync();
+	}
+	return true;
+}
+
+void Journal::sync() {
+	if(!file) {
+		return;
+	}
+	std::fflush(file);
+#ifdef CONVERTTO3MF_POSIX_FILES
+	fsync(fileno(file));
+#endif
+	unsynced_records = 0;
+	last_sync = std::chrono::steady_clock::now();
+}
+
+bool Journal::stat_file(const std::string& filename, uint64_t& size, int64_t& mtime) {
+#ifdef CONVERTTO3MF_POSIX_FILES
+	struct stat status;
+	if(stat(filename.c_str(), &status) != 0) {
+		return false;
+	}
+	size = status.st_size;
+#ifdef __APPLE__
+	mtime = static_cast<int64_t>(status.st_mtimespec.tv_sec) * 1000000000 + status.st_mtimespec.tv_nsec;
+#else
+	mtime = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+	return true;
+#else
+	std::ifstream file(filename, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+	if(!file.is_open()) {
+		return false;
+	}
+	size = file.tellg();
+	mtime = 0;
+	return true;
+#endif
+}
+
+std::string Journal::escape(const std::string& field) {
+	std::string result;
+	result.reserve(field.size());
+	for(const char character : field) {
+		switch(character) {
+			case '\\': result += "\\\\"; break;
+			case '\t': result += "\\t"; break;
+			case '\n': result += "\\n"; break;
+			default: result += character;
+		}
+	}
+	return result;
+}
+
+std::string Journal::unescape(const std::string& field) {
+	std::string result;
+	result.reserve(field.size());
+	for(size_t i = 0; i < field.size(); ++i) {
+		if(field[i] != '\\' || i + 1 >= field.size()) {
+			result += field[i];
+			continue;
+		}
+		i++;
+		switch(field[i]) {
+			case 't': result += '\t'; break;
+			case 'n': result += '\n'; break;
+			default: result += field[i]; //Including the backslash itself.
+		}
+	}
+	return result;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,231 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <cmath> //To check whether numbers are whole.
+#include <cstdlib> //To parse numbers.
+#include <cstring> //To compare keywords.
+
+#include "json.hpp" //The definitions for this file.
+
+namespace convertto3mf {
+
+const Json Json::null;
+
+Json Json::parse(const std::string& text) {
+	Json result;
+	const char* cursor = text.c_str(); //Null-terminated, so that numbers can be parsed with strtod.
+	const char* end = cursor + text.size();
+	if(!parse_value(cursor, end, result, 0) || cursor != end) {
+		return Json();
+	}
+	return result;
+}
+
+const Json& Json::operator [](const std::string& key) const {
+	if(type != Type::OBJECT) {
+		return null;
+	}
+	for(size_t i = 0; i < keys.size(); ++i) {
+		if(keys[i] == key) {
+			return elements[i];
+		}
+	}
+	return null;
+}
+
+const Json& Json::operator [](const size_t index) const {
+	if(type != Type::ARRAY || index >= elements.size()) {
+		return null;
+	}
+	return elements[index];
+}
+
+size_t Json::size() const {
+	return (type == Type::ARRAY) ? elements.size() : 0;
+}
+
+double Json::as_number(const double fallback) const {
+	return (type == Type::NUMBER) ? number : fallback;
+}
+
+size_t Json::as_index(const size_t fallback) const {
+	if(type != Type::NUMBER || number < 0 || number != std::floor(number)) {
+		return fallback;
+	}
+	return static_cast<size_t>(number);
+}
+
+bool Json::parse_value(const char*& cursor, const char* end, Json& value, const size_t depth) {
+	if(depth > max_depth) {
+		return false;
+	}
+	skip_whitespace(cursor, end);
+	if(cursor >= end) {
+		return false;
+	}
+	switch(*cursor) {
+		case '{': {
+			value.type = Type::OBJECT;
+			cursor++;
+			skip_whitespace(cursor, end);
+			if(cursor < end && *cursor == '}') {
+				cursor++;
+				break;
+			}
+			while(true) {
+				skip_whitespace(cursor, end);
+				std::string key;
+				if(cursor >= end || *cursor != '"' || !parse_string(cursor, end, key)) {
+					return false;
+				}
+				skip_whitespace(cursor, end);
+				if(cursor >= end || *cursor != ':') {
+					return false;
+				}
+				cursor++;
+				value.keys.push_back(key);
+				value.elements.emplace_back();
+				if(!parse_value(cursor, end, value.elements.back(), depth + 1)) {
+					return false;
+				}
+				if(cursor < end && *cursor == ',') {
+					cursor++;
+					continue;
+				}
+				if(cursor < end && *cursor == '}') {
+					cursor++;
+					break;
+				}
+				return false;
+			}
+			break;
+		}
+		case '[': {
+			value.type = Type::ARRAY;
+			cursor++;
+			skip_whitespace(cursor, end);
+			if(cursor < end && *cursor == ']') {
+				cursor++;
+				break;
+			}
+			while(true) {
+				value.elements.emplace_back();
+				if(!parse_value(cursor, end, value.elements.back(), depth + 1)) {
+					return false;
+				}
+				if(cursor < end && *cursor == ',') {
+					cursor++;
+					continue;
+				}
+				if(cursor < end && *cursor == ']') {
+					cursor++;
+					break;
+				}
+				return false;
+			}
+			break;
+		}
+		case '"':
+			value.type = Type::STRING;
+			if(!parse_string(cursor, end, value.string)) {
+				return false;
+			}
+			break;
+		case 't':
+		case 'f':
+		case 'n': {
+			const char* keyword = (*cursor == 't') ? "true" : ((*cursor == 'f') ? "false" : "null");
+			const size_t keyword_length = strlen(keyword);
+			if(size_t(end - cursor) < keyword_length || strncmp(cursor, keyword, keyword_length) != 0) {
+				return false;
+			}
+			value.type = (*cursor == 'n') ? Type::NUL : Type::BOOLEAN;
+			value.boolean = *cursor == 't';
+			cursor += keyword_length;
+			break;
+		}
+		default: {
+			char* number_end;
+			value.number = strtod(cursor, &number_end);
+			if(number_end == cursor || number_end > end) {
+				return false;
+			}
+			value.type = Type::NUMBER;
+			cursor = number_end;
+		}
+	}
+	skip_whitespace(cursor, end);
+	return true;
+}
+
+bool Json::parse_string(const char*& cursor, const char* end, std::string& result) {
+	cursor++; //Skip the opening quote.
+	while(cursor < end) {
+		const char character = *cursor++;
+		if(character == '"') {
+			return true;
+		}
+		if(character != '\\') {
+			result += character;
+			continue;
+		}
+		if(cursor >= end) {
+			return false;
+		}
+		const char escaped = *cursor++;
+		switch(escaped) {
+			case 'b': result += '\b'; break;
+			case 'f': result += '\f'; break;
+			case 'n': result += '\n'; break;
+			case 'r': result += '\r'; break;
+			case 't': result += '\t'; break;
+			case 'u': {
+				if(end - cursor < 4) {
+					return false;
+				}
+				const std::string hex(cursor, 4);
+				unsigned long code_point = strtoul(hex.c_str(), nullptr, 16);
+				cursor += 4;
+				if(code_point >= 0xD800 && code_point < 0xDC00 && end - cursor >= 6 && cursor[0] == '\\' && cursor[1] == 'u') { //Surrogate pair.
+					const unsigned long low = strtoul(std::string(cursor + 2, 4).c_str(), nullptr, 16);
+					if(low >= 0xDC00 && low < 0xE000) {
+						code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+						cursor += 6;
+					}
+				}
+				//Encode as UTF-8.
+				if(code_point < 0x80) {
+					result += char(code_point);
+				} else if(code_point < 0x800) {
+					result += char(0xC0 | (code_point >> 6));
+					result += char(0x80 | (code_point & 0x3F));
+				} else if(code_point < 0x10000) {
+					result += char(0xE0 | (code_point >> 12));
+					result += char(0x80 | ((code_point >> 6) & 0x3F));
+					result += char(0x80 | (code_point & 0x3F));
+				} else {
+					result += char(0xF0 | (code_point >> 18));
+					result += char(0x80 | ((code_point >> 12) & 0x3F));
+					result += char(0x80 | ((code_point >> 6) & 0x3F));
+					result += char(0x80 | (code_point & 0x3F));
+				}
+				break;
+			}
+			default: result += escaped; //Quotes, slashes and backslashes.
+		}
+	}
+	return false; //The string doesn't end.
+}
+
+void Json::skip_whitespace(const char*& cursor, const char* end) {
+	while(cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) {
+		cursor++;
+	}
+}
+
+}
\ No newline at end of file
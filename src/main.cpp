@@ -6,10 +6,19 @@
  * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
  */
 
+#include <chrono> //To enforce deadlines and limit how often progress is shown.
+#include <cstdlib> //To parse numbers in the arguments.
 #include <iostream> //To show the help contents in the stdcout.
+#include <iterator> //To read the standard input when probing it.
+#include <memory> //To share the monitor with the conversion.
+#include <vector> //To store multiple input filenames.
 
+#include "batch.hpp" //To start batches of conversions.
+#include "estimate.hpp" //To predict the memory usage and duration without converting anything.
 #include "job.hpp" //To start conversion jobs.
 #include "main.hpp" //Definitions for this file.
+#include "prefetcher.hpp" //For the default number of files to prefetch in a batch.
+#include "probe.hpp" //To summarise files without converting them.
 
 /*!
  * Entry point into the program.
@@ -24,27 +33,156 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 	//The 0th argument is the executable name. We're not interested in that.
-	//The first argument is required to be the input filename.
-	const std::string input_filename(argv[1]);
+	//Every argument that isn't an optional parameter is an input filename. At least one is required.
+	std::vector<std::string> input_filenames;
+	for(size_t i = 1; i < argc; ++i) {
+		std::string argument(argv[i]);
+		if(argument.find("--") != 0) {
+			input_filenames.push_back(argument);
+		}
+	}
+	if(input_filenames.empty()) {
+		convertto3mf::show_help();
+		return 1;
+	}
 
-	//For the default output filename, take the input with the file extension changed.
-	std::string output_filename = input_filename;
-	int extension_start = output_filename.rfind('.');
-	if(extension_start >= 0) { //Remove the extension if there is one.
-		output_filename = output_filename.substr(0, extension_start);
+	//When probing, only summarise each file as one line of JSON, without converting anything.
+	for(size_t i = 1; i < argc; ++i) {
+		if(std::string(argv[i]) != "--probe") {
+			continue;
+		}
+		for(const std::string& input_filename : input_filenames) {
+			if(input_filename == "-") {
+				const std::string data((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+				std::cout << convertto3mf::Probe::probe(data.data(), data.size(), input_filename).to_json(input_filename) << std::endl;
+			} else {
+				std::cout << convertto3mf::Probe::probe(input_filename).to_json(input_filename) << std::endl;
+			}
+		}
+		return 0;
+	}
+
+	//For the default output filename, take the first input with the file extension changed.
+	std::string output_filename = input_filenames[0];
+	if(input_filenames[0] == "-") { //Reading from the standard input, so by default write to the standard output.
+		output_filename = "-";
+	} else {
+		int extension_start = output_filename.rfind('.');
+		if(extension_start >= 0) { //Remove the extension if there is one.
+			output_filename = output_filename.substr(0, extension_start);
+		}
+		output_filename += ".3mf"; //Add a new extension.
 	}
-	output_filename += ".3mf"; //Add a new extension.
 
 	//Parse the rest as optional parameters.
-	for(size_t i = 2; i < argc; ++i) {
+	convertto3mf::Options options;
+	std::string output_directory; //In a batch, the output is a directory.
+	std::string journal_filename;
+	size_t prefetch = convertto3mf::Prefetcher::default_lookahead;
+	for(size_t i = 1; i < argc; ++i) {
 		std::string argument(argv[i]);
 		if(argument.find("--output=") == 0) {
 			output_filename = argument.substr(9);
+			output_directory = output_filename;
+		} else if(argument.find("--journal=") == 0) {
+			journal_filename = argument.substr(10);
+		} else if(argument.find("--prefetch=") == 0) {
+			prefetch = strtoull(argument.substr(11).c_str(), nullptr, 10);
+		} else if(argument == "--split-parts") {
+			options.split_parts = true;
+		} else if(argument.find("--split-parts=") == 0) {
+			options.split_parts = true;
+			options.part_max_triangles = strtoull(argument.substr(14).c_str(), nullptr, 10);
+		} else if(argument == "--reorder") {
+			options.reorder = true;
+		} else if(argument == "--instancing") {
+			options.instancing = true;
+		} else if(argument == "--validate") {
+			options.validate = true;
+		} else if(argument.find("--max-triangles=") == 0) {
+			options.max_triangles = strtoull(argument.substr(16).c_str(), nullptr, 10);
+		} else if(argument == "--split-components") {
+			options.split_components = true;
+		} else if(argument == "--stream") {
+			options.streaming = true;
+		} else if(argument.find("--precision=") == 0) {
+			options.precision = strtoull(argument.substr(12).c_str(), nullptr, 10);
+		} else if(argument.find("--quantize=") == 0) {
+			options.quantize = strtod(argument.substr(11).c_str(), nullptr);
+		} else if(argument.find("--trace=") == 0) {
+			options.trace_filename = argument.substr(8);
+		} else if(argument.find("--max-memory=") == 0) {
+			options.max_memory = strtoull(argument.substr(13).c_str(), nullptr, 10) * 1024 * 1024;
 		}
 	}
 
-	convertto3mf::Job job(input_filename, output_filename);
-	job.run();
+	//When estimating, only predict the memory usage and duration of converting each file with these options, as one line of JSON per file.
+	for(size_t i = 1; i < argc; ++i) {
+		if(std::string(argv[i]) != "--estimate") {
+			continue;
+		}
+		for(const std::string& input_filename : input_filenames) {
+			if(input_filename == "-") {
+				const std::string data((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+				std::cout << convertto3mf::Estimate::estimate(data.data(), data.size(), input_filename, options).to_json(input_filename) << std::endl;
+			} else {
+				std::cout << convertto3mf::Estimate::estimate(input_filename, options).to_json(input_filename) << std::endl;
+			}
+		}
+		return 0;
+	}
+
+	//Messages, progress and deadlines all go through the monitor.
+	bool show_progress = false;
+	double deadline_seconds = 0;
+	for(size_t i = 1; i < argc; ++i) {
+		std::string argument(argv[i]);
+		if(argument == "--progress") {
+			show_progress = true;
+		} else if(argument.find("--deadline=") == 0) {
+			deadline_seconds = strtod(argument.substr(11).c_str(), nullptr);
+		}
+	}
+	convertto3mf::Monitor::Callback progress_callback;
+	if(show_progress) {
+		//Show the progress at most twice per second, and whenever a new phase starts.
+		std::shared_ptr<std::chrono::steady_clock::time_point> last_shown = std::make_shared<std::chrono::steady_clock::time_point>();
+		std::shared_ptr<convertto3mf::Monitor::Phase> last_phase = std::make_shared<convertto3mf::Monitor::Phase>(convertto3mf::Monitor::Phase::IMPORT);
+		progress_callback = [last_shown, last_phase](const convertto3mf::Monitor::Progress& progress) {
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if(progress.phase == *last_phase && now - *last_shown < std::chrono::milliseconds(500)) {
+				return;
+			}
+			*last_shown = now;
+			*last_phase = progress.phase;
+			std::cerr << "Progress: " << convertto3mf::Monitor::name(progress.phase) << ", " << progress.bytes;
+			if(progress.total_bytes > 0) {
+				std::cerr << " of " << progress.total_bytes;
+			}
+			std::cerr << " bytes, " << progress.triangles << " triangles." << std::endl;
+		};
+	}
+	std::ostream* messages = (output_filename == "-" && journal_filename.empty()) ? &std::cerr : &std::cout; //When the 3MF file is written to the standard output, messages need to go elsewhere.
+	options.monitor = std::make_shared<convertto3mf::Monitor>(progress_callback, [messages](const std::string& message, const convertto3mf::Monitor::Severity severity) {
+		std::ostream& stream = (severity == convertto3mf::Monitor::Severity::FAILURE) ? std::cerr : *messages;
+		stream << message << std::endl;
+	});
+	if(deadline_seconds > 0) {
+		options.monitor->set_deadline(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(deadline_seconds)));
+	}
+
+	if(!journal_filename.empty()) { //Convert each file separately, skipping the ones that were converted before.
+		convertto3mf::Batch batch(input_filenames, output_directory, journal_filename, options);
+		batch.prefetch = prefetch;
+		if(!batch.run()) {
+			return 1;
+		}
+		return 0;
+	}
+	convertto3mf::Job job(input_filenames, output_filename, options);
+	if(!job.run()) {
+		return 1;
+	}
 
 	return 0;
 }
@@ -54,13 +192,30 @@ namespace convertto3mf {
 void show_help() {
 	std::cout << "Convert 3D models to 3MF.\n"
 		"Usage:\n"
-		"  convertto3mf filename [--output=output_filename]\n"
+		"  convertto3mf filename [filename...] [--output=output_filename] [--split-parts[=max_triangles]] [--reorder] [--instancing] [--validate] [--max-triangles=count] [--split-components] [--stream] [--precision=digits] [--quantize=step] [--trace=trace_filename] [--progress] [--deadline=seconds] [--journal=journal_filename] [--prefetch=count] [--max-memory=megabytes] [--probe] [--estimate]\n"
 		"\n"
 		"Required parameters:\n"
-		"  * filename: The name of the input file to convert to 3MF.\n"
+		"  * filename: The name of the input file to convert to 3MF. Use - to read from the standard input. If multiple files are given, all of their meshes are combined into one 3MF file, with each mesh named after its file.\n"
 		"\n"
 		"Optional parameters:\n"
-		"  * --output=output_filename: Store the resulting 3MF file in the specified location. By default, the result will be stored in the same location as the input file, but with the file extension changed to .3mf." << std::endl;
+		"  * --output=output_filename: Store the resulting 3MF file in the specified location. Use - to write to the standard output. By default, the result will be stored in the same location as the (first) input file, but with the file extension changed to .3mf. When reading from the standard input, the result is written to the standard output by default.\n"
+		"  * --split-parts[=max_triangles]: Write each mesh to its own model part in the archive, using the 3MF Production extension. Meshes with more than max_triangles triangles are split over multiple parts. By default, parts are at most 1000000 triangles. Use 0 to never split meshes.\n"
+		"  * --reorder: Sort the vertices and triangles of each mesh for locality before writing them. This makes the output smaller and faster to load.\n"
+		"  * --instancing: Store meshes that are identical apart from their position only once, and place that mesh multiple times in the build.\n"
+		"  * --validate: Check the meshes for holes, flipped triangles, non-manifold edges and degenerate triangles, and report how many were found, with a few locations of each. The output is written unchanged.\n"
+		"  * --max-triangles=count: Simplify the meshes until they have at most this many triangles in total, for instance to make light previews. Each mesh gets a share in proportion to its size.\n"
+		"  * --split-components: Write each connected part of a mesh as a separate object. This is useful for formats that can only hold one mesh, such as STL.\n"
+		"  * --stream: Write the faces of OBJ files straight into the 3MF file, keeping only the vertices in memory. The OBJ file is read twice. This has no effect when combined with options that need all triangles in memory, such as --reorder, --instancing, --validate, --max-triangles, --split-components and --split-parts.\n"
+		"  * --precision=digits: Write coordinates with this many significant digits. By default, this is 6.\n"
+		"  * --quantize=step: Snap all coordinates to a grid of this size, in micrometres, before making the vertices unique. Vertices that end up in the same place are merged, and triangles that collapse are removed. The coordinates are then written exactly with the fewest decimals, which makes the output much smaller and faster to write.\n"
+		"  * --trace=trace_filename: Record how long each stage of the conversion takes on each thread, and write it to a file in the Chrome trace event format.\n"
+		"  * --progress: Regularly show how far the conversion got in each phase, on the standard error.\n"
+		"  * --deadline=seconds: Cancel the conversion if it takes longer than this. The output file is then not written, and any existing output file is left unchanged.\n"
+		"  * --journal=journal_filename: Convert each input file to its own 3MF file, and record the completed conversions in the journal. When run again with the same journal, files that were converted before are skipped, unless the file or its 3MF file changed since. With this option, --output specifies the directory to store the 3MF files in.\n"
+		"  * --prefetch=count: In a batch with --journal, load this many of the next input files into memory in the background while converting the current one. By default, this is 4. Use 0 to only read files when they are converted.\n"
+		"  * --probe: Don't convert anything, but print the format, size, number of triangles and vertices, bounding box and estimated 3MF size of each file, as one line of JSON per file.\n"
+		"  * --max-memory=megabytes: Estimate the peak memory usage before converting. If it exceeds this budget, stream the faces of OBJ files if possible, or else refuse to convert. The estimate can be off by some 20%, so leave some margin.\n"
+		"  * --estimate: Don't convert anything, but predict the peak memory usage in bytes and the duration in seconds of converting each file with the given options, as one line of JSON per file. Large files are only sampled, so their numbers are approximate." << std::endl;
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,71 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <fstream> //To read files that can't be mapped.
+#include <iterator> //To read whole files into a buffer.
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CONVERTTO3MF_MMAP //Memory mapping is only implemented for POSIX systems. Other systems read the file into a buffer.
+#include <fcntl.h> //To open files for mapping.
+#include <sys/mman.h> //To map files into memory.
+#include <sys/stat.h> //To find the size of files.
+#include <unistd.h> //To close the file after mapping.
+#endif
+
+#include "mapped_file.hpp" //The definitions for this file.
+
+namespace convertto3mf {
+
+MappedFile::MappedFile(const std::string& filename) :
+		contents(nullptr),
+		length(0),
+		is_mapped(false) {
+#ifdef CONVERTTO3MF_MMAP
+	const int file_descriptor = open(filename.c_str(), O_RDONLY);
+	if(file_descriptor >= 0) {
+		struct stat status;
+		if(fstat(file_descriptor, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+			void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+			if(mapping != MAP_FAILED) {
+				madvise(mapping, status.st_size, MADV_SEQUENTIAL); //Most readers go through the file from start to end.
+				contents = static_cast<const char*>(mapping);
+				length = status.st_size;
+				is_mapped = true;
+			}
+		}
+		close(file_descriptor); //The mapping stays valid after closing the file.
+		if(is_mapped) {
+			return;
+		}
+	}
+#endif
+
+	//Mapping failed or is not available. Read the whole file into memory instead.
+	std::ifstream file_handle(filename, std::ios_base::in | std::ios_base::binary);
+	buffer.assign(std::istreambuf_iterator<char>(file_handle), std::istreambuf_iterator<char>());
+	contents = buffer.data();
+	length = buffer.size();
+}
+
+MappedFile::~MappedFile() {
+#ifdef CONVERTTO3MF_MMAP
+	if(is_mapped) {
+		munmap(const_cast<char*>(contents), length);
+	}
+#endif
+}
+
+const char* MappedFile::data() const {
+	return contents;
+}
+
+size_t MappedFile::size() const {
+	return length;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include "memory_buffer.hpp" //The definitions for this file.
+
+namespace convertto3mf {
+
+MemoryBuffer::MemoryBuffer(const char* data, const size_t size) {
+	char* begin = const_cast<char*>(data); //The stream buffer interface needs non-const pointers, but only reads from them.
+	setg(begin, begin, begin + size);
+}
+
+std::streambuf::pos_type MemoryBuffer::seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) {
+	if(!(which & std::ios_base::in)) { //This buffer can't be written to.
+		return pos_type(off_type(-1));
+	}
+	char* base = eback(); //Where to move relative to.
+	if(direction == std::ios_base::cur) {
+		base = gptr();
+	} else if(direction == std::ios_base::end) {
+		base = egptr();
+	}
+	if(offset < eback() - base || offset > egptr() - base) { //Outside of the memory.
+		return pos_type(off_type(-1));
+	}
+	setg(eback(), base + offset, egptr());
+	return pos_type(gptr() - eback());
+}
+
+std::streambuf::pos_type MemoryBuffer::seekpos(pos_type position, std::ios_base::openmode which) {
+	return seekoff(off_type(position), std::ios_base::beg, which);
+}
+
+}
\ No newline at end of file
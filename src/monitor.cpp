@@ -0,0 +1,85 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <limits> //To indicate that there is no deadline.
+
+#include "monitor.hpp" //The definitions for this file.
+
+namespace convertto3mf {
+
+Cancelled::Cancelled(const std::string& reason) : std::runtime_error(reason) {};
+
+Monitor::Monitor(const Callback& callback, const LogCallback& log_callback) :
+		callback(callback),
+		log_callback(log_callback),
+		cancelled(false),
+		deadline(std::numeric_limits<std::chrono::steady_clock::rep>::max()),
+		phase(Phase::IMPORT),
+		bytes(0),
+		total_bytes(0),
+		triangles(0) {};
+
+void Monitor::cancel() {
+	cancelled = true;
+}
+
+void Monitor::set_deadline(const std::chrono::steady_clock::time_point deadline) {
+	this->deadline = deadline.time_since_epoch().count();
+}
+
+bool Monitor::is_cancelled() const {
+	if(cancelled.load(std::memory_order_relaxed)) {
+		return true;
+	}
+	const std::chrono::steady_clock::rep deadline_ticks = deadline.load(std::memory_order_relaxed);
+	return deadline_ticks != std::numeric_limits<std::chrono::steady_clock::rep>::max() && std::chrono::steady_clock::now().time_since_epoch().count() >= deadline_ticks;
+}
+
+void Monitor::check() const {
+	if(cancelled.load(std::memory_order_relaxed)) {
+		throw Cancelled("The conversion was cancelled.");
+	}
+	if(is_cancelled()) {
+		throw Cancelled("The deadline of the conversion passed.");
+	}
+}
+
+void Monitor::start_phase(const Phase phase, const size_t total_bytes) {
+	this->phase = phase;
+	this->total_bytes = total_bytes;
+	bytes = 0;
+	triangles = 0;
+	advance(0, 0);
+}
+
+void Monitor::advance(const size_t bytes, const size_t triangles) {
+	const Progress progress = {phase, this->bytes += bytes, total_bytes, this->triangles += triangles};
+	if(callback) {
+		std::lock_guard<std::mutex> lock(callback_mutex);
+		callback(progress);
+	}
+	check();
+}
+
+void Monitor::log(const std::string& message, const Severity severity) {
+	if(log_callback) {
+		std::lock_guard<std::mutex> lock(log_mutex);
+		log_callback(message, severity);
+	}
+}
+
+const char* Monitor::name(const Phase phase) {
+	switch(phase) {
+		case Phase::IMPORT: return "importing";
+		case Phase::WELD: return "welding";
+		case Phase::WRITE: return "writing";
+	}
+	return "";
+}
+
+}
\ No newline at end of file
@@ -6,18 +6,22 @@
  * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
  */
 
-#include <iostream> //To message progress.
-#include <algorithm> //For std::min.
+#include <algorithm> //To remove invalid vertex indices from faces.
 #include <fstream> //To read OBJ files.
+#include <memory> //To share the state of streamed OBJ files between batches of faces.
 #include <regex> //To detect whether this is an OBJ file.
 #include <string> //To process the content of OBJ files.
+#include <unordered_map> //To make vertices unique, and to find groups by name.
 
+#include "memory_buffer.hpp" //To read mapped OBJ files as streams.
 #include "obj.hpp" //Definitions for this class.
 #include "model.hpp" //To write models.
+#include "parallel.hpp" //To convert objects and groups in parallel.
+#include "trace.hpp" //To measure how long parsing takes.
 
 namespace convertto3mf {
 
-float Obj::is_obj(const std::string& filename) {
+float Obj::is_obj(const std::string& filename, const std::string& sample) {
 	float probability = 1.0 / 3.0; //Final result.
 	//Probability of a file extension being different from the contents of the file. Probably an overestimation but we want to let the magic number determine it more.
 	constexpr float probability_incorrect_extension = 0.01;
@@ -31,16 +35,7 @@ float Obj::is_obj(const std::string& filename) {
 		probability = probability_incorrect_extension;
 	}
 
-	//Read 1kB from the file to see if the file appears to be correctly formatted for OBJ.
-	std::ifstream file_handle(filename);
-	file_handle.seekg(0, file_handle.end);
-	size_t sample_size = file_handle.tellg();
-	file_handle.seekg(file_handle.beg);
-	sample_size = std::min(sample_size, size_t(1024)); //Limit to 1kB.
-	char sample_chars[sample_size];
-	file_handle.read(sample_chars, sample_size);
-	std::string sample(sample_chars); //We've read up to 1kB from this file now.
-
+	//Look at the first 1kB of the file to see if the file appears to be correctly formatted for OBJ.
 	//Match a line with this complicated regex that captures almost every possible line in OBJ files.
 	const std::regex correct_line("^\\\\?$|((#|mtllib |usemtl |o |g |s |mg |cstype ).*|v[np]? [-+]?\\d*\\.?\\d+([eE][-+]?\\d+)? [-+]?\\d*\\.?\\d+([eE][-+]?\\d+)? [-+]?\\d*\\.?\\d+([eE][-+]?\\d+)?|vt [-+]?\\d*\\.?\\d+([eE][-+]?\\d+)? [-+]?\\d*\\.?\\d+([eE][-+]?\\d+)?|(f|p|l|curv|curv2|surf)( -?\\d+(\\/\\d*)?(\\/\\d+)?)+)\\\\?");
 	size_t correct_lines = 0;
@@ -66,152 +61,373 @@ float Obj::is_obj(const std::string& filename) {
 	return probability;
 }
 
-Model Obj::import(const std::string& filename) {
-	std::cout << "Importing Wavefront OBJ file: " << filename << std::endl;
+Model Obj::import(const std::string& filename, Monitor* monitor) {
+	if(monitor) {
+		monitor->log("Importing Wavefront OBJ file: " + filename);
+	}
+	std::ifstream file_handle(filename);
+	return import(file_handle, monitor);
+}
+
+Model Obj::import(std::istream& stream, Monitor* monitor) {
+	Trace::Span span("parse");
 	Obj obj; //Store the OBJ file in its own representation.
+	obj.monitor = monitor;
 
-	std::vector<std::string> lines = obj.preprocess(filename);
+	std::vector<std::string> lines = obj.preprocess(stream);
 	obj.load(lines);
+	size_t num_faces = 0;
+	for(const Group& group : obj.groups) {
+		num_faces += group.faces.size();
+	}
+	span.set_items(num_faces);
 	return obj.to_model();
 }
 
-std::vector<std::string> Obj::preprocess(const std::string& filename) const {
-	std::ifstream file_handle(filename);
-	std::vector<std::string> lines; //Result of the pre-processing step.
-	lines.reserve(32000); //Most files are going to contain at least this amount of lines. Prevent copying too often when growing.
-	for(std::string line; std::getline(file_handle, line);) {
-		//Trim whitespace from the line.
-		size_t first = line.find_first_not_of(" \t\n\r\f");
-		if(first == std::string::npos) {
-			line = "";
-		} else {
-			size_t last = line.find_last_not_of(" \t\n\r\f");
-			line = line.substr(first, (last - first + 1));
-		}
+Model Obj::import_streaming(const std::string& filename, Monitor* monitor) {
+	if(monitor) {
+		monitor->log("Streaming Wavefront OBJ file: " + filename);
+	}
+	Trace::Span span("parse vertices");
+	std::shared_ptr<StreamedFaces> streamed_faces = std::make_shared<StreamedFaces>(filename);
+	span.set_bytes(streamed_faces->file.size());
+	MemoryBuffer buffer(streamed_faces->file.data(), streamed_faces->file.size());
+	std::istream stream(&buffer);
+
+	Model model; //The resulting model.
+	model.meshes.emplace_back(); //Faces are only read while writing, so they can't be separated into objects and groups.
+	Mesh& mesh = model.meshes.back();
 
-		//Process line continuation.
-		if(!lines.empty() && lines.back()[lines.back().length() - 1] == '\\') { //Previous line had a line continuation.
-			lines[lines.size() - 1][lines.back().length() - 1] = ' '; //Turn the backslash into a space.
-			lines[lines.size() - 1] += line; //Add the new line.
-		} else {
-			lines.push_back(line);
+	//Read only the vertices, and make them unique. Keep track of where the batches of faces start.
+	std::unordered_map<Point3, size_t> vertex_to_index; //For each unique vertex, tracks the index within the vertex list.
+	std::vector<size_t>& vertex_remap = streamed_faces->vertex_remap;
+	streamed_faces->batch_starts.push_back(0);
+	streamed_faces->batch_vertex_counts.push_back(0);
+	size_t faces_in_batch = 0;
+	Point3 vertex(0, 0, 0);
+	size_t line_index = 0;
+	size_t reported_position = 0;
+	for(std::string line; read_line(stream, line); ++line_index) {
+		if(monitor && line_index % Monitor::report_interval == 0 && !stream.eof()) {
+			const size_t position = stream.tellg();
+			monitor->advance(position - reported_position, 0);
+			reported_position = position;
+		}
+		if(parse_vertex(line, vertex)) {
+			const std::pair<std::unordered_map<Point3, size_t>::iterator, bool> inserted = vertex_to_index.emplace(vertex, mesh.vertices.size());
+			if(inserted.second) { //Not yet in the mesh.
+				mesh.vertices.push_back(vertex);
+			}
+			vertex_remap.push_back(inserted.first->second);
+		} else if(line.find("f ") == 0) {
+			faces_in_batch++;
+			if(faces_in_batch >= stream_batch_size) { //Start a new batch after this line.
+				streamed_faces->batch_starts.push_back(stream.eof() ? streamed_faces->file.size() : size_t(stream.tellg()));
+				streamed_faces->batch_vertex_counts.push_back(vertex_remap.size());
+				faces_in_batch = 0;
+			}
 		}
 	}
-	return lines;
+	streamed_faces->batch_starts.push_back(streamed_faces->file.size());
+	span.set_items(vertex_remap.size());
+	if(monitor) {
+		monitor->advance(streamed_faces->file.size() - reported_position, 0);
+	}
+
+	for(size_t batch = 0; batch < streamed_faces->batch_vertex_counts.size(); ++batch) {
+		mesh.triangle_batches.push_back([streamed_faces, batch](std::vector<std::array<size_t, 3>>& triangles) {
+			streamed_faces->triangulate(batch, triangles);
+		});
+	}
+	return model;
 }
 
-void Obj::load(const std::vector<std::string>& lines) {
-	for(const std::string& line : lines) {
-		if(line.find("v ") == 0) { //This line defines a vertex.
-			size_t x_start = line.find_first_not_of(' ', 1);
-			if(x_start == std::string::npos) {
-				continue; //The line was just "v     " with a number of spaces but no X coordinate.
-			}
-			size_t x_end = line.find(' ', x_start);
-			if(x_end == std::string::npos) {
-				continue; //There was no space after the X coordinate, meaning that there is no Y coordinate.
-			}
-			size_t y_start = line.find_first_not_of(' ', x_end);
-			if(y_start == std::string::npos) {
-				continue; //There were just a number of spaces after the X coordinate, no Y coordinate.
-			}
-			size_t y_end = line.find(' ', y_start);
-			if(y_end == std::string::npos) {
-				continue; //There was no space after the Y coordinate, meaning that there is no Z coordinate.
+void Obj::probe(const char* data, const size_t size, Probe& result) {
+	result.indexed = true;
+	Probe::visit_lines(data, size, [](const char* line, const size_t length, Probe& probe) {
+		const char* end = line + length;
+		while(line < end && (*line == ' ' || *line == '\t')) {
+			line++;
+		}
+		if(end - line < 2 || (line[1] != ' ' && line[1] != '\t')) { //Not a vertex or face.
+			return;
+		}
+		if(line[0] == 'v') {
+			Point3 vertex(0, 0, 0);
+			if(Probe::parse_vertex(line + 2, end, vertex)) {
+				probe.num_vertices++;
+				probe.include(vertex);
 			}
-			size_t z_start = line.find_first_not_of(' ', y_end);
-			if(z_start == std::string::npos) {
-				continue; //There were just a number of spaces after the Y coordinate, no Z coordinate.
+		} else if(line[0] == 'f') { //Count the vertices of the face, which is split into a triangle fan.
+			size_t num_face_vertices = 0;
+			bool in_word = false;
+			for(const char* character = line + 1; character < end; ++character) {
+				const bool is_space = *character == ' ' || *character == '\t';
+				if(!is_space && !in_word) {
+					num_face_vertices++;
+				}
+				in_word = !is_space;
 			}
-			size_t z_end = line.find(' ', z_start);
-			if(z_end == std::string::npos) {
-				z_end = line.length(); //No spaces after the Z coordinate. That's all right though, just cut it off at the end of the string.
+			if(num_face_vertices >= 3) {
+				probe.num_triangles += num_face_vertices - 2;
 			}
+		}
+	}, result);
+}
 
-			const std::string x_str = line.substr(x_start, x_end - x_start);
-			const std::string y_str = line.substr(y_start, y_end - y_start);
-			const std::string z_str = line.substr(z_start, z_end - z_start);
+Obj::StreamedFaces::StreamedFaces(const std::string& filename) : file(filename) {};
 
-			//Convert everything to our coordinate type.
-			char* end;
-			const coord_t x = strtod(x_str.c_str(), &end);
-			if(*end) { //Not a number.
-				continue;
-			}
-			const coord_t y = strtod(y_str.c_str(), &end);
-			if(*end) {
-				continue;
-			}
-			const coord_t z = strtod(z_str.c_str(), &end);
-			if(*end) {
-				continue;
-			}
+void Obj::StreamedFaces::triangulate(const size_t batch, std::vector<std::array<size_t, 3>>& triangles) const {
+	Trace::Span span("parse");
+	span.set_bytes(batch_starts[batch + 1] - batch_starts[batch]);
+	const size_t triangles_before = triangles.size();
+	MemoryBuffer buffer(file.data() + batch_starts[batch], batch_starts[batch + 1] - batch_starts[batch]);
+	std::istream stream(&buffer);
+	size_t num_vertices = batch_vertex_counts[batch]; //Negative indices are relative to the vertices defined so far.
+	std::vector<size_t> vertex_indices;
+	Point3 vertex(0, 0, 0);
+	for(std::string line; read_line(stream, line);) {
+		if(parse_vertex(line, vertex)) {
+			num_vertices++;
+			continue;
+		}
+		if(line.find("f ") != 0) {
+			continue;
+		}
+		vertex_indices.clear();
+		parse_face(line, num_vertices, vertex_indices);
+		vertex_indices.erase(std::remove_if(vertex_indices.begin(), vertex_indices.end(), [this](const size_t vertex_index) {
+			return vertex_index >= vertex_remap.size(); //Index doesn't exist.
+		}), vertex_indices.end());
+
+		//Each face is a triangle fan.
+		for(size_t i = 2; i < vertex_indices.size(); ++i) {
+			triangles.push_back({vertex_remap[vertex_indices[0]], vertex_remap[vertex_indices[i - 1]], vertex_remap[vertex_indices[i]]});
+		}
+	}
+	span.set_items(triangles.size() - triangles_before);
+}
+
+std::vector<std::string> Obj::preprocess(std::istream& stream) const {
+	std::vector<std::string> lines; //Result of the pre-processing step.
+	lines.reserve(32000); //Most files are going to contain at least this amount of lines. Prevent copying too often when growing.
+	size_t unreported_bytes = 0; //Bytes read since the last time progress was reported.
+	for(std::string line; read_line(stream, line);) {
+		unreported_bytes += line.length() + 1; //Approximately, since the line was trimmed.
+		lines.push_back(line);
+		if(monitor && lines.size() % Monitor::report_interval == 0) {
+			monitor->advance(unreported_bytes, 0);
+			unreported_bytes = 0;
+		}
+	}
+	if(monitor) {
+		monitor->advance(unreported_bytes, 0);
+	}
+	return lines;
+}
+
+bool Obj::read_line(std::istream& stream, std::string& line) {
+	if(!std::getline(stream, line)) {
+		return false;
+	}
+	trim(line);
+
+	//Process line continuation.
+	std::string next_line;
+	while(!line.empty() && line[line.length() - 1] == '\\' && std::getline(stream, next_line)) {
+		trim(next_line);
+		line[line.length() - 1] = ' '; //Turn the backslash into a space.
+		line += next_line; //Add the new line.
+	}
+	return true;
+}
 
-			//Successfully parsed a vertex! Let's store it now that everything is safe.
-			vertices.emplace_back(x, y, z);
+void Obj::trim(std::string& line) {
+	size_t first = line.find_first_not_of(" \t\n\r\f");
+	if(first == std::string::npos) {
+		line = "";
+	} else {
+		size_t last = line.find_last_not_of(" \t\n\r\f");
+		line = line.substr(first, (last - first + 1));
+	}
+}
+
+void Obj::load(const std::vector<std::string>& lines) {
+	std::unordered_map<std::string, size_t> group_to_index; //For each group name, tracks the index within the group list.
+	std::string group_name; //Faces before the first object or group statement get a group without a name.
+	size_t current_group = std::string::npos; //Groups are only created once they get a face, so that there are no empty meshes.
+	Point3 vertex(0, 0, 0);
+	size_t unreported_faces = 0; //Faces found since the last time progress was reported.
+	for(size_t line_index = 0; line_index < lines.size(); ++line_index) {
+		const std::string& line = lines[line_index];
+		if(monitor && line_index % Monitor::report_interval == 0) {
+			monitor->advance(0, unreported_faces);
+			unreported_faces = 0;
+		}
+		if(parse_vertex(line, vertex)) {
+			vertices.push_back(vertex);
 		} else if(line.find("f ") == 0) { //This line defines a face.
+			unreported_faces++;
+			if(current_group == std::string::npos) { //First face of this group.
+				current_group = group_to_index.emplace(group_name, groups.size()).first->second;
+				if(current_group == groups.size()) { //Not seen before.
+					groups.emplace_back();
+					groups.back().name = group_name;
+				}
+			}
 			std::vector<size_t> vertex_indices; //Resulting indices from this line.
 			vertex_indices.reserve(3);
-			size_t pos = 1; //Start searching for vertices from here.
-			while(pos != std::string::npos) { //For each vertex.
-				pos = line.find_first_not_of(' ', pos);
-				if(pos == std::string::npos) { //There's just space now, no new vertex.
-					break;
-				}
-				const size_t corner_start = pos;
-				pos = line.find(' ', corner_start);
-				const size_t corner_end = (pos == std::string::npos) ? line.length() : pos; //If there is no more space, stop at the end of the string.
-				const std::string corner = line.substr(corner_start, corner_end - corner_start);
-
-				//For now we're only interested in the index to the vertex, not in normals or texture coordinates.
-				size_t vertex_end = corner.find('/');
-				if(vertex_end == std::string::npos) {
-					vertex_end = corner.length();
-				}
-				const std::string vertex_index_str = corner.substr(0, vertex_end);
+			parse_face(line, vertices.size(), vertex_indices);
+			groups[current_group].faces.push_back(vertex_indices);
+		} else if(parse_group(line, group_name)) {
+			current_group = std::string::npos;
+		}
+	}
+	if(monitor) {
+		monitor->advance(0, unreported_faces);
+	}
+}
 
-				//Convert to index.
-				char* end;
-				long vertex_index = strtol(vertex_index_str.c_str(), &end, 10);
-				if(*end) { //Not an integer.
-					continue;
-				}
-				if(vertex_index == 0) { //Vertices are 1-indexed. 0 should not occur.
-					continue;
-				}
-				if(vertex_index < 0) { //Negative indices refer to the most recent vertices.
-					vertex_index += vertices.size() + 1;
-					if(vertex_index < 1) { //Too far back. This would be before the start.
-						continue;
-					}
-				}
+bool Obj::parse_vertex(const std::string& line, Point3& vertex) {
+	if(line.find("v ") != 0) { //This line doesn't define a vertex.
+		return false;
+	}
+	size_t x_start = line.find_first_not_of(' ', 1);
+	if(x_start == std::string::npos) {
+		return false; //The line was just "v     " with a number of spaces but no X coordinate.
+	}
+	size_t x_end = line.find(' ', x_start);
+	if(x_end == std::string::npos) {
+		return false; //There was no space after the X coordinate, meaning that there is no Y coordinate.
+	}
+	size_t y_start = line.find_first_not_of(' ', x_end);
+	if(y_start == std::string::npos) {
+		return false; //There were just a number of spaces after the X coordinate, no Y coordinate.
+	}
+	size_t y_end = line.find(' ', y_start);
+	if(y_end == std::string::npos) {
+		return false; //There was no space after the Y coordinate, meaning that there is no Z coordinate.
+	}
+	size_t z_start = line.find_first_not_of(' ', y_end);
+	if(z_start == std::string::npos) {
+		return false; //There were just a number of spaces after the Y coordinate, no Z coordinate.
+	}
+	size_t z_end = line.find(' ', z_start);
+	if(z_end == std::string::npos) {
+		z_end = line.length(); //No spaces after the Z coordinate. That's all right though, just cut it off at the end of the string.
+	}
 
-				//Index is correct. We can store it.
-				vertex_indices.push_back(vertex_index - 1);
-			}
+	const std::string x_str = line.substr(x_start, x_end - x_start);
+	const std::string y_str = line.substr(y_start, y_end - y_start);
+	const std::string z_str = line.substr(z_start, z_end - z_start);
+
+	//Convert everything to our coordinate type.
+	char* end;
+	const coord_t x = strtod(x_str.c_str(), &end);
+	if(*end) { //Not a number.
+		return false;
+	}
+	const coord_t y = strtod(y_str.c_str(), &end);
+	if(*end) {
+		return false;
+	}
+	const coord_t z = strtod(z_str.c_str(), &end);
+	if(*end) {
+		return false;
+	}
+
+	//Successfully parsed a vertex!
+	vertex = Point3(x, y, z);
+	return true;
+}
 
-			faces.push_back(vertex_indices);
+void Obj::parse_face(const std::string& line, const size_t num_vertices, std::vector<size_t>& vertex_indices) {
+	size_t pos = 1; //Start searching for vertices from here.
+	while(pos != std::string::npos) { //For each vertex.
+		pos = line.find_first_not_of(' ', pos);
+		if(pos == std::string::npos) { //There's just space now, no new vertex.
+			break;
+		}
+		const size_t corner_start = pos;
+		pos = line.find(' ', corner_start);
+		const size_t corner_end = (pos == std::string::npos) ? line.length() : pos; //If there is no more space, stop at the end of the string.
+		const std::string corner = line.substr(corner_start, corner_end - corner_start);
+
+		//For now we're only interested in the index to the vertex, not in normals or texture coordinates.
+		size_t vertex_end = corner.find('/');
+		if(vertex_end == std::string::npos) {
+			vertex_end = corner.length();
+		}
+		const std::string vertex_index_str = corner.substr(0, vertex_end);
+
+		//Convert to index.
+		char* end;
+		long vertex_index = strtol(vertex_index_str.c_str(), &end, 10);
+		if(*end) { //Not an integer.
+			continue;
+		}
+		if(vertex_index == 0) { //Vertices are 1-indexed. 0 should not occur.
+			continue;
+		}
+		if(vertex_index < 0) { //Negative indices refer to the most recent vertices.
+			vertex_index += num_vertices + 1;
+			if(vertex_index < 1) { //Too far back. This would be before the start.
+				continue;
+			}
 		}
+
+		//Index is correct. We can store it.
+		vertex_indices.push_back(vertex_index - 1);
 	}
 }
 
+bool Obj::parse_group(const std::string& line, std::string& name) {
+	if(line != "o" && line != "g" && line.find("o ") != 0 && line.find("g ") != 0) { //This line doesn't start an object or group.
+		return false;
+	}
+	name = line.substr(1);
+	trim(name);
+	return true;
+}
+
 Model Obj::to_model() const {
 	Model model; //The resulting model.
-	model.meshes.emplace_back(); //OBJ files always contain just a single mesh.
-	Mesh& mesh = model.meshes.back();
+	model.meshes.resize(groups.size()); //Each object or group becomes a separate mesh.
 
-	for(std::vector<size_t> vertex_indices : faces) {
-		mesh.faces.emplace_back();
-		Face& face = mesh.faces.back();
+	//The groups are independent of each other, so they can be converted in parallel.
+	parallel_for(groups.size(), [this, &model](const size_t group_index) {
+		const Group& group = groups[group_index];
+		Mesh& mesh = model.meshes[group_index];
+		mesh.name = group.name;
+		mesh.triangles.reserve(group.faces.size()); //Would be correct if all faces are triangles.
 
-		//Dereference all the indices from the OBJ file.
-		for(size_t vertex_index : vertex_indices) {
-			if(vertex_index >= vertices.size()) { //Index doesn't exist.
-				continue;
+		//Index only the vertices that this group uses. Vertices in the same position are merged, so the mesh doesn't need to be welded again.
+		std::unordered_map<size_t, size_t> obj_to_mesh; //For each vertex of the OBJ file that this group uses, its index in the mesh.
+		std::unordered_map<Point3, size_t> vertex_to_index; //For each unique vertex, its index in the mesh.
+		std::vector<size_t> face;
+		for(const std::vector<size_t>& vertex_indices : group.faces) {
+			face.clear();
+			for(const size_t vertex_index : vertex_indices) {
+				if(vertex_index >= vertices.size()) { //Index doesn't exist.
+					continue;
+				}
+				std::unordered_map<size_t, size_t>::const_iterator mesh_index = obj_to_mesh.find(vertex_index);
+				if(mesh_index == obj_to_mesh.end()) { //First time this group uses this vertex.
+					const std::pair<std::unordered_map<Point3, size_t>::iterator, bool> inserted = vertex_to_index.emplace(vertices[vertex_index], mesh.vertices.size());
+					if(inserted.second) { //Not yet in the mesh.
+						mesh.vertices.push_back(vertices[vertex_index]);
+					}
+					mesh_index = obj_to_mesh.emplace(vertex_index, inserted.first->second).first;
+				}
+				face.push_back(mesh_index->second);
+			}
+
+			//Each face is a triangle fan.
+			for(size_t i = 2; i < face.size(); ++i) {
+				mesh.triangles.push_back({face[0], face[i - 1], face[i]});
 			}
-			face.vertices.push_back(vertices[vertex_index]);
 		}
-	}
+	});
 
 	return model;
 }
@@ -0,0 +1,530 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //For std::min and std::reverse.
+#include <cctype> //To find where the numbers of ASCII files end.
+#include <cstdint> //To read fixed-width binary values.
+#include <cstdlib> //To parse the numbers of ASCII files.
+#include <cstring> //To read binary values with memcpy.
+#include <limits> //To reject vertex indices that are too large.
+#include <sstream> //To split header lines into words.
+
+#include "mapped_file.hpp" //To read the file without copying it.
+#include "ply.hpp" //The definitions for this file.
+#include "trace.hpp" //To measure how long parsing takes.
+
+namespace convertto3mf {
+
+float Ply::is_ply(const std::string& filename, const std::string& sample) {
+	float probability = 1.0 / 3.0; //Final result.
+	//Probability of a file extension being different from the contents of the file. Probably an overestimation but we want to let the magic number determine it more.
+	constexpr float probability_incorrect_extension = 0.01;
+	//Probability of a file starting with the PLY magic number and a format line while not being a PLY file.
+	constexpr float probability_incorrect_magic = 0.0001;
+
+	//File extension plays a role in likelihood.
+	if(filename.length() >= 4 && filename.compare(filename.length() - 4, 4, ".ply") == 0) {
+		probability = 1 - probability_incorrect_extension;
+	} else {
+		probability = probability_incorrect_extension;
+	}
+
+	//PLY files start with the magic line "ply", followed by a line stating the format.
+	const bool correct_magic = (sample.find("ply\n") == 0 || sample.find("ply\r\n") == 0) && sample.find("format ") != std::string::npos;
+
+	if(correct_magic) {
+		probability = 1.0 - ((1.0 - probability) * probability_incorrect_magic);
+	} else {
+		probability *= probability_incorrect_magic;
+	}
+
+	return probability;
+}
+
+Model Ply::import(const std::string& filename, Monitor* monitor) {
+	if(monitor) {
+		monitor->log("Importing PLY file: " + filename);
+	}
+	const MappedFile file(filename);
+	return import(file.data(), file.size(), monitor);
+}
+
+Model Ply::import(const char* data, const size_t size, Monitor* monitor) {
+	Trace::Span span("parse");
+	span.set_bytes(size);
+	Ply ply; //Store the PLY file in its own representation.
+	ply.monitor = monitor;
+
+	const size_t position = ply.load_header(data, size);
+	if(position == 0) { //Invalid header. We can't know what the data means.
+		return ply.to_model();
+	}
+	if(ply.format == Format::ASCII) {
+		ply.load_ascii(data, size, position);
+	} else {
+		ply.load_binary(data, size, position);
+	}
+	ply.report_progress(size);
+	span.set_items(ply.triangles.size());
+	return ply.to_model();
+}
+
+void Ply::probe(const char* data, const size_t size, Probe& result) {
+	result.indexed = true;
+	Ply ply;
+	size_t position = ply.load_header(data, size);
+	if(position == 0) { //Invalid header. We can't know what the data means.
+		return;
+	}
+	const bool swap_bytes = ply.format == Format::BINARY_BIG_ENDIAN;
+
+	const char* cursor = data + position; //Only for ASCII files.
+	for(const Element& element : ply.elements) {
+		size_t indices_property = element.properties.size();
+		bool has_coordinates = false;
+		bool fixed_size = true;
+		size_t stride = 0;
+		for(size_t property_index = 0; property_index < element.properties.size(); ++property_index) {
+			const Property& property = element.properties[property_index];
+			if(property.is_list) {
+				fixed_size = false;
+				if(property.name == "vertex_indices" || property.name == "vertex_index") {
+					indices_property = property_index;
+				}
+			}
+			if(property.name == "x") {
+				has_coordinates = true;
+			}
+			stride += type_size(property.type);
+		}
+		const bool is_vertex = element.name == "vertex" && has_coordinates;
+		const bool is_face = element.name == "face" && indices_property < element.properties.size();
+		if(ply.format != Format::ASCII && fixed_size && !is_vertex) { //Nothing to read in here, so skip the whole element at once.
+			position += std::min(element.count, stride > 0 ? (size - position) / stride : 0) * stride;
+			continue;
+		}
+
+		for(size_t element_index = 0; element_index < element.count; ++element_index) {
+			Point3 vertex(0, 0, 0);
+			for(size_t property_index = 0; property_index < element.properties.size(); ++property_index) {
+				const Property& property = element.properties[property_index];
+				double value; //The value of the property, or the length of the list.
+				if(ply.format == Format::ASCII) {
+					if(!read_ascii_value(cursor, data + size, value)) { //Not a number, or end of file.
+						return;
+					}
+				} else {
+					const Type type = property.is_list ? property.count_type : property.type;
+					if(position + type_size(type) > size) { //File is truncated.
+						return;
+					}
+					value = read_value(data + position, type, swap_bytes);
+					position += type_size(type);
+				}
+				if(!property.is_list) {
+					if(is_vertex && property.name == "x") {
+						vertex.x = value;
+					} else if(is_vertex && property.name == "y") {
+						vertex.y = value;
+					} else if(is_vertex && property.name == "z") {
+						vertex.z = value;
+					}
+					continue;
+				}
+				if(!(value >= 0)) { //Negative or not a number.
+					return;
+				}
+				const size_t list_length = to_size(value);
+				if(is_face && property_index == indices_property && list_length >= 3) { //Faces are split into triangle fans.
+					result.num_triangles += list_length - 2;
+				}
+				//Skip over the items of the list.
+				if(ply.format == Format::ASCII) {
+					for(size_t item = 0; item < list_length; ++item) {
+						double item_value;
+						if(!read_ascii_value(cursor, data + size, item_value)) {
+							return;
+						}
+					}
+				} else {
+					if(list_length > (size - position) / std::max(size_t(1), type_size(property.type))) {
+						return;
+					}
+					position += list_length * type_size(property.type);
+				}
+			}
+			if(is_vertex) {
+				result.num_vertices++;
+				result.include(vertex);
+			}
+		}
+	}
+}
+
+size_t Ply::load_header(const char* data, const size_t size) {
+	format = Format::ASCII;
+	size_t position = 0;
+	while(position < size) {
+		//Read one line of the header.
+		const char* line_end = static_cast<const char*>(memchr(data + position, '\n', size - position));
+		if(!line_end) { //Header doesn't end.
+			return 0;
+		}
+		std::string line(data + position, line_end - data - position);
+		position = line_end - data + 1;
+		if(!line.empty() && line.back() == '\r') { //Remove carriage returns if it's in this file.
+			line.pop_back();
+		}
+
+		std::istringstream words(line);
+		std::string keyword;
+		words >> keyword;
+		if(keyword == "end_header") {
+			return position;
+		} else if(keyword == "format") {
+			std::string format_name;
+			words >> format_name;
+			if(format_name == "binary_little_endian") {
+				format = Format::BINARY_LITTLE_ENDIAN;
+			} else if(format_name == "binary_big_endian") {
+				format = Format::BINARY_BIG_ENDIAN;
+			} else {
+				format = Format::ASCII;
+			}
+		} else if(keyword == "element") {
+			Element element;
+			words >> element.name >> element.count;
+			if(!words) { //The count was missing or not a number.
+				return 0;
+			}
+			elements.push_back(element);
+		} else if(keyword == "property") {
+			if(elements.empty()) { //Property without element.
+				return 0;
+			}
+			Property property;
+			std::string type_name;
+			words >> type_name;
+			property.is_list = type_name == "list";
+			if(property.is_list) {
+				std::string count_type_name;
+				words >> count_type_name >> type_name;
+				property.count_type = parse_type(count_type_name);
+			} else {
+				property.count_type = Type::UNKNOWN;
+			}
+			property.type = parse_type(type_name);
+			words >> property.name;
+			if(property.type == Type::UNKNOWN || (property.is_list && property.count_type == Type::UNKNOWN)) { //We wouldn't know how many bytes to skip.
+				return 0;
+			}
+			elements.back().properties.push_back(property);
+		}
+		//Other lines, such as "ply", "comment" and "obj_info", contain nothing we need.
+	}
+	return 0; //Reached the end of the file without end of header.
+}
+
+void Ply::load_binary(const char* data, const size_t size, size_t position) {
+	const bool swap_bytes = format == Format::BINARY_BIG_ENDIAN; //Assuming that your CPU is little-endian, which is pretty much every desktop CPU.
+
+	for(const Element& element : elements) {
+		//Find where the properties we need are, and whether all elements are the same size.
+		bool fixed_size = true;
+		size_t stride = 0; //Size of each element, if they are all the same size.
+		size_t coordinate_offsets[3] = {0, 0, 0};
+		Type coordinate_types[3] = {Type::UNKNOWN, Type::UNKNOWN, Type::UNKNOWN};
+		size_t indices_property = element.properties.size(); //Which property holds the vertex indices of a face.
+		for(size_t property_index = 0; property_index < element.properties.size(); ++property_index) {
+			const Property& property = element.properties[property_index];
+			if(property.is_list) {
+				fixed_size = false;
+				if(property.name == "vertex_indices" || property.name == "vertex_index") {
+					indices_property = property_index;
+				}
+				continue;
+			}
+			if(property.name.length() == 1 && property.name[0] >= 'x' && property.name[0] <= 'z') {
+				coordinate_offsets[property.name[0] - 'x'] = stride;
+				coordinate_types[property.name[0] - 'x'] = property.type;
+			}
+			stride += type_size(property.type);
+		}
+		const bool is_vertex = element.name == "vertex" && coordinate_types[0] != Type::UNKNOWN && coordinate_types[1] != Type::UNKNOWN && coordinate_types[2] != Type::UNKNOWN;
+		const bool is_face = element.name == "face" && indices_property < element.properties.size();
+
+		size_t element_index = 0;
+		if(fixed_size) {
+			//All elements are the same size, so the properties can be read directly at a fixed stride through the array.
+			const size_t count = std::min(element.count, stride > 0 ? (size - position) / stride : 0); //Prevent reading outside of the file if the count is corrupt.
+			if(is_vertex) {
+				vertices.reserve(vertices.size() + count);
+				if(!swap_bytes && coordinate_types[0] == Type::FLOAT32 && coordinate_types[1] == Type::FLOAT32 && coordinate_types[2] == Type::FLOAT32) {
+					//By far the most common case, which doesn't need any conversion.
+					for(const char* vertex = data + position; vertex < data + position + count * stride; vertex += stride) {
+						float x, y, z;
+						memcpy(&x, vertex + coordinate_offsets[0], sizeof(float));
+						memcpy(&y, vertex + coordinate_offsets[1], sizeof(float));
+						memcpy(&z, vertex + coordinate_offsets[2], sizeof(float));
+						vertices.emplace_back(x, y, z);
+					}
+				} else {
+					for(const char* vertex = data + position; vertex < data + position + count * stride; vertex += stride) {
+						vertices.emplace_back(
+							read_value(vertex + coordinate_offsets[0], coordinate_types[0], swap_bytes),
+							read_value(vertex + coordinate_offsets[1], coordinate_types[1], swap_bytes),
+							read_value(vertex + coordinate_offsets[2], coordinate_types[2], swap_bytes));
+					}
+				}
+			}
+			position += count * stride;
+			report_progress(position);
+			continue;
+		}
+
+		if(is_face && element.properties.size() == 1 && element.properties[0].is_list && type_size(element.properties[0].count_type) == 1 && (element.properties[0].type == Type::INT32 || element.properties[0].type == Type::UINT32) && !swap_bytes) {
+			//The most common layout of faces: Only a list of 32-bit integer indices. As long as the faces are triangles, these are all the same size. Float indices take the general method.
+			constexpr size_t triangle_stride = 1 + 3 * sizeof(uint32_t);
+			const bool is_signed = element.properties[0].type == Type::INT32;
+			triangles.reserve(triangles.size() + element.count);
+			for(; element_index < element.count && position + triangle_stride <= size && data[position] == 3; ++element_index) {
+				if(element_index % Monitor::report_interval == 0) {
+					report_progress(position);
+				}
+				uint32_t indices[3];
+				memcpy(indices, data + position + 1, sizeof(indices));
+				if(!is_signed || (int32_t(indices[0]) >= 0 && int32_t(indices[1]) >= 0 && int32_t(indices[2]) >= 0)) {
+					triangles.push_back({indices[0], indices[1], indices[2]});
+				}
+				position += triangle_stride;
+			}
+			//If there was a face that wasn't a triangle, continue the rest of the faces with the general method below.
+		}
+
+		//General method: Go through every property of every element one by one.
+		std::vector<size_t> face;
+		for(; element_index < element.count; ++element_index) {
+			if(element_index % Monitor::report_interval == 0) {
+				report_progress(position);
+			}
+			Point3 vertex(0, 0, 0);
+			for(size_t property_index = 0; property_index < element.properties.size(); ++property_index) {
+				const Property& property = element.properties[property_index];
+				if(!property.is_list) {
+					if(position + type_size(property.type) > size) { //File is truncated.
+						return;
+					}
+					if(is_vertex && property.name.length() == 1 && property.name[0] >= 'x' && property.name[0] <= 'z') {
+						const double coordinate = read_value(data + position, property.type, swap_bytes);
+						if(property.name[0] == 'x') {
+							vertex.x = coordinate;
+						} else if(property.name[0] == 'y') {
+							vertex.y = coordinate;
+						} else {
+							vertex.z = coordinate;
+						}
+					}
+					position += type_size(property.type);
+					continue;
+				}
+				if(position + type_size(property.count_type) > size) {
+					return;
+				}
+				const double list_length = read_value(data + position, property.count_type, swap_bytes);
+				position += type_size(property.count_type);
+				if(!(list_length >= 0) || list_length > (size - position) / std::max(size_t(1), type_size(property.type))) { //Negative, not a number, or longer than the rest of the file.
+					return;
+				}
+				if(is_face && property_index == indices_property) {
+					face.clear();
+					for(size_t item = 0; item < size_t(list_length); ++item) {
+						const double index = read_value(data + position + item * type_size(property.type), property.type, swap_bytes);
+						face.push_back(to_size(index)); //Invalid indices get filtered out later.
+					}
+					add_face(face);
+				}
+				position += size_t(list_length) * type_size(property.type);
+			}
+			if(is_vertex) {
+				vertices.push_back(vertex);
+			}
+		}
+	}
+}
+
+void Ply::load_ascii(const char* data, const size_t size, size_t position) {
+	const char* cursor = data + position;
+	const char* end = data + size;
+
+	std::vector<size_t> face;
+	for(const Element& element : elements) {
+		size_t indices_property = element.properties.size();
+		bool has_coordinates = false;
+		for(size_t property_index = 0; property_index < element.properties.size(); ++property_index) {
+			const Property& property = element.properties[property_index];
+			if(property.is_list && (property.name == "vertex_indices" || property.name == "vertex_index")) {
+				indices_property = property_index;
+			}
+			if(property.name == "x") {
+				has_coordinates = true;
+			}
+		}
+		const bool is_vertex = element.name == "vertex" && has_coordinates;
+		const bool is_face = element.name == "face" && indices_property < element.properties.size();
+
+		for(size_t element_index = 0; element_index < element.count; ++element_index) {
+			if(element_index % Monitor::report_interval == 0) {
+				report_progress(cursor - data);
+			}
+			Point3 vertex(0, 0, 0);
+			for(size_t property_index = 0; property_index < element.properties.size(); ++property_index) {
+				const Property& property = element.properties[property_index];
+				double value;
+				if(!property.is_list) {
+					if(!read_ascii_value(cursor, end, value)) { //Not a number, or end of file.
+						return;
+					}
+					if(is_vertex && property.name == "x") {
+						vertex.x = value;
+					} else if(is_vertex && property.name == "y") {
+						vertex.y = value;
+					} else if(is_vertex && property.name == "z") {
+						vertex.z = value;
+					}
+					continue;
+				}
+				if(!read_ascii_value(cursor, end, value) || !(value >= 0)) { //The length of the list must be a positive number.
+					return;
+				}
+				const size_t list_length = to_size(value);
+				face.clear();
+				for(size_t item = 0; item < list_length; ++item) {
+					if(!read_ascii_value(cursor, end, value)) {
+						return;
+					}
+					face.push_back(to_size(value)); //Invalid indices get filtered out later.
+				}
+				if(is_face && property_index == indices_property) {
+					add_face(face);
+				}
+			}
+			if(is_vertex) {
+				vertices.push_back(vertex);
+			}
+		}
+	}
+}
+
+void Ply::report_progress(const size_t position) {
+	if(!monitor) {
+		return;
+	}
+	monitor->advance(position - reported_position, triangles.size() - reported_triangles);
+	reported_position = position;
+	reported_triangles = triangles.size();
+}
+
+void Ply::add_face(const std::vector<size_t>& face) {
+	for(size_t i = 2; i < face.size(); ++i) { //Faces with fewer than 3 vertices produce no triangles.
+		triangles.push_back({face[0], face[i - 1], face[i]});
+	}
+}
+
+Model Ply::to_model() {
+	Model model; //The result.
+	model.meshes.emplace_back(); //PLY files contain a single mesh.
+	Mesh& mesh = model.meshes.back();
+	mesh.vertices = std::move(vertices);
+	mesh.triangles = std::move(triangles);
+	return model;
+}
+
+bool Ply::read_ascii_value(const char*& cursor, const char* end, double& value) {
+	while(cursor < end && std::isspace(static_cast<unsigned char>(*cursor))) {
+		cursor++;
+	}
+	const char* word_end = cursor;
+	while(word_end < end && !std::isspace(static_cast<unsigned char>(*word_end))) {
+		word_end++;
+	}
+
+	//The file may not be null-terminated, so copy the number to make sure that it can't be read past the end.
+	char buffer[64];
+	const size_t length = word_end - cursor;
+	if(length == 0 || length >= sizeof(buffer)) { //End of file, or too long to be a number.
+		return false;
+	}
+	memcpy(buffer, cursor, length);
+	buffer[length] = '\0';
+	char* number_end;
+	value = strtod(buffer, &number_end);
+	if(number_end == buffer) {
+		return false;
+	}
+	cursor += number_end - buffer;
+	return true;
+}
+
+size_t Ply::to_size(const double value) {
+	if(value >= 0 && value < static_cast<double>(std::numeric_limits<size_t>::max())) { //Also false for NaN.
+		return value;
+	}
+	return size_t(-1);
+}
+
+Ply::Type Ply::parse_type(const std::string& name) {
+	if(name == "char" || name == "int8") {
+		return Type::INT8;
+	} else if(name == "uchar" || name == "uint8") {
+		return Type::UINT8;
+	} else if(name == "short" || name == "int16") {
+		return Type::INT16;
+	} else if(name == "ushort" || name == "uint16") {
+		return Type::UINT16;
+	} else if(name == "int" || name == "int32") {
+		return Type::INT32;
+	} else if(name == "uint" || name == "uint32") {
+		return Type::UINT32;
+	} else if(name == "float" || name == "float32") {
+		return Type::FLOAT32;
+	} else if(name == "double" || name == "float64") {
+		return Type::FLOAT64;
+	}
+	return Type::UNKNOWN;
+}
+
+size_t Ply::type_size(const Type type) {
+	switch(type) {
+		case Type::INT8: case Type::UINT8: return 1;
+		case Type::INT16: case Type::UINT16: return 2;
+		case Type::INT32: case Type::UINT32: case Type::FLOAT32: return 4;
+		case Type::FLOAT64: return 8;
+		default: return 0;
+	}
+}
+
+double Ply::read_value(const char* position, const Type type, const bool swap_bytes) {
+	char bytes[8];
+	memcpy(bytes, position, type_size(type));
+	if(swap_bytes) {
+		std::reverse(bytes, bytes + type_size(type));
+	}
+	switch(type) {
+		case Type::INT8: { int8_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+		case Type::UINT8: { uint8_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+		case Type::INT16: { int16_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+		case Type::UINT16: { uint16_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+		case Type::INT32: { int32_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+		case Type::UINT32: { uint32_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+		case Type::FLOAT32: { float value; memcpy(&value, bytes, sizeof(value)); return value; }
+		case Type::FLOAT64: { double value; memcpy(&value, bytes, sizeof(value)); return value; }
+		default: return 0;
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //For std::min and std::max.
+#include <cstdint> //For the largest read-ahead on macOS.
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CONVERTTO3MF_POSIX_PREFETCH //Read-ahead hints are only implemented for POSIX systems. Other systems read the file once to get it in the cache.
+#include <fcntl.h> //To open files and give read-ahead hints.
+#include <sys/stat.h> //To find the size of files.
+#include <unistd.h> //To close the files again.
+#else
+#include <fstream> //To read the file once.
+#endif
+
+#include "prefetcher.hpp" //The definitions for this file.
+#include "trace.hpp" //To measure how long prefetching takes.
+
+namespace convertto3mf {
+
+constexpr size_t Prefetcher::default_lookahead;
+
+Prefetcher::Prefetcher(const std::vector<std::string>& filenames, const size_t lookahead) :
+		filenames(filenames),
+		lookahead(lookahead),
+		next(0),
+		limit(std::min(filenames.size(), lookahead)),
+		stopping(false) {
+	const size_t num_threads = std::min(filenames.size(), lookahead);
+	for(size_t thread = 0; thread < num_threads; ++thread) {
+		threads.emplace_back(&Prefetcher::work, this);
+	}
+}
+
+Prefetcher::~Prefetcher() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	for(std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+void Prefetcher::advance(const size_t index) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		next = std::max(next, index + 1); //The current file is already being read, so prefetching it won't help any more.
+		limit = std::min(filenames.size(), index + 1 + lookahead);
+	}
+	condition.notify_all();
+}
+
+void Prefetcher::prefetch(const std::string& filename) {
+	Trace::Span span("prefetch");
+#ifdef CONVERTTO3MF_POSIX_PREFETCH
+	const int file_descriptor = open(filename.c_str(), O_RDONLY);
+	if(file_descriptor < 0) {
+		return;
+	}
+	struct stat status;
+	if(fstat(file_descriptor, &status) == 0 && S_ISREG(status.st_mode)) {
+		span.set_bytes(status.st_size);
+#ifdef POSIX_FADV_WILLNEED
+		posix_fadvise(file_descriptor, 0, status.st_size, POSIX_FADV_WILLNEED); //Starts reading the whole file into the page cache, without waiting for it.
+#elif defined(F_RDADVISE)
+		struct radvisory advice;
+		advice.ra_offset = 0;
+		advice.ra_count = status.st_size > INT32_MAX ? INT32_MAX : status.st_size;
+		fcntl(file_descriptor, F_RDADVISE, &advice); //The equivalent on macOS.
+#endif
+	}
+	close(file_descriptor); //The pages stay in the cache after closing the file.
+#else
+	std::ifstream file(filename, std::ios_base::in | std::ios_base::binary);
+	char buffer[65536];
+	size_t bytes = 0;
+	while(file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+		bytes += file.gcount();
+	}
+	span.set_bytes(bytes);
+#endif
+}
+
+void Prefetcher::work() {
+	while(true) {
+		size_t index;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() {
+				return stopping || next < limit;
+			});
+			if(stopping) {
+				return;
+			}
+			index = next++;
+		}
+		prefetch(filenames[index]);
+	}
+}
+
+}
\ No newline at end of file
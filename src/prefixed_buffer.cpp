@@ -0,0 +1,38 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include "prefixed_buffer.hpp" //The definitions for this file.
+
+namespace convertto3mf {
+
+PrefixedBuffer::PrefixedBuffer(const std::string& prefix, std::streambuf& source) :
+		prefix(prefix),
+		source(source),
+		prefix_done(false),
+		buffer(65536) {};
+
+PrefixedBuffer::int_type PrefixedBuffer::underflow() {
+	if(gptr() < egptr()) { //There is still data available.
+		return traits_type::to_int_type(*gptr());
+	}
+	if(!prefix_done) {
+		prefix_done = true;
+		if(!prefix.empty()) {
+			setg(&prefix[0], &prefix[0], &prefix[0] + prefix.size());
+			return traits_type::to_int_type(*gptr());
+		}
+	}
+	const std::streamsize read = source.sgetn(buffer.data(), buffer.size());
+	if(read <= 0) {
+		return traits_type::eof();
+	}
+	setg(buffer.data(), buffer.data(), buffer.data() + read);
+	return traits_type::to_int_type(*gptr());
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,170 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //For std::min and std::max.
+#include <cstdlib> //To parse coordinates.
+#include <cstring> //To find line breaks quickly.
+#include <sstream> //To format the JSON output.
+#include <vector> //To probe parts of text files in parallel.
+
+#include "glb.hpp" //To probe binary glTF files.
+#include "mapped_file.hpp" //To read files without copying them.
+#include "obj.hpp" //To probe OBJ files.
+#include "parallel.hpp" //To scan text files in parallel.
+#include "ply.hpp" //To probe PLY files.
+#include "probe.hpp" //The definitions for this file.
+#include "stl_ascii.hpp" //To probe ASCII STL files.
+#include "stl_binary.hpp" //To probe binary STL files.
+#include "threemf.hpp" //To estimate the size of the output.
+#include "trace.hpp" //To measure how long probing takes.
+
+namespace convertto3mf {
+
+Probe Probe::probe(const std::string& filename) {
+	const MappedFile file(filename);
+	return probe(file.data(), file.size(), filename);
+}
+
+Probe Probe::probe(const char* data, const size_t size, const std::string& filename) {
+	Trace::Span span("probe");
+	span.set_bytes(size);
+	Probe result;
+	result.file_size = size;
+	result.file_type = detect_file_type(filename, std::string(data, std::min(size, detection_sample_size)), size);
+	switch(result.file_type) {
+		case FileType::OBJ: Obj::probe(data, size, result); break;
+		case FileType::STL_BINARY: StlBinary::probe(data, size, result); break;
+		case FileType::STL_ASCII: StlAscii::probe(data, size, result); break;
+		case FileType::PLY: Ply::probe(data, size, result); break;
+		case FileType::GLB: Glb::probe(data, size, result); break;
+	}
+	span.set_items(result.num_triangles);
+	return result;
+}
+
+void Probe::include(const Point3& vertex) {
+	if(!has_bounds) {
+		minimum = vertex;
+		maximum = vertex;
+		has_bounds = true;
+		return;
+	}
+	minimum = Point3(std::min(minimum.x, vertex.x), std::min(minimum.y, vertex.y), std::min(minimum.z, vertex.z));
+	maximum = Point3(std::max(maximum.x, vertex.x), std::max(maximum.y, vertex.y), std::max(maximum.z, vertex.z));
+}
+
+void Probe::include(const Probe& other) {
+	num_triangles += other.num_triangles;
+	num_vertices += other.num_vertices;
+	if(other.has_bounds) {
+		include(other.minimum);
+		include(other.maximum);
+	}
+}
+
+size_t Probe::estimate_output_size() const {
+	//Without shared vertices, each vertex is typically shared by 6 triangles in a closed mesh, so about a sixth of them is unique.
+	const size_t unique_vertices = indexed ? num_vertices : num_vertices / 6;
+	constexpr size_t archive_size = 1024; //The other files in the archive and the directory of the archive.
+	constexpr size_t compression_ratio = 4; //The 3D model typically compresses to about a quarter of its size.
+	return archive_size + ThreeMF::estimate_mesh_size(unique_vertices, num_triangles, Options().precision) / compression_ratio;
+}
+
+std::string Probe::to_json(const std::string& filename) const {
+	std::ostringstream json;
+	json.precision(17); //Enough to represent any coordinate exactly.
+	json << "{\"file\":\"";
+	for(const char character : filename) {
+		if(character == '"' || character == '\\') {
+			json << '\\' << character;
+		} else if(static_cast<unsigned char>(character) < 0x20) { //Control characters must be escaped.
+			const char* hex = "0123456789abcdef";
+			json << "\\u00" << hex[character >> 4] << hex[character & 0xF];
+		} else {
+			json << character;
+		}
+	}
+	json << "\",\"format\":\"";
+	switch(file_type) {
+		case FileType::OBJ: json << "obj"; break;
+		case FileType::STL_BINARY: json << "stl_binary"; break;
+		case FileType::STL_ASCII: json << "stl_ascii"; break;
+		case FileType::PLY: json << "ply"; break;
+		case FileType::GLB: json << "glb"; break;
+	}
+	json << "\",\"size\":" << file_size;
+	json << ",\"triangles\":" << num_triangles;
+	json << ",\"vertices\":" << num_vertices;
+	json << ",\"indexed\":" << (indexed ? "true" : "false");
+	json << ",\"bounds\":";
+	if(has_bounds) {
+		json << "{\"min\":[" << minimum.x << "," << minimum.y << "," << minimum.z << "],\"max\":[" << maximum.x << "," << maximum.y << "," << maximum.z << "]}";
+	} else {
+		json << "null";
+	}
+	json << ",\"estimated_output_size\":" << estimate_output_size() << "}";
+	return json.str();
+}
+
+void Probe::visit_lines(const char* data, const size_t size, const LineVisitor& visitor, Probe& result) {
+	//Divide the file into pieces that start at the beginning of a line. Use more pieces than threads, so that the threads finish at about the same time.
+	constexpr size_t min_piece_size = 1 << 20; //Smaller files are not worth splitting up.
+	const size_t num_pieces = std::max(size_t(1), std::min(num_worker_threads() * 4, size / min_piece_size));
+	std::vector<size_t> piece_starts;
+	for(size_t piece = 0; piece < num_pieces; ++piece) {
+		size_t start = size * piece / num_pieces;
+		if(piece > 0) {
+			const char* line_break = static_cast<const char*>(memchr(data + start, '\n', size - start));
+			start = line_break ? (line_break - data + 1) : size;
+		}
+		piece_starts.push_back(std::max(start, piece_starts.empty() ? 0 : piece_starts.back()));
+	}
+	piece_starts.push_back(size);
+
+	std::vector<Probe> pieces(num_pieces);
+	parallel_for(num_pieces, [data, &piece_starts, &pieces, &visitor](const size_t piece) {
+		const char* cursor = data + piece_starts[piece];
+		const char* end = data + piece_starts[piece + 1];
+		while(cursor < end) {
+			const char* line_break = static_cast<const char*>(memchr(cursor, '\n', end - cursor)); //Vectorised by the C library.
+			const char* line_end = line_break ? line_break : end;
+			size_t length = line_end - cursor;
+			if(length > 0 && cursor[length - 1] == '\r') {
+				length--;
+			}
+			visitor(cursor, length, pieces[piece]);
+			cursor = line_end + 1;
+		}
+	});
+	for(const Probe& piece : pieces) {
+		result.include(piece);
+	}
+}
+
+bool Probe::parse_vertex(const char* start, const char* end, Point3& vertex) {
+	//The text may not be null-terminated, so copy it to make sure that the numbers can't be read past the end.
+	char buffer[256];
+	const size_t length = std::min(size_t(end - start), sizeof(buffer) - 1);
+	memcpy(buffer, start, length);
+	buffer[length] = '\0';
+
+	char* cursor = buffer;
+	char* number_end;
+	coord_t coordinates[3];
+	for(coord_t& coordinate : coordinates) {
+		coordinate = strtod(cursor, &number_end);
+		if(number_end == cursor) {
+			return false;
+		}
+		cursor = number_end;
+	}
+	vertex = Point3(coordinates[0], coordinates[1], coordinates[2]);
+	return true;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,203 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //To sort vertices and for std::min and std::max.
+#include <deque> //To simulate a FIFO vertex cache.
+#include <numeric> //To create an initial ordering of vertices with std::iota.
+
+#include "reorder.hpp" //The definitions for this file.
+
+namespace convertto3mf {
+
+void Reorder::reorder(std::vector<Point3>& vertices, std::vector<std::array<size_t, 3>>& triangles) {
+	reorder_vertices(vertices, triangles);
+	reorder_triangles(triangles, vertices.size());
+}
+
+double Reorder::average_cache_miss_ratio(const std::vector<std::array<size_t, 3>>& triangles, const size_t num_vertices) {
+	if(triangles.empty()) {
+		return 0;
+	}
+	std::vector<bool> in_cache(num_vertices, false);
+	std::deque<size_t> cache; //The vertices currently in the cache, in the order they were added.
+	size_t misses = 0;
+	for(const std::array<size_t, 3>& triangle : triangles) {
+		for(const size_t vertex : triangle) {
+			if(in_cache[vertex]) {
+				continue;
+			}
+			misses++;
+			cache.push_back(vertex);
+			in_cache[vertex] = true;
+			if(cache.size() > cache_size) { //Evict the oldest vertex.
+				in_cache[cache.front()] = false;
+				cache.pop_front();
+			}
+		}
+	}
+	return double(misses) / triangles.size();
+}
+
+void Reorder::reorder_vertices(std::vector<Point3>& vertices, std::vector<std::array<size_t, 3>>& triangles) {
+	if(vertices.empty()) {
+		return;
+	}
+
+	//Find the bounding box, to be able to scale the coordinates to the range of the Morton code.
+	Point3 minimum = vertices[0];
+	Point3 maximum = vertices[0];
+	for(const Point3& vertex : vertices) {
+		minimum.x = std::min(minimum.x, vertex.x);
+		minimum.y = std::min(minimum.y, vertex.y);
+		minimum.z = std::min(minimum.z, vertex.z);
+		maximum.x = std::max(maximum.x, vertex.x);
+		maximum.y = std::max(maximum.y, vertex.y);
+		maximum.z = std::max(maximum.z, vertex.z);
+	}
+	//Use the same scale for all dimensions, so that the curve doesn't get stretched along one of the axes.
+	const coord_t size = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+	constexpr uint64_t grid_max = (1 << 21) - 1; //21 bits per dimension fit in a 64-bit code.
+	const coord_t scale = (size > 0) ? grid_max / size : 0;
+
+	std::vector<uint64_t> codes;
+	codes.reserve(vertices.size());
+	for(const Point3& vertex : vertices) {
+		const uint64_t x = std::min(grid_max, uint64_t((vertex.x - minimum.x) * scale));
+		const uint64_t y = std::min(grid_max, uint64_t((vertex.y - minimum.y) * scale));
+		const uint64_t z = std::min(grid_max, uint64_t((vertex.z - minimum.z) * scale));
+		codes.push_back(spread_bits(x) | (spread_bits(y) << 1) | (spread_bits(z) << 2));
+	}
+
+	std::vector<size_t> order(vertices.size()); //For each new index, the old index of the vertex.
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&codes](const size_t a, const size_t b) {
+		return codes[a] < codes[b];
+	});
+
+	std::vector<size_t> new_index(vertices.size()); //For each old index, the new index of the vertex.
+	std::vector<Point3> sorted_vertices;
+	sorted_vertices.reserve(vertices.size());
+	for(size_t index = 0; index < order.size(); ++index) {
+		new_index[order[index]] = index;
+		sorted_vertices.push_back(vertices[order[index]]);
+	}
+	vertices.swap(sorted_vertices);
+
+	for(std::array<size_t, 3>& triangle : triangles) {
+		for(size_t& vertex : triangle) {
+			vertex = new_index[vertex];
+		}
+	}
+}
+
+void Reorder::reorder_triangles(std::vector<std::array<size_t, 3>>& triangles, const size_t num_vertices) {
+	if(triangles.empty()) {
+		return;
+	}
+
+	//Build the adjacency from vertices to the triangles that use them, as one flat list with offsets.
+	std::vector<size_t> live_triangles(num_vertices, 0); //For each vertex, how many triangles using it have not been emitted yet.
+	for(const std::array<size_t, 3>& triangle : triangles) {
+		for(const size_t vertex : triangle) {
+			live_triangles[vertex]++;
+		}
+	}
+	std::vector<size_t> adjacency_offsets(num_vertices + 1, 0);
+	for(size_t vertex = 0; vertex < num_vertices; ++vertex) {
+		adjacency_offsets[vertex + 1] = adjacency_offsets[vertex] + live_triangles[vertex];
+	}
+	std::vector<size_t> adjacency(adjacency_offsets.back());
+	std::vector<size_t> adjacency_fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+	for(size_t triangle_index = 0; triangle_index < triangles.size(); ++triangle_index) {
+		for(const size_t vertex : triangles[triangle_index]) {
+			adjacency[adjacency_fill[vertex]++] = triangle_index;
+		}
+	}
+
+	std::vector<size_t> cache_time(num_vertices, 0); //For each vertex, the time stamp at which it was last added to the cache.
+	size_t time = cache_size + 1; //Start the time such that no vertex is in the cache yet.
+	std::vector<bool> emitted(triangles.size(), false);
+	std::vector<size_t> dead_end; //Stack of recently used vertices, to continue from if we run out of candidates.
+	std::vector<std::array<size_t, 3>> result;
+	result.reserve(triangles.size());
+	size_t cursor = 0; //To find the next vertex with live triangles if the dead-end stack is also empty.
+
+	constexpr size_t none = -1;
+	size_t fanning = 0; //The vertex of which we're currently emitting the surrounding triangles.
+	while(fanning != none) {
+		std::vector<size_t> candidates; //Vertices of the emitted triangles, to pick the next fanning vertex from.
+		for(size_t adjacent = adjacency_offsets[fanning]; adjacent < adjacency_offsets[fanning + 1]; ++adjacent) {
+			const size_t triangle_index = adjacency[adjacent];
+			if(emitted[triangle_index]) {
+				continue;
+			}
+			emitted[triangle_index] = true;
+			result.push_back(triangles[triangle_index]);
+			for(const size_t vertex : triangles[triangle_index]) {
+				dead_end.push_back(vertex);
+				candidates.push_back(vertex);
+				live_triangles[vertex]--;
+				if(time - cache_time[vertex] > cache_size) { //Not in the cache any more, so it gets added now.
+					cache_time[vertex] = time;
+					time++;
+				}
+			}
+		}
+
+		//Choose the next fanning vertex. Prefer vertices that will still be in the cache after emitting their triangles.
+		fanning = none;
+		size_t best_priority = 0;
+		for(const size_t candidate : candidates) {
+			if(live_triangles[candidate] == 0) {
+				continue;
+			}
+			size_t priority = 0;
+			if(time - cache_time[candidate] + 2 * live_triangles[candidate] <= cache_size) {
+				priority = time - cache_time[candidate];
+			}
+			if(fanning == none || priority > best_priority) {
+				best_priority = priority;
+				fanning = candidate;
+			}
+		}
+		if(fanning != none) {
+			continue;
+		}
+
+		//Dead end. Continue with the most recently used vertex that still has triangles left.
+		while(!dead_end.empty()) {
+			const size_t vertex = dead_end.back();
+			dead_end.pop_back();
+			if(live_triangles[vertex] > 0) {
+				fanning = vertex;
+				break;
+			}
+		}
+		//No such vertex. Continue with the next vertex in the list that still has triangles left.
+		while(fanning == none && cursor < num_vertices) {
+			if(live_triangles[cursor] > 0) {
+				fanning = cursor;
+			}
+			cursor++;
+		}
+	}
+
+	triangles.swap(result);
+}
+
+uint64_t Reorder::spread_bits(uint64_t value) {
+	value &= 0x1FFFFF;
+	value = (value | (value << 32)) & 0x1F00000000FFFF;
+	value = (value | (value << 16)) & 0x1F0000FF0000FF;
+	value = (value | (value << 8)) & 0x100F00F00F00F00F;
+	value = (value | (value << 4)) & 0x10C30C30C30C30C3;
+	value = (value | (value << 2)) & 0x1249249249249249;
+	return value;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,460 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //To find the partitions and the neighbours of vertices.
+#include <cmath> //To normalise the normals of triangles.
+#include <iterator> //To find the common neighbours of vertices.
+#include <numeric> //To number the triangles before partitioning them.
+#include <queue> //To collapse the cheapest edges first.
+
+#include "parallel.hpp" //To simplify the partitions in parallel.
+#include "simplify.hpp" //The definitions for this file.
+#include "trace.hpp" //To measure how long simplifying takes.
+
+namespace convertto3mf {
+
+constexpr size_t Simplify::partition_size;
+constexpr double Simplify::tie_breaker_weight;
+
+void Simplify::simplify(std::vector<Point3>& vertices, std::vector<std::array<size_t, 3>>& triangles, const size_t target) {
+	if(triangles.size() <= target) {
+		return;
+	}
+	Trace::Span span("simplify");
+	span.set_items(triangles.size());
+	std::vector<Quadric> quadrics = compute_quadrics(vertices, triangles); //Computed once for the original surface, so that the errors keep adding up over all collapses.
+
+	if(triangles.size() > partition_size * 2) {
+		const std::vector<std::vector<size_t>> partitions = partition(vertices, triangles);
+
+		//Vertices that are used by multiple partitions must stay in place, so that the partitions still fit together afterwards.
+		constexpr size_t none = -1;
+		std::vector<size_t> owner(vertices.size(), none); //For each vertex, the partition that uses it.
+		std::vector<bool> on_border(vertices.size(), false);
+		for(size_t partition_index = 0; partition_index < partitions.size(); ++partition_index) {
+			for(const size_t triangle_index : partitions[partition_index]) {
+				for(const size_t vertex : triangles[triangle_index]) {
+					if(owner[vertex] == none) {
+						owner[vertex] = partition_index;
+					} else if(owner[vertex] != partition_index) {
+						on_border[vertex] = true;
+					}
+				}
+			}
+		}
+
+		std::vector<std::vector<std::array<size_t, 3>>> partition_triangles(partitions.size());
+		parallel_for(partitions.size(), [&](const size_t partition_index) {
+			Trace::Span partition_span("simplify partition");
+			const std::vector<size_t>& partition = partitions[partition_index];
+			partition_span.set_items(partition.size());
+
+			//Make a separate mesh of the partition, with only the vertices it uses.
+			std::vector<size_t> global_index; //For each vertex of the partition, its index in the whole mesh.
+			global_index.reserve(partition.size());
+			for(const size_t triangle_index : partition) {
+				global_index.insert(global_index.end(), triangles[triangle_index].begin(), triangles[triangle_index].end());
+			}
+			std::sort(global_index.begin(), global_index.end());
+			global_index.erase(std::unique(global_index.begin(), global_index.end()), global_index.end());
+			std::vector<Point3> local_vertices;
+			local_vertices.reserve(global_index.size());
+			std::vector<Quadric> local_quadrics;
+			local_quadrics.reserve(global_index.size());
+			std::vector<bool> locked;
+			locked.reserve(global_index.size());
+			for(const size_t vertex : global_index) {
+				local_vertices.push_back(vertices[vertex]);
+				local_quadrics.push_back(quadrics[vertex]);
+				locked.push_back(on_border[vertex]);
+			}
+			std::vector<std::array<size_t, 3>>& local_triangles = partition_triangles[partition_index];
+			local_triangles.reserve(partition.size());
+			for(const size_t triangle_index : partition) {
+				std::array<size_t, 3> local_triangle;
+				for(size_t corner = 0; corner < 3; ++corner) {
+					local_triangle[corner] = std::lower_bound(global_index.begin(), global_index.end(), triangles[triangle_index][corner]) - global_index.begin();
+				}
+				local_triangles.push_back(local_triangle);
+			}
+
+			//Each partition gets a share of the target in proportion to its size.
+			//But its border can't be simplified yet. If the inside were simplified much further than that, it would become fans of long triangles to the border, so leave that to the pass over the whole mesh.
+			const size_t num_locked = std::count(locked.begin(), locked.end(), true);
+			collapse_edges(local_vertices, local_triangles, local_quadrics, locked, std::max(target * partition.size() / triangles.size(), num_locked * 4));
+
+			//Only this partition uses the vertices that are not on the border, so they can be moved back without interfering with the other partitions.
+			for(size_t vertex = 0; vertex < global_index.size(); ++vertex) {
+				if(!locked[vertex]) {
+					vertices[global_index[vertex]] = local_vertices[vertex];
+					quadrics[global_index[vertex]] = local_quadrics[vertex];
+				}
+			}
+			for(std::array<size_t, 3>& triangle : local_triangles) {
+				for(size_t& vertex : triangle) {
+					vertex = global_index[vertex];
+				}
+			}
+		});
+
+		triangles.clear();
+		for(const std::vector<std::array<size_t, 3>>& partition : partition_triangles) {
+			triangles.insert(triangles.end(), partition.begin(), partition.end());
+		}
+	}
+
+	//If the borders between partitions kept too many triangles, simplify the whole mesh further. It is much smaller by now.
+	if(triangles.size() > target) {
+		collapse_edges(vertices, triangles, quadrics, std::vector<bool>(vertices.size(), false), target);
+	}
+	remove_unused_vertices(vertices, triangles);
+}
+
+void Simplify::Quadric::add_plane(const Point3& normal, const Point3& point, const double weight) {
+	const double a = normal.x;
+	const double b = normal.y;
+	const double c = normal.z;
+	const double d = -(a * point.x + b * point.y + c * point.z);
+	const std::array<double, 10> plane = {a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d};
+	for(size_t element = 0; element < elements.size(); ++element) {
+		elements[element] += plane[element] * weight;
+	}
+}
+
+void Simplify::Quadric::add(const Quadric& other) {
+	for(size_t element = 0; element < elements.size(); ++element) {
+		elements[element] += other.elements[element];
+	}
+}
+
+double Simplify::Quadric::error(const Point3& point) const {
+	const double x = point.x;
+	const double y = point.y;
+	const double z = point.z;
+	return elements[0] * x * x + 2 * elements[1] * x * y + 2 * elements[2] * x * z + 2 * elements[3] * x
+		+ elements[4] * y * y + 2 * elements[5] * y * z + 2 * elements[6] * y
+		+ elements[7] * z * z + 2 * elements[8] * z
+		+ elements[9];
+}
+
+bool Simplify::Quadric::minimum(Point3& optimum) const {
+	//Where the gradient of the error is zero: Solve the 3x3 system with Cramer's rule.
+	const double xx = elements[0], xy = elements[1], xz = elements[2], xw = elements[3];
+	const double yy = elements[4], yz = elements[5], yw = elements[6];
+	const double zz = elements[7], zw = elements[8];
+	const double determinant = xx * (yy * zz - yz * yz) - xy * (xy * zz - yz * xz) + xz * (xy * yz - yy * xz);
+	const double scale = xx + yy + zz;
+	if(std::abs(determinant) <= 1e-6 * scale * scale * scale) { //The planes are (nearly) parallel.
+		return false;
+	}
+	optimum.x = (-xw * (yy * zz - yz * yz) + yw * (xy * zz - yz * xz) - zw * (xy * yz - yy * xz)) / determinant;
+	optimum.y = (xx * (-yw * zz + zw * yz) - xy * (-xw * zz + zw * xz) + xz * (-xw * yz + yw * xz)) / determinant;
+	optimum.z = (xx * (-yy * zw + yz * yw) - xy * (-xy * zw + yz * xw) + xz * (-xy * yw + yy * xw)) / determinant;
+	return true;
+}
+
+void Simplify::collapse_edges(std::vector<Point3>& vertices, std::vector<std::array<size_t, 3>>& triangles, std::vector<Quadric>& quadrics, std::vector<bool> locked, const size_t target) {
+	if(triangles.size() <= target) {
+		return;
+	}
+
+	std::vector<std::vector<size_t>> vertex_triangles(vertices.size()); //For each vertex, the triangles around it. May include removed triangles.
+	for(size_t triangle_index = 0; triangle_index < triangles.size(); ++triangle_index) {
+		for(const size_t vertex : triangles[triangle_index]) {
+			vertex_triangles[vertex].push_back(triangle_index);
+		}
+	}
+	std::vector<bool> triangle_removed(triangles.size(), false);
+	std::vector<bool> vertex_removed(vertices.size(), false);
+
+	//Keep the borders of holes and non-manifold edges in place. Those are edges that don't have exactly two triangles.
+	std::vector<size_t> neighbours;
+	for(size_t vertex = 0; vertex < vertices.size(); ++vertex) {
+		neighbours.clear();
+		for(const size_t triangle_index : vertex_triangles[vertex]) {
+			for(const size_t neighbour : triangles[triangle_index]) {
+				if(neighbour != vertex) {
+					neighbours.push_back(neighbour);
+				}
+			}
+		}
+		std::sort(neighbours.begin(), neighbours.end());
+		for(size_t run_start = 0; run_start < neighbours.size();) {
+			size_t run_end = run_start;
+			while(run_end < neighbours.size() && neighbours[run_end] == neighbours[run_start]) {
+				++run_end;
+			}
+			if(run_end - run_start != 2) {
+				locked[vertex] = true;
+				locked[neighbours[run_start]] = true;
+			}
+			run_start = run_end;
+		}
+	}
+
+	//A possible edge collapse, moving both vertices to one position.
+	struct Collapse {
+		double cost;
+		size_t keep; //The vertex that is moved to the new position.
+		size_t remove; //The vertex that is merged into the other.
+		size_t keep_version; //The versions of the vertices when this was computed. If either vertex changed since, this is outdated.
+		size_t remove_version;
+		Point3 position;
+	};
+	auto more_expensive = [](const Collapse& a, const Collapse& b) {
+		return a.cost > b.cost;
+	};
+	std::priority_queue<Collapse, std::vector<Collapse>, decltype(more_expensive)> queue(more_expensive);
+	std::vector<size_t> version(vertices.size(), 0); //Incremented every time a vertex changes, to recognise outdated collapses in the queue.
+
+	auto push_collapse = [&](size_t keep, size_t remove) {
+		if(locked[keep] && locked[remove]) {
+			return;
+		}
+		if(locked[remove]) { //A locked vertex must stay in place, so the other one is merged into it.
+			std::swap(keep, remove);
+		}
+		Quadric quadric = quadrics[keep];
+		quadric.add(quadrics[remove]);
+		const Point3& a = vertices[keep];
+		const Point3& b = vertices[remove];
+		const Point3 middle((a.x + b.x) / 2, (a.y + b.y) / 2, (a.z + b.z) / 2);
+		const double edge_squared = (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z);
+		Point3 position = a;
+		if(!locked[keep]) {
+			Point3 optimum = middle;
+			if(quadric.minimum(optimum) && (optimum.x - middle.x) * (optimum.x - middle.x) + (optimum.y - middle.y) * (optimum.y - middle.y) + (optimum.z - middle.z) * (optimum.z - middle.z) <= edge_squared) { //Far away optima come from nearly parallel planes, and would create spikes.
+				position = optimum;
+			} else { //Pick the best of the ends and the middle of the edge.
+				for(const Point3& candidate : {b, middle}) {
+					if(quadric.error(candidate) < quadric.error(position)) {
+						position = candidate;
+					}
+				}
+			}
+		}
+		//In flat areas, every collapse costs nothing. Without a tie-breaker, one vertex would then absorb a growing fan of its neighbours, which takes quadratic time.
+		//Collapsing the shortest edges first spreads the collapses evenly. The error is an area times a squared distance, so the edge length counts to the fourth power.
+		const double tie_breaker = tie_breaker_weight * edge_squared * edge_squared;
+		queue.push({std::max(0.0, quadric.error(position)) + tie_breaker, keep, remove, version[keep], version[remove], position});
+	};
+	for(const std::array<size_t, 3>& triangle : triangles) {
+		for(size_t corner = 0; corner < 3; ++corner) {
+			if(triangle[corner] < triangle[(corner + 1) % 3]) { //The triangle on the other side has the edge the other way around, so each edge is only pushed once.
+				push_collapse(triangle[corner], triangle[(corner + 1) % 3]);
+			}
+		}
+	}
+
+	//Collect the vertices connected to a vertex, without duplicates.
+	auto find_neighbours = [&](const size_t vertex, std::vector<size_t>& result) {
+		result.clear();
+		for(const size_t triangle_index : vertex_triangles[vertex]) {
+			if(triangle_removed[triangle_index]) {
+				continue;
+			}
+			for(const size_t neighbour : triangles[triangle_index]) {
+				if(neighbour != vertex) {
+					result.push_back(neighbour);
+				}
+			}
+		}
+		std::sort(result.begin(), result.end());
+		result.erase(std::unique(result.begin(), result.end()), result.end());
+	};
+
+	//Check whether moving a vertex to a new position would flip or flatten any of its triangles, other than the ones that are removed.
+	auto keeps_orientation = [&](const size_t vertex, const size_t other, const Point3& position) {
+		for(const size_t triangle_index : vertex_triangles[vertex]) {
+			const std::array<size_t, 3>& triangle = triangles[triangle_index];
+			if(triangle_removed[triangle_index] || triangle[0] == other || triangle[1] == other || triangle[2] == other) {
+				continue;
+			}
+			size_t corner = 0;
+			while(triangle[corner] != vertex) {
+				++corner;
+			}
+			const Point3& b = vertices[triangle[(corner + 1) % 3]];
+			const Point3& c = vertices[triangle[(corner + 2) % 3]];
+			const Point3& before = vertices[vertex];
+			const double bc_x = c.x - b.x, bc_y = c.y - b.y, bc_z = c.z - b.z;
+			const double before_x = bc_y * (before.z - b.z) - bc_z * (before.y - b.y);
+			const double before_y = bc_z * (before.x - b.x) - bc_x * (before.z - b.z);
+			const double before_z = bc_x * (before.y - b.y) - bc_y * (before.x - b.x);
+			const double after_x = bc_y * (position.z - b.z) - bc_z * (position.y - b.y);
+			const double after_y = bc_z * (position.x - b.x) - bc_x * (position.z - b.z);
+			const double after_z = bc_x * (position.y - b.y) - bc_y * (position.x - b.x);
+			const double dot = before_x * after_x + before_y * after_y + before_z * after_z;
+			const double before_squared = before_x * before_x + before_y * before_y + before_z * before_z;
+			const double after_squared = after_x * after_x + after_y * after_y + after_z * after_z;
+			constexpr double min_cosine = 0.2; //The normal may turn at most about 78 degrees.
+			if(dot <= 0 || dot * dot < min_cosine * min_cosine * before_squared * after_squared) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	size_t num_triangles = triangles.size();
+	std::vector<size_t> keep_neighbours;
+	std::vector<size_t> remove_neighbours;
+	std::vector<size_t> common_neighbours;
+	while(num_triangles > target && !queue.empty()) {
+		const Collapse collapse = queue.top();
+		queue.pop();
+		const size_t keep = collapse.keep;
+		const size_t remove = collapse.remove;
+		if(vertex_removed[keep] || vertex_removed[remove] || version[keep] != collapse.keep_version || version[remove] != collapse.remove_version) { //Outdated.
+			continue;
+		}
+
+		//The triangles around the edge must be the only ones that connect the two vertices, or the mesh would fold onto itself.
+		find_neighbours(keep, keep_neighbours);
+		find_neighbours(remove, remove_neighbours);
+		common_neighbours.clear();
+		std::set_intersection(keep_neighbours.begin(), keep_neighbours.end(), remove_neighbours.begin(), remove_neighbours.end(), std::back_inserter(common_neighbours));
+		size_t shared_triangles = 0;
+		for(const size_t triangle_index : vertex_triangles[remove]) {
+			const std::array<size_t, 3>& triangle = triangles[triangle_index];
+			if(!triangle_removed[triangle_index] && (triangle[0] == keep || triangle[1] == keep || triangle[2] == keep)) {
+				shared_triangles++;
+			}
+		}
+		if(shared_triangles == 0 || common_neighbours.size() != shared_triangles) {
+			continue;
+		}
+		if(!keeps_orientation(keep, remove, collapse.position) || !keeps_orientation(remove, keep, collapse.position)) {
+			continue;
+		}
+
+		//Merge the removed vertex into the kept one.
+		vertices[keep] = collapse.position;
+		quadrics[keep].add(quadrics[remove]);
+		for(const size_t triangle_index : vertex_triangles[remove]) {
+			if(triangle_removed[triangle_index]) {
+				continue;
+			}
+			std::array<size_t, 3>& triangle = triangles[triangle_index];
+			if(triangle[0] == keep || triangle[1] == keep || triangle[2] == keep) {
+				triangle_removed[triangle_index] = true;
+				num_triangles--;
+			} else {
+				std::replace(triangle.begin(), triangle.end(), remove, keep);
+				vertex_triangles[keep].push_back(triangle_index);
+			}
+		}
+		vertex_removed[remove] = true;
+		std::vector<size_t>().swap(vertex_triangles[remove]);
+		vertex_triangles[keep].erase(std::remove_if(vertex_triangles[keep].begin(), vertex_triangles[keep].end(), [&triangle_removed](const size_t triangle_index) {
+			return triangle_removed[triangle_index];
+		}), vertex_triangles[keep].end());
+		version[keep]++;
+		version[remove]++;
+
+		//The edges around the kept vertex now have a different cost.
+		find_neighbours(keep, keep_neighbours);
+		for(const size_t neighbour : keep_neighbours) {
+			push_collapse(keep, neighbour);
+		}
+	}
+
+	std::vector<std::array<size_t, 3>> remaining;
+	remaining.reserve(num_triangles);
+	for(size_t triangle_index = 0; triangle_index < triangles.size(); ++triangle_index) {
+		if(!triangle_removed[triangle_index]) {
+			remaining.push_back(triangles[triangle_index]);
+		}
+	}
+	triangles.swap(remaining);
+}
+
+std::vector<Simplify::Quadric> Simplify::compute_quadrics(const std::vector<Point3>& vertices, const std::vector<std::array<size_t, 3>>& triangles) {
+	std::vector<Quadric> quadrics(vertices.size());
+	for(const std::array<size_t, 3>& triangle : triangles) {
+		const Point3& a = vertices[triangle[0]];
+		const Point3& b = vertices[triangle[1]];
+		const Point3& c = vertices[triangle[2]];
+		Point3 normal((b.y - a.y) * (c.z - a.z) - (b.z - a.z) * (c.y - a.y), (b.z - a.z) * (c.x - a.x) - (b.x - a.x) * (c.z - a.z), (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x));
+		const double length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+		if(length == 0) {
+			continue;
+		}
+		normal.x /= length;
+		normal.y /= length;
+		normal.z /= length;
+		for(const size_t vertex : triangle) {
+			quadrics[vertex].add_plane(normal, a, length / 2); //Weighted by the area, so that small triangles don't pin down big flat areas.
+		}
+	}
+	return quadrics;
+}
+
+std::vector<std::vector<size_t>> Simplify::partition(const std::vector<Point3>& vertices, const std::vector<std::array<size_t, 3>>& triangles) {
+	std::vector<Point3> centres;
+	centres.reserve(triangles.size());
+	for(const std::array<size_t, 3>& triangle : triangles) {
+		const Point3& a = vertices[triangle[0]];
+		const Point3& b = vertices[triangle[1]];
+		const Point3& c = vertices[triangle[2]];
+		centres.emplace_back((a.x + b.x + c.x) / 3, (a.y + b.y + c.y) / 3, (a.z + b.z + c.z) / 3);
+	}
+	std::vector<size_t> order(triangles.size());
+	std::iota(order.begin(), order.end(), 0);
+
+	std::vector<std::vector<size_t>> result;
+	std::vector<std::pair<size_t, size_t>> ranges = {{0, order.size()}}; //The ranges of the order that still need to be split. The last one is split first, so that nearby partitions end up next to each other.
+	while(!ranges.empty()) {
+		const size_t begin = ranges.back().first;
+		const size_t end = ranges.back().second;
+		ranges.pop_back();
+		if(end - begin <= partition_size) {
+			result.emplace_back(order.begin() + begin, order.begin() + end);
+			continue;
+		}
+		Point3 minimum = centres[order[begin]];
+		Point3 maximum = minimum;
+		for(size_t index = begin; index < end; ++index) {
+			const Point3& centre = centres[order[index]];
+			minimum.x = std::min(minimum.x, centre.x);
+			minimum.y = std::min(minimum.y, centre.y);
+			minimum.z = std::min(minimum.z, centre.z);
+			maximum.x = std::max(maximum.x, centre.x);
+			maximum.y = std::max(maximum.y, centre.y);
+			maximum.z = std::max(maximum.z, centre.z);
+		}
+		const coord_t size_x = maximum.x - minimum.x;
+		const coord_t size_y = maximum.y - minimum.y;
+		const coord_t size_z = maximum.z - minimum.z;
+		coord_t Point3::* axis = (size_x >= size_y && size_x >= size_z) ? &Point3::x : ((size_y >= size_z) ? &Point3::y : &Point3::z);
+		const size_t middle = begin + (end - begin) / 2;
+		std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end, [&centres, axis](const size_t a, const size_t b) {
+			return centres[a].*axis < centres[b].*axis;
+		});
+		ranges.emplace_back(middle, end);
+		ranges.emplace_back(begin, middle);
+	}
+	return result;
+}
+
+void Simplify::remove_unused_vertices(std::vector<Point3>& vertices, std::vector<std::array<size_t, 3>>& triangles) {
+	constexpr size_t unused = -1;
+	std::vector<size_t> new_index(vertices.size(), unused);
+	std::vector<Point3> used_vertices;
+	for(std::array<size_t, 3>& triangle : triangles) {
+		for(size_t& vertex : triangle) {
+			if(new_index[vertex] == unused) {
+				new_index[vertex] = used_vertices.size();
+				used_vertices.push_back(vertices[vertex]);
+			}
+			vertex = new_index[vertex];
+		}
+	}
+	vertices.swap(used_vertices);
+}
+
+}
\ No newline at end of file
@@ -6,15 +6,16 @@
  * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
  */
 
-#include <iostream> //To give progress updates.
+#include <cstring> //To recognise keywords while probing.
 #include <fstream> //To read the ASCII STL files.
 #include <regex> //To match with the syntax of STL to detect the file format.
 
 #include "stl_ascii.hpp" //Definitions for this file.
+#include "trace.hpp" //To measure how long parsing takes.
 
 namespace convertto3mf {
 
-float StlAscii::is_stl_ascii(const std::string& filename) {
+float StlAscii::is_stl_ascii(const std::string& filename, const std::string& sample) {
 	float probability = 1.0 / 3.0; //Final result.
 	//Probability of a file extension being different from the contents of the file. Probably an overestimation but we want to let the magic number determine it more.
 	constexpr float probability_incorrect_extension = 0.01;
@@ -28,16 +29,7 @@ float StlAscii::is_stl_ascii(const std::string& filename) {
 		probability = probability_incorrect_extension;
 	}
 
-	//Read 1kB from the file to see if the file appears to be correctly formatted for ASCII STL.
-	std::ifstream file_handle(filename);
-	file_handle.seekg(0, file_handle.end);
-	size_t sample_size = file_handle.tellg();
-	file_handle.seekg(file_handle.beg);
-	sample_size = std::min(sample_size, size_t(1024)); //Limit to 1kB.
-	char sample_chars[sample_size];
-	file_handle.read(sample_chars, sample_size);
-	std::string sample(sample_chars); //We've read up to 1kB from this file now.
-
+	//Look at the first 1kB of the file to see if the file appears to be correctly formatted for ASCII STL.
 	//Match a line with this regex that matches on the possible lines of ASCII STL.
 	const std::regex correct_line("^\\s*$|\\s*solid.*|\\s*facet\\s*|\\s*facet normal .*|\\s*outer loop\\s*|\\s*vertex .*|\\s*endloop\\s*|\\s*endfacet\\s*|\\s*endsolid.*");
 	size_t correct_lines = 0;
@@ -66,21 +58,53 @@ float StlAscii::is_stl_ascii(const std::string& filename) {
 	return probability;
 }
 
-Model StlAscii::import(const std::string& filename) {
-	std::cout << "Importing ASCII STL file: " << filename << std::endl;
+Model StlAscii::import(const std::string& filename, Monitor* monitor) {
+	if(monitor) {
+		monitor->log("Importing ASCII STL file: " + filename);
+	}
+	std::ifstream file_handle(filename);
+	return import(file_handle, monitor);
+}
+
+Model StlAscii::import(std::istream& stream, Monitor* monitor) {
+	Trace::Span span("parse");
 	StlAscii stl; //Store the STL in its own representation.
+	stl.monitor = monitor;
 
-	stl.load(filename);
+	stl.load(stream);
+	size_t num_faces = 0;
+	for(const std::vector<std::vector<Point3>>& mesh : stl.meshes) {
+		num_faces += mesh.size();
+	}
+	span.set_items(num_faces);
 	return stl.to_model();
 }
 
-void StlAscii::load(const std::string& filename) {
-	std::ifstream file_handle(filename);
+void StlAscii::probe(const char* data, const size_t size, Probe& result) {
+	Probe::visit_lines(data, size, [](const char* line, const size_t length, Probe& probe) {
+		const char* end = line + length;
+		while(line < end && (*line == ' ' || *line == '\t')) {
+			line++;
+		}
+		if(end - line >= 6 && memcmp(line, "vertex", 6) == 0) {
+			Point3 vertex(0, 0, 0);
+			if(Probe::parse_vertex(line + 6, end, vertex)) {
+				probe.num_vertices++;
+				probe.include(vertex);
+			}
+		} else if(end - line >= 5 && memcmp(line, "facet", 5) == 0) {
+			probe.num_triangles++;
+		}
+	}, result);
+}
 
+void StlAscii::load(std::istream& stream) {
 	//Get all lines from the file and trim them.
 	std::vector<std::string> lines;
 	lines.reserve(128000); //Most files are going to contain at least this amount of lines. Prevent copying too often when growing.
-	for(std::string line; std::getline(file_handle, line);) {
+	size_t unreported_bytes = 0; //Bytes read since the last time progress was reported.
+	for(std::string line; std::getline(stream, line);) {
+		unreported_bytes += line.length() + 1; //Including the newline.
 		//Trim whitespace from the line.
 		size_t first = line.find_first_not_of(" \t\n\r\f");
 		if(first == std::string::npos) {
@@ -90,13 +114,26 @@ void StlAscii::load(const std::string& filename) {
 			line = line.substr(first, (last - first + 1));
 		}
 		lines.push_back(line);
+		if(monitor && lines.size() % Monitor::report_interval == 0) {
+			monitor->advance(unreported_bytes, 0);
+			unreported_bytes = 0;
+		}
+	}
+	if(monitor) {
+		monitor->advance(unreported_bytes, 0);
 	}
 
 	std::vector<std::vector<Point3>>* mesh = nullptr; //The current mesh we're working on, or nullptr if we're not currently parsing a mesh.
 	std::vector<Point3>* face = nullptr; //The current face we're working on, or nullptr if we're not currently parsing a facet.
 	bool in_loop = false; //Track whether we're currently inside of an "outer loop" definition. Vertices are only valid inside the loop.
 
-	for(const std::string& line : lines) {
+	size_t unreported_faces = 0; //Faces found since the last time progress was reported.
+	for(size_t line_index = 0; line_index < lines.size(); ++line_index) {
+		const std::string& line = lines[line_index];
+		if(monitor && line_index % Monitor::report_interval == 0) {
+			monitor->advance(0, unreported_faces);
+			unreported_faces = 0;
+		}
 		if(line.find("solid") == 0) {
 			meshes.emplace_back(); //Invalidates pointers! Make sure we reset those.
 			mesh = &meshes.back();
@@ -110,6 +147,7 @@ void StlAscii::load(const std::string& filename) {
 			mesh->emplace_back();
 			face = &mesh->back();
 			in_loop = false;
+			unreported_faces++;
 		} else if(line == "endfacet") {
 			face = nullptr;
 			in_loop = false;
@@ -167,6 +205,9 @@ void StlAscii::load(const std::string& filename) {
 			face->emplace_back(x, y, z);
 		}
 	}
+	if(monitor) {
+		monitor->advance(0, unreported_faces);
+	}
 }
 
 Model StlAscii::to_model() const {
@@ -6,14 +6,20 @@
  * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
  */
 
-#include <fstream> //To read binary STL files.
-#include <iostream> //To message progress.
+#include <algorithm> //For std::min.
+#include <cstring> //To read binary data with memcpy.
+#include <vector> //To find the bounding box of parts of the file in parallel.
 
+#include "detect_file_type.hpp" //To recognise unknown file sizes.
+#include "mapped_file.hpp" //To read binary STL files without copying them.
+#include "parallel.hpp" //To find the bounding box in parallel.
 #include "stl_binary.hpp" //The definitions for this file.
+#include "trace.hpp" //To measure how long parsing takes.
+#include "unpack.hpp" //To unpack the coordinates of the triangles quickly.
 
 namespace convertto3mf {
 
-float StlBinary::is_stl_binary(const std::string& filename) {
+float StlBinary::is_stl_binary(const std::string& filename, const std::string& sample, const size_t file_size) {
 	float probability = 1.0 / 3.0; //Final result.
 	//Probability of a file extension being different from the contents of the file. Probably an overestimation but we want to let the magic number determine it more.
 	constexpr float probability_incorrect_extension = 0.01;
@@ -27,24 +33,38 @@ float StlBinary::is_stl_binary(const std::string& filename) {
 		probability = probability_incorrect_extension;
 	}
 
-	bool correct_file_size = true;
-	//Check that the file is at least as big as the minimum header.
-	std::ifstream file_handle(filename, std::ios_base::in | std::ios_base::binary);
-	file_handle.seekg(0, file_handle.end);
-	size_t file_size = file_handle.tellg();
-	file_handle.seekg(file_handle.beg);
-	if(file_size < 84) {
-		correct_file_size = false;
+	if(file_size == unknown_file_size) {
+		//Without knowing the file size, we can only check whether the triangle data looks like binary data rather than text. That's much less certain.
+		constexpr float probability_incorrect_content = 0.01;
+		bool binary_content = false;
+		for(size_t i = 84; i < sample.size(); ++i) {
+			const unsigned char character = sample[i];
+			if(character < '\t' || (character > '\r' && character < ' ') || character > '~') {
+				binary_content = true;
+				break;
+			}
+		}
+		if(binary_content) {
+			probability = 1.0 - ((1.0 - probability) * probability_incorrect_content);
+		} else {
+			probability *= probability_incorrect_content;
+		}
+		return probability;
 	}
 
-	//Read the supposed number of triangles.
-	file_handle.seekg(80, file_handle.beg);
-	uint32_t num_triangles;
-	file_handle.read((char*)&num_triangles, sizeof(num_triangles)); //Works correctly since most CPUs are little-endian.
-
-	//Verify that the file size is exactly correct.
-	if(file_size != 84 + 50 * num_triangles) {
+	bool correct_file_size = true;
+	//Check that the file is at least as big as the minimum header.
+	if(file_size < 84 || sample.size() < 84) {
 		correct_file_size = false;
+	} else {
+		//Read the supposed number of triangles.
+		uint32_t num_triangles;
+		memcpy(&num_triangles, sample.data() + 80, sizeof(num_triangles)); //Works correctly since most CPUs are little-endian.
+
+		//Verify that the file size is exactly correct.
+		if(file_size != 84 + 50 * size_t(num_triangles)) {
+			correct_file_size = false;
+		}
 	}
 
 	//Adjust the probability based on the file size.
@@ -57,48 +77,88 @@ float StlBinary::is_stl_binary(const std::string& filename) {
 	return probability;
 }
 
-Model StlBinary::import(const std::string& filename) {
-	std::cout << "Importing binary STL file: " << filename << std::endl;
+Model StlBinary::import(const std::string& filename, Monitor* monitor) {
+	if(monitor) {
+		monitor->log("Importing binary STL file: " + filename);
+	}
+	const MappedFile file(filename);
+	return import(file.data(), file.size(), monitor);
+}
+
+Model StlBinary::import(const char* data, const size_t size, Monitor* monitor) {
+	Trace::Span span("parse");
+	span.set_bytes(size);
 	StlBinary stl; //Store the STL in its own representation.
+	stl.monitor = monitor;
 
-	stl.load(filename);
+	stl.load(data, size);
+	span.set_items(stl.triangles.size());
 	return stl.to_model();
 }
 
-void StlBinary::load(const std::string& filename) {
-	std::ifstream file_handle(filename, std::ios_base::in | std::ios_base::binary);
+void StlBinary::probe(const char* data, const size_t size, Probe& result) {
+	if(size < 84) { //Not even a complete header.
+		return;
+	}
+	uint32_t num_triangles;
+	memcpy(&num_triangles, data + 80, sizeof(num_triangles));
+	if((size - 84) / 50 < num_triangles) { //Number of triangles must be corrupt.
+		num_triangles = (size - 84) / 50;
+	}
+	result.num_triangles = num_triangles;
+	result.num_vertices = size_t(num_triangles) * 3;
+
+	//Each thread unpacks a range of the triangles, finding the bounding box of that range.
+	const size_t num_ranges = std::max(size_t(1), std::min(num_worker_threads(), (size_t(num_triangles) + batch_size - 1) / batch_size));
+	std::vector<Probe> ranges(num_ranges);
+	parallel_for(num_ranges, [data, num_triangles, num_ranges, &ranges](const size_t range) {
+		const size_t range_start = size_t(num_triangles) * range / num_ranges;
+		const size_t range_end = size_t(num_triangles) * (range + 1) / num_ranges;
+		std::vector<coord_t> coordinates(batch_size * 9);
+		for(size_t batch_start = range_start; batch_start < range_end; batch_start += batch_size) {
+			const size_t batch_end = std::min(range_end, batch_start + batch_size);
+			Unpack::unpack_triangles(data + 84 + batch_start * 50 + 12, 50, batch_end - batch_start, coordinates.data());
+			for(const coord_t* vertex = coordinates.data(); vertex < coordinates.data() + (batch_end - batch_start) * 9; vertex += 3) {
+				ranges[range].include(Point3(vertex[0], vertex[1], vertex[2]));
+			}
+		}
+	});
+	for(const Probe& range : ranges) {
+		result.include(range);
+	}
+}
+
+void StlBinary::load(const char* data, const size_t size) {
+	if(size < 84) { //Not even a complete header.
+		return;
+	}
 
 	//Read the number of triangles.
-	file_handle.seekg(80, file_handle.beg);
 	uint32_t num_triangles;
-	file_handle.read((char*)&num_triangles, sizeof(num_triangles));
-	file_handle.seekg(0, file_handle.end);
-	size_t file_size = file_handle.tellg();
-	file_handle.seekg(84, file_handle.beg);
-	if((file_size - 84) / 50 < num_triangles) { //Number of triangles must be corrupt.
-		num_triangles = (file_size - 84) / 50; //Prevent reading outside of the file, or allocating absurd amounts of memory.
+	memcpy(&num_triangles, data + 80, sizeof(num_triangles));
+	if((size - 84) / 50 < num_triangles) { //Number of triangles must be corrupt.
+		num_triangles = (size - 84) / 50; //Prevent reading outside of the file, or allocating absurd amounts of memory.
 	}
 	triangles.reserve(num_triangles);
 
-	for(size_t triangle_index = 0; triangle_index < num_triangles; ++triangle_index) {
-		file_handle.seekg(84 + triangle_index * 50 + 12); //Skip over the normal vector. We don't need them.
-		float v1_x, v1_y, v1_z, v2_x, v2_y, v2_z, v3_x, v3_y, v3_z;
-		file_handle.read((char*)&v1_x, sizeof(float)); //Assuming that your CPU uses 32-bit floats, which is pretty much every desktop CPU.
-		file_handle.read((char*)&v1_y, sizeof(float));
-		file_handle.read((char*)&v1_z, sizeof(float));
-		file_handle.read((char*)&v2_x, sizeof(float));
-		file_handle.read((char*)&v2_y, sizeof(float));
-		file_handle.read((char*)&v2_z, sizeof(float));
-		file_handle.read((char*)&v3_x, sizeof(float));
-		file_handle.read((char*)&v3_y, sizeof(float));
-		file_handle.read((char*)&v3_z, sizeof(float));
-
-		std::array<Point3, 3> triangle = {
-			Point3(v1_x, v1_y, v1_z),
-			Point3(v2_x, v2_y, v2_z),
-			Point3(v3_x, v3_y, v3_z)
-		};
-		triangles.push_back(triangle);
+	//Unpack the coordinates in batches, to keep the buffer small enough to stay in the cache.
+	std::vector<coord_t> coordinates(batch_size * 9);
+	for(size_t batch_start = 0; batch_start < num_triangles; batch_start += batch_size) {
+		const size_t batch_end = std::min(size_t(num_triangles), batch_start + batch_size);
+		Unpack::unpack_triangles(data + 84 + batch_start * 50 + 12, 50, batch_end - batch_start, coordinates.data()); //Skip over the normal vector. We don't need them.
+		for(const coord_t* triangle = coordinates.data(); triangle < coordinates.data() + (batch_end - batch_start) * 9; triangle += 9) {
+			triangles.push_back({
+				Point3(triangle[0], triangle[1], triangle[2]),
+				Point3(triangle[3], triangle[4], triangle[5]),
+				Point3(triangle[6], triangle[7], triangle[8])
+			});
+		}
+		if(monitor && batch_end % Monitor::report_interval == 0) { //The batches divide the interval, so this reports every so many batches.
+			monitor->advance(Monitor::report_interval * 50, Monitor::report_interval);
+		}
+	}
+	if(monitor) { //Report the remainder after the last full interval, and the header.
+		monitor->advance(84 + (num_triangles % Monitor::report_interval) * 50, num_triangles % Monitor::report_interval);
 	}
 }
 
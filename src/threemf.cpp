@@ -6,131 +6,884 @@
  * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
  */
 
-#include <iostream> //To message progress.
-#include <cstdio> //To remove any existing file before writing the new one.
+#include <algorithm> //To move the components of meshes into the list of meshes.
+#include <fstream> //To find the size of the written file.
+#include <iomanip> //To format UUIDs.
+#include <iterator> //To append the components of meshes to the list of meshes.
+#include <limits> //To write translations exactly.
+#include <cmath> //To round coordinates for fingerprints of meshes and to snap them to a grid.
+#include <cerrno> //To report why writing failed.
+#include <cstdio> //To write the archive into the file.
+#include <cstdlib> //To create temporary files.
+#include <cstring> //To format quantised vertices quickly, and to describe errors.
+#include <memory> //To share the vertex indices of a model part between its chunks.
+#include <mutex> //To generate UUIDs from multiple threads.
+#include <random> //To generate UUIDs.
+#include <sstream> //To serialise the model, and to format messages about the conversion.
+#include <stdexcept> //To report failures to write the file.
 #include <unordered_map> //To make vertices unique and track their indices.
 
+#include <sys/stat.h> //To find out whether the output is a regular file, and to set the permissions of the temporary file.
+#include <unistd.h> //To sync the file to disk.
+
+#include "components.hpp" //To split meshes into their connected components.
+#include "parallel.hpp" //To serialise model parts in parallel.
+#include "reorder.hpp" //To optionally reorder vertices and triangles for locality.
+#include "simplify.hpp" //To optionally reduce the number of triangles.
 #include "threemf.hpp" //The definitions for this file.
+#include "trace.hpp" //To measure how long each stage of writing takes.
+#include "validation.hpp" //To optionally check the meshes for problems.
 
 namespace convertto3mf {
 
-void ThreeMF::export_to_file(const std::string& filename, const Model& model) {
-	std::cout << "Writing 3MF file: " << filename << std::endl;
-	ThreeMF threemf;
+ThreeMF::ThreeMF(const Options& options) : options(options), quantize_decimals(0) {
+	if(options.quantize > 0) { //Find how many decimals are needed to write multiples of the grid size exactly.
+		const double step = options.quantize / 1000; //From micrometres to millimetres.
+		double scale = 1;
+		while(quantize_decimals < 9 && std::abs(step * scale - std::round(step * scale)) > 1e-6 * step * scale) {
+			quantize_decimals++;
+			scale *= 10;
+		}
+	}
+};
+
+void ThreeMF::export_to_file(const std::string& filename, const Model& model, const Options& options) {
+	if(options.monitor) {
+		options.monitor->log("Writing 3MF file: " + filename);
+	}
+	ThreeMF threemf(options);
 	threemf.fill_from_model(model);
-	std::remove(filename.c_str()); //Remove any old archive if one exists.
 	threemf.write(filename);
+
+	if(options.monitor) {
+		std::ifstream written_file(filename, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+		options.monitor->log("Wrote " + std::to_string(written_file.tellg()) + " bytes.");
+	}
+}
+
+void ThreeMF::export_to_callback(const Model& model, const Options& options, const std::function<void(const char*, size_t)>& output) {
+	ThreeMF threemf(options);
+	threemf.fill_from_model(model);
+	threemf.write(output);
 }
 
 void ThreeMF::fill_from_model(const Model& model) {
+	if(options.monitor) {
+		options.monitor->start_phase(Monitor::Phase::WELD);
+	}
+	//The meshes are independent of each other, so they can be welded in parallel.
+	vertices.resize(model.meshes.size());
+	triangles.resize(model.meshes.size());
+	triangle_batches.assign(model.meshes.size(), std::vector<Mesh::TriangleBatch>());
+	parallel_for(model.meshes.size(), [this, &model](const size_t mesh_index) {
+		fill_from_mesh(model.meshes[mesh_index], mesh_index);
+	});
+	names.clear();
 	for(const Mesh& mesh : model.meshes) {
-		std::unordered_map<Point3, size_t> vertex_to_index; //For each unique vertex, tracks the index within the vertex list.
-		vertex_to_index.reserve(10000); //It's unknown how many unique vertices there will be and the vertices are spread around many tiny vectors, so just guess at 10k to start with.
-		vertices.emplace_back();
-		std::vector<Point3>& mesh_vertices = vertices.back();
-		mesh_vertices.reserve(10000);
-		triangles.emplace_back();
-		std::vector<std::array<size_t, 3>>& mesh_triangles = triangles.back();
-		mesh_triangles.reserve(mesh.faces.size()); //Would be correct if all faces are triangles. If not, it'll need to reserve more, but for most models this would be fine.
-
-		for(const Face& face : mesh.faces) {
-			//Each face is a triangle fan. We need to convert this into individual triangles.
-			if(face.vertices.size() < 3) { //Not enough vertices to form a triangle. Lines and points are not saved.
-				continue;
+		names.push_back(mesh.name);
+	}
+	if(options.split_components) {
+		split_components();
+	}
+
+	//By default, build each mesh once in its original position.
+	items.clear();
+	for(size_t mesh_index = 0; mesh_index < vertices.size(); ++mesh_index) {
+		items.push_back({mesh_index, Point3(0, 0, 0)});
+	}
+	if(options.instancing) {
+		find_instances();
+	}
+
+	if(options.max_triangles > 0) {
+		size_t num_triangles = 0;
+		for(const std::vector<std::array<size_t, 3>>& mesh_triangles : triangles) {
+			num_triangles += mesh_triangles.size();
+		}
+		if(num_triangles > options.max_triangles) {
+			//Each mesh gets a share of the budget in proportion to its size. Copies found by instancing are only stored once, so they are only simplified once.
+			parallel_for(vertices.size(), [this, num_triangles](const size_t mesh_index) {
+				const size_t target = options.max_triangles * triangles[mesh_index].size() / num_triangles;
+				Simplify::simplify(vertices[mesh_index], triangles[mesh_index], target);
+			});
+			size_t num_simplified = 0;
+			for(const std::vector<std::array<size_t, 3>>& mesh_triangles : triangles) {
+				num_simplified += mesh_triangles.size();
+			}
+			if(options.monitor) {
+				options.monitor->log("Simplified from " + std::to_string(num_triangles) + " to " + std::to_string(num_simplified) + " triangles.");
 			}
+		}
+	}
 
-			const Point3 first = face.vertices[0]; //As per the triangle fan, the first vertex is always repeated for each triangle.
-			if(vertex_to_index.find(first) == vertex_to_index.end()) { //Not yet in our mesh. Need to create an index and store it in the vertex list.
-				vertex_to_index.emplace(first, mesh_vertices.size());
-				mesh_vertices.push_back(first);
+	if(options.reorder) {
+		std::vector<double> misses_before(vertices.size(), 0); //For each mesh, the cache misses before reordering, to report the improvement.
+		std::vector<double> misses_after(vertices.size(), 0);
+		parallel_for(vertices.size(), [this, &misses_before, &misses_after](const size_t mesh_index) {
+			std::vector<Point3>& mesh_vertices = vertices[mesh_index];
+			std::vector<std::array<size_t, 3>>& mesh_triangles = triangles[mesh_index];
+			misses_before[mesh_index] = Reorder::average_cache_miss_ratio(mesh_triangles, mesh_vertices.size()) * mesh_triangles.size();
+			Reorder::reorder(mesh_vertices, mesh_triangles);
+			misses_after[mesh_index] = Reorder::average_cache_miss_ratio(mesh_triangles, mesh_vertices.size()) * mesh_triangles.size();
+		});
+
+		size_t num_triangles = 0;
+		double total_misses_before = 0;
+		double total_misses_after = 0;
+		for(size_t mesh_index = 0; mesh_index < triangles.size(); ++mesh_index) {
+			num_triangles += triangles[mesh_index].size();
+			total_misses_before += misses_before[mesh_index];
+			total_misses_after += misses_after[mesh_index];
+		}
+		if(num_triangles > 0 && options.monitor) {
+			std::stringstream message;
+			message << "Reordered for locality. Average cache miss ratio went from " << (total_misses_before / num_triangles) << " to " << (total_misses_after / num_triangles) << ".";
+			options.monitor->log(message.str());
+		}
+	}
+
+	if(options.validate) {
+		//Each mesh is validated in parallel internally, so that one big mesh doesn't leave the other threads idle.
+		Validation validation;
+		for(size_t mesh_index = 0; mesh_index < vertices.size(); ++mesh_index) {
+			validation.include(Validation::validate(vertices[mesh_index], triangles[mesh_index], mesh_index));
+		}
+		if(options.monitor) {
+			std::stringstream report;
+			validation.write_report(report);
+			std::string message = report.str();
+			message.pop_back(); //Without the line break at the end.
+			options.monitor->log(message);
+		}
+	}
+}
+
+void ThreeMF::fill_from_mesh(const Mesh& mesh, const size_t mesh_index) {
+	Trace::Span span("dedup");
+	std::unordered_map<Point3, size_t> vertex_to_index; //For each unique vertex, tracks the index within the vertex list.
+	vertex_to_index.reserve(10000); //It's unknown how many unique vertices there will be and the vertices are spread around many tiny vectors, so just guess at 10k to start with.
+	std::vector<Point3>& mesh_vertices = vertices[mesh_index];
+	mesh_vertices.reserve(10000);
+	std::vector<std::array<size_t, 3>>& mesh_triangles = triangles[mesh_index];
+	mesh_triangles.reserve(mesh.triangles.size() + mesh.faces.size()); //Would be correct if all faces are triangles. If not, it'll need to reserve more, but for most models this would be fine.
+
+	//The indexed part of the mesh can be copied directly, without making the vertices unique again.
+	//But when quantising, vertices may end up in the same place, so then they need to be made unique after snapping them.
+	std::shared_ptr<std::vector<size_t>> remap; //When quantising, for each indexed vertex, its index after making them unique.
+	if(options.quantize > 0) {
+		remap = std::make_shared<std::vector<size_t>>();
+		remap->reserve(mesh.vertices.size());
+		for(const Point3& vertex : mesh.vertices) {
+			const Point3 snapped = snap(vertex);
+			const std::pair<std::unordered_map<Point3, size_t>::iterator, bool> inserted = vertex_to_index.emplace(snapped, mesh_vertices.size());
+			if(inserted.second) { //Not yet in our mesh.
+				mesh_vertices.push_back(snapped);
 			}
-			Point3 last = face.vertices[1]; //As per the triangle fan, the last vertex is repeated for the next triangle.
-			if(vertex_to_index.find(last) == vertex_to_index.end()) {
-				vertex_to_index.emplace(last, mesh_vertices.size());
-				mesh_vertices.push_back(last);
+			remap->push_back(inserted.first->second);
+		}
+	} else {
+		mesh_vertices.insert(mesh_vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+	}
+	const size_t num_indexed_vertices = mesh.vertices.size();
+	auto add_indexed = [remap, num_indexed_vertices](const std::array<size_t, 3>& triangle, std::vector<std::array<size_t, 3>>& output) {
+		if(triangle[0] >= num_indexed_vertices || triangle[1] >= num_indexed_vertices || triangle[2] >= num_indexed_vertices) { //Refers to a vertex that doesn't exist.
+			return;
+		}
+		if(!remap) {
+			output.push_back(triangle);
+			return;
+		}
+		const std::array<size_t, 3> remapped = {(*remap)[triangle[0]], (*remap)[triangle[1]], (*remap)[triangle[2]]};
+		if(remapped[0] != remapped[1] && remapped[1] != remapped[2] && remapped[0] != remapped[2]) { //Snapping may collapse triangles.
+			output.push_back(remapped);
+		}
+	};
+	for(const std::array<size_t, 3>& triangle : mesh.triangles) {
+		add_indexed(triangle, mesh_triangles);
+	}
+	size_t reported_triangles = 0; //How many of the resulting triangles were reported to the monitor so far.
+	if(needs_all_triangles(options)) { //Produce the triangles that would otherwise be produced while writing.
+		std::vector<std::array<size_t, 3>> batch_triangles;
+		for(const Mesh::TriangleBatch& batch : mesh.triangle_batches) {
+			batch_triangles.clear();
+			batch(batch_triangles);
+			for(const std::array<size_t, 3>& triangle : batch_triangles) {
+				add_indexed(triangle, mesh_triangles);
+			}
+			if(options.monitor) {
+				options.monitor->advance(0, mesh_triangles.size() - reported_triangles);
+				reported_triangles = mesh_triangles.size();
 			}
-			for(size_t i = 2; i < face.vertices.size(); ++i) {
-				const Point3 vertex = face.vertices[i];
-				if(vertex_to_index.find(vertex) == vertex_to_index.end()) {
-					vertex_to_index.emplace(vertex, mesh_vertices.size());
-					mesh_vertices.push_back(vertex);
+		}
+	} else if(remap) { //Renumber the triangles of the batches as they are produced.
+		for(const Mesh::TriangleBatch& batch : mesh.triangle_batches) {
+			triangle_batches[mesh_index].push_back([batch, add_indexed](std::vector<std::array<size_t, 3>>& output) {
+				std::vector<std::array<size_t, 3>> batch_triangles;
+				batch(batch_triangles);
+				for(const std::array<size_t, 3>& triangle : batch_triangles) {
+					add_indexed(triangle, output);
 				}
-				std::array<size_t, 3> triangle = {vertex_to_index[first], vertex_to_index[last], vertex_to_index[vertex]};
-				mesh_triangles.push_back(triangle);
-				last = vertex; //The new last vertex.
+			});
+		}
+	} else {
+		triangle_batches[mesh_index] = mesh.triangle_batches;
+	}
+
+	for(size_t face_index = 0; face_index < mesh.faces.size(); ++face_index) {
+		if(options.monitor && (face_index + 1) % Monitor::report_interval == 0) {
+			options.monitor->advance(0, mesh_triangles.size() - reported_triangles);
+			reported_triangles = mesh_triangles.size();
+		}
+		const Face& face = mesh.faces[face_index];
+		//Each face is a triangle fan. We need to convert this into individual triangles.
+		if(face.vertices.size() < 3) { //Not enough vertices to form a triangle. Lines and points are not saved.
+			continue;
+		}
+
+		const Point3 first = snap(face.vertices[0]); //As per the triangle fan, the first vertex is always repeated for each triangle.
+		if(vertex_to_index.find(first) == vertex_to_index.end()) { //Not yet in our mesh. Need to create an index and store it in the vertex list.
+			vertex_to_index.emplace(first, mesh_vertices.size());
+			mesh_vertices.push_back(first);
+		}
+		Point3 last = snap(face.vertices[1]); //As per the triangle fan, the last vertex is repeated for the next triangle.
+		if(vertex_to_index.find(last) == vertex_to_index.end()) {
+			vertex_to_index.emplace(last, mesh_vertices.size());
+			mesh_vertices.push_back(last);
+		}
+		for(size_t i = 2; i < face.vertices.size(); ++i) {
+			const Point3 vertex = snap(face.vertices[i]);
+			if(vertex_to_index.find(vertex) == vertex_to_index.end()) {
+				vertex_to_index.emplace(vertex, mesh_vertices.size());
+				mesh_vertices.push_back(vertex);
+			}
+			std::array<size_t, 3> triangle = {vertex_to_index[first], vertex_to_index[last], vertex_to_index[vertex]};
+			last = vertex; //The new last vertex.
+			if(options.quantize > 0 && (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])) { //Snapping collapsed this triangle.
+				continue;
+			}
+			mesh_triangles.push_back(triangle);
+		}
+	}
+	if(options.monitor) {
+		options.monitor->advance(0, mesh_triangles.size() - reported_triangles); //The rest of the triangles that this mesh ended up with.
+	}
+	span.set_items(mesh_triangles.size());
+}
+
+bool ThreeMF::needs_all_triangles(const Options& options) {
+	return options.split_components || options.instancing || options.reorder || options.validate || options.max_triangles > 0 || options.split_parts;
+}
+
+Point3 ThreeMF::snap(const Point3& vertex) const {
+	if(options.quantize <= 0) {
+		return vertex;
+	}
+	const coord_t step = options.quantize / 1000; //From micrometres to millimetres.
+	return Point3(std::round(vertex.x / step) * step, std::round(vertex.y / step) * step, std::round(vertex.z / step) * step);
+}
+
+void ThreeMF::split_components() {
+	std::vector<std::vector<Point3>> split_vertices;
+	std::vector<std::vector<std::array<size_t, 3>>> split_triangles;
+	std::vector<std::string> split_names;
+	for(size_t mesh_index = 0; mesh_index < vertices.size(); ++mesh_index) {
+		std::vector<std::vector<Point3>> component_vertices;
+		std::vector<std::vector<std::array<size_t, 3>>> component_triangles;
+		Components::split(vertices[mesh_index], triangles[mesh_index], component_vertices, component_triangles);
+		std::vector<Point3>().swap(vertices[mesh_index]); //Free the memory of the original mesh as soon as possible.
+		std::vector<std::array<size_t, 3>>().swap(triangles[mesh_index]);
+
+		std::move(component_vertices.begin(), component_vertices.end(), std::back_inserter(split_vertices));
+		std::move(component_triangles.begin(), component_triangles.end(), std::back_inserter(split_triangles));
+		split_names.insert(split_names.end(), component_vertices.size(), names[mesh_index]);
+	}
+	if(split_vertices.size() != vertices.size()) {
+		if(options.monitor) {
+			options.monitor->log("Split " + std::to_string(vertices.size()) + " meshes into " + std::to_string(split_vertices.size()) + " connected components.");
+		}
+	}
+	vertices.swap(split_vertices);
+	triangles.swap(split_triangles);
+	names.swap(split_names);
+}
+
+void ThreeMF::find_instances() {
+	//Fingerprint all meshes in parallel.
+	std::vector<size_t> fingerprints(vertices.size());
+	parallel_for(vertices.size(), [this, &fingerprints](const size_t mesh_index) {
+		fingerprints[mesh_index] = fingerprint(mesh_index);
+	});
+	std::unordered_map<size_t, std::vector<size_t>> meshes_by_fingerprint; //For each fingerprint, the meshes that have it, in order.
+	for(size_t mesh_index = 0; mesh_index < vertices.size(); ++mesh_index) {
+		meshes_by_fingerprint[fingerprints[mesh_index]].push_back(mesh_index);
+	}
+
+	//For each mesh, find the first earlier mesh that it is a copy of. This comparison is done in parallel too.
+	std::vector<size_t> copy_of(vertices.size());
+	parallel_for(vertices.size(), [this, &fingerprints, &meshes_by_fingerprint, &copy_of](const size_t mesh_index) {
+		copy_of[mesh_index] = mesh_index;
+		for(const size_t candidate : meshes_by_fingerprint.at(fingerprints[mesh_index])) {
+			if(candidate >= mesh_index) { //Only earlier meshes can be the original.
+				break;
+			}
+			if(is_translated_copy(candidate, mesh_index)) {
+				copy_of[mesh_index] = candidate;
+				break;
 			}
 		}
+	});
+
+	//Keep only the originals, and let the build items place those instead of the copies.
+	std::vector<size_t> new_index(vertices.size()); //For each original mesh, its index after removing the copies.
+	size_t num_originals = 0;
+	for(size_t mesh_index = 0; mesh_index < vertices.size(); ++mesh_index) {
+		if(copy_of[mesh_index] == mesh_index) {
+			new_index[mesh_index] = num_originals;
+			vertices[num_originals].swap(vertices[mesh_index]);
+			triangles[num_originals].swap(triangles[mesh_index]);
+			names[num_originals].swap(names[mesh_index]);
+			num_originals++;
+			continue;
+		}
+		copy_of[mesh_index] = copy_of[copy_of[mesh_index]]; //If the earlier mesh was a copy itself, refer to its original. That one was resolved already.
+		const Point3& original_start = vertices[new_index[copy_of[mesh_index]]][0];
+		const Point3& copy_start = vertices[mesh_index][0];
+		items[mesh_index].translation = Point3(copy_start.x - original_start.x, copy_start.y - original_start.y, copy_start.z - original_start.z);
+	}
+	for(size_t mesh_index = 0; mesh_index < items.size(); ++mesh_index) {
+		items[mesh_index].mesh_index = new_index[copy_of[mesh_index]];
+	}
+	if(num_originals < vertices.size()) {
+		if(options.monitor) {
+			options.monitor->log("Found " + std::to_string(vertices.size() - num_originals) + " copies of other meshes. Writing " + std::to_string(num_originals) + " unique meshes.");
+		}
 	}
+	vertices.resize(num_originals);
+	triangles.resize(num_originals);
+	names.resize(num_originals);
+}
+
+size_t ThreeMF::fingerprint(const size_t mesh_index) const {
+	const std::vector<Point3>& mesh_vertices = vertices[mesh_index];
+	const std::vector<std::array<size_t, 3>>& mesh_triangles = triangles[mesh_index];
+	auto combine = [](size_t& hash, const size_t value) {
+		hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+	};
+
+	size_t hash = std::hash<size_t>()(mesh_vertices.size());
+	combine(hash, mesh_triangles.size());
+	for(const std::array<size_t, 3>& triangle : mesh_triangles) {
+		combine(hash, triangle[0]);
+		combine(hash, triangle[1]);
+		combine(hash, triangle[2]);
+	}
+	//The shape is described by the positions of the vertices relative to the first vertex.
+	//These are rounded to 0.01mm, so that tiny rounding errors in the positions of copies don't change the fingerprint (except very rarely, when it crosses the rounding boundary).
+	constexpr coord_t resolution = 0.01;
+	for(const Point3& vertex : mesh_vertices) {
+		combine(hash, std::hash<long long>()(std::llround((vertex.x - mesh_vertices[0].x) / resolution)));
+		combine(hash, std::hash<long long>()(std::llround((vertex.y - mesh_vertices[0].y) / resolution)));
+		combine(hash, std::hash<long long>()(std::llround((vertex.z - mesh_vertices[0].z) / resolution)));
+	}
+	return hash;
+}
+
+bool ThreeMF::is_translated_copy(const size_t original_index, const size_t copy_index) const {
+	const std::vector<Point3>& original_vertices = vertices[original_index];
+	const std::vector<Point3>& copy_vertices = vertices[copy_index];
+	if(original_vertices.size() != copy_vertices.size() || original_vertices.empty() || triangles[original_index] != triangles[copy_index]) {
+		return false;
+	}
+
+	//All vertices must be moved by the same distance as the first vertex.
+	//The coordinates of copies may have been rounded differently after moving them, for instance if they were stored as 32-bit floats. Allow for an error of 1 part per million.
+	constexpr coord_t relative_tolerance = 1e-6;
+	const Point3& original_start = original_vertices[0];
+	const Point3& copy_start = copy_vertices[0];
+	auto same = [relative_tolerance](const coord_t original, const coord_t original_start, const coord_t copy, const coord_t copy_start) {
+		const coord_t tolerance = relative_tolerance * (1 + std::max(std::abs(original), std::abs(copy)));
+		return std::abs((copy - copy_start) - (original - original_start)) <= tolerance;
+	};
+	for(size_t vertex_index = 1; vertex_index < original_vertices.size(); ++vertex_index) {
+		const Point3& original = original_vertices[vertex_index];
+		const Point3& copy = copy_vertices[vertex_index];
+		if(!same(original.x, original_start.x, copy.x, copy_start.x) || !same(original.y, original_start.y, copy.y, copy_start.y) || !same(original.z, original_start.z, copy.z, copy_start.z)) {
+			return false;
+		}
+	}
+	return true;
 }
 
 void ThreeMF::write(const std::string& filename) const {
-	int ziperror = 0;
-	zip_t* archive = zip_open(filename.c_str(), ZIP_CREATE, &ziperror);
+	struct stat target_status;
+	if(stat(filename.c_str(), &target_status) == 0 && !S_ISREG(target_status.st_mode)) { //Devices and pipes can't be replaced, so write straight into them.
+		std::FILE* file = std::fopen(filename.c_str(), "wb");
+		if(!file) {
+			throw std::runtime_error("Could not open " + filename + " for writing: " + std::strerror(errno));
+		}
+		write_to_file(file, filename);
+		return;
+	}
+
+	//Write into a temporary file next to the output, and only replace the output with it once the archive is complete.
+	std::string temporary_filename = filename + ".XXXXXX";
+	const int descriptor = mkstemp(&temporary_filename[0]);
+	if(descriptor < 0) {
+		throw std::runtime_error("Could not create a temporary file to write " + filename + ": " + std::strerror(errno));
+	}
+	const mode_t mask = umask(0); //Only the owner may access temporary files, but the output should get the usual permissions.
+	umask(mask);
+	fchmod(descriptor, 0666 & ~mask);
+	std::FILE* file = fdopen(descriptor, "wb");
+	if(!file) {
+		close(descriptor);
+		std::remove(temporary_filename.c_str());
+		throw std::runtime_error("Could not open a temporary file to write " + filename + ".");
+	}
+	try {
+		write_to_file(file, temporary_filename);
+	} catch(...) { //Cancelled or failed. The existing output stays unchanged.
+		std::remove(temporary_filename.c_str());
+		throw;
+	}
+	if(std::rename(temporary_filename.c_str(), filename.c_str()) != 0) {
+		const std::string error = std::strerror(errno);
+		std::remove(temporary_filename.c_str());
+		throw std::runtime_error("Could not replace " + filename + ": " + error);
+	}
+}
 
+void ThreeMF::write_to_file(std::FILE* file, const std::string& filename) const {
+	int error = 0; //The first error that occurred while writing, for instance because the disk is full.
+	try {
+		ZipWriter archive([file, &error](const char* data, const size_t size) {
+			if(error == 0 && std::fwrite(data, 1, size, file) != size) {
+				error = errno;
+			}
+		});
+		write_archive(archive);
+	} catch(...) {
+		std::fclose(file);
+		throw;
+	}
+	if(error == 0 && (std::fflush(file) != 0 || fsync(fileno(file)) != 0) && errno != EINVAL) { //Pipes and devices can't be synced, which is fine.
+		error = errno;
+	}
+	if(std::fclose(file) != 0 && error == 0) {
+		error = errno;
+	}
+	if(error != 0) {
+		throw std::runtime_error("Could not write " + filename + ": " + std::strerror(error));
+	}
+}
+
+void ThreeMF::write(const std::function<void(const char*, size_t)>& output) const {
+	//The archive is passed on to the output while it's being generated.
+	ZipWriter archive(output);
+	write_archive(archive);
+}
+
+void ThreeMF::write_archive(ZipWriter& archive) const {
+	if(options.monitor) {
+		options.monitor->start_phase(Monitor::Phase::WRITE);
+	}
 	//Writing [Content_Types].xml.
-	std::string content_types_data(u8"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	archive.add_file(u8"[Content_Types].xml", u8"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
 		u8"<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
 			u8"<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\" />"
 			u8"<Default Extension=\"model\" ContentType=\"application/vnd.ms-package.3dmanufacturing-3dmodel+xml\" />"
 		u8"</Types>");
-	constexpr int no_free_after_use = false;
-	zip_source_t* content_types = zip_source_buffer(archive, content_types_data.c_str(), content_types_data.length(), no_free_after_use);
-	zip_file_add(archive, u8"[Content_Types].xml", content_types, ZIP_FL_ENC_UTF_8);
 
 	//Writing rels.
-	zip_dir_add(archive, u8"_rels", ZIP_FL_ENC_UTF_8);
-	std::string rels_data(u8"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+	archive.add_directory(u8"_rels");
+	archive.add_file(u8"_rels/.rels", u8"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
 	u8"<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
 		u8"<Relationship Target=\"/3D/3dmodel.model\" Id=\"rel_3dmodel\" Type=\"http://schemas.microsoft.com/3dmanufacturing/2013/01/3dmodel\" />"
 	u8"</Relationships>");
-	zip_source_t* rels = zip_source_buffer(archive, rels_data.c_str(), rels_data.length(), no_free_after_use);
-	zip_file_add(archive, u8"_rels/.rels", rels, ZIP_FL_ENC_UTF_8);
 
 	//Writing the 3D model.
-	zip_dir_add(archive, u8"3D", ZIP_FL_ENC_UTF_8);
-	std::stringstream model_data;
-	write_model_data(model_data);
-	std::string model_data_str = model_data.str(); //Make sure that this string keeps in memory until the archive closes!
-	zip_source_t* model = zip_source_buffer(archive, model_data_str.c_str(), model_data_str.length(), no_free_after_use);
-	zip_file_add(archive, u8"3D/3dmodel.model", model, ZIP_FL_ENC_UTF_8);
+	archive.add_directory(u8"3D");
+	if(options.split_parts) {
+		//Divide the meshes into parts of limited size.
+		std::vector<std::vector<std::string>> mesh_part_paths(vertices.size());
+		std::vector<std::array<size_t, 3>> parts; //For each part, the mesh index and the range of triangles in it.
+		std::vector<std::string> part_paths; //The paths of all parts within the archive.
+		for(size_t mesh_index = 0; mesh_index < vertices.size(); ++mesh_index) {
+			const size_t num_triangles = triangles[mesh_index].size();
+			const size_t part_size = (options.part_max_triangles == 0) ? num_triangles : options.part_max_triangles;
+			size_t triangles_begin = 0;
+			do { //Always create at least one part, even if the mesh is empty, so that every object has at least one component.
+				const size_t triangles_end = std::min(num_triangles, triangles_begin + part_size);
+				parts.push_back({mesh_index, triangles_begin, triangles_end});
+				part_paths.push_back(u8"/3D/Objects/part_" + std::to_string(parts.size()) + u8".model");
+				mesh_part_paths[mesh_index].push_back(part_paths.back());
+				triangles_begin = triangles_end;
+			} while(triangles_begin < num_triangles);
+		}
+
+		//Write the parts in bounded windows, so that only a few of them are in memory at once.
+		archive.add_directory(u8"3D/Objects");
+		const auto part_size = [this, &parts](const size_t part_index) { //Estimate how many bytes a part will be, since parts only contain the vertices they use.
+			const size_t mesh_index = parts[part_index][0];
+			const size_t num_triangles = parts[part_index][2] - parts[part_index][1];
+			const size_t num_vertices = (num_triangles == triangles[mesh_index].size()) ? vertices[mesh_index].size() : std::min(vertices[mesh_index].size(), num_triangles * 3);
+			return estimate_mesh_size(num_vertices, num_triangles, options.precision);
+		};
+		const size_t max_small_part_size = estimate_mesh_size(chunk_size, chunk_size, options.precision); //Parts up to about the size of one chunk are serialised whole.
+		size_t part_index = 0;
+		while(part_index < parts.size()) {
+			if(part_size(part_index) > max_small_part_size) { //Generate this part in chunks while writing it, like the 3D model without parts.
+				archive.add_file(part_paths[part_index].substr(1), part_chunks(parts[part_index][0], parts[part_index][1], parts[part_index][2])); //Without the leading slash.
+				++part_index;
+				continue;
+			}
+
+			//Serialise the next few small parts, one on each thread. Then write those in order, while freeing their memory.
+			size_t window_end = part_index + 1;
+			while(window_end < parts.size() && window_end - part_index < num_worker_threads() && part_size(window_end) <= max_small_part_size) {
+				++window_end;
+			}
+			std::vector<std::string> window(window_end - part_index);
+			parallel_for(window.size(), [this, &parts, &window, part_index](const size_t window_position) {
+				const std::array<size_t, 3>& part = parts[part_index + window_position];
+				Trace::Span span("serialise");
+				std::stringstream part_data;
+				for(const ZipWriter::Chunk& chunk : part_chunks(part[0], part[1], part[2])) {
+					chunk(part_data);
+				}
+				window[window_position] = part_data.str();
+				span.set_bytes(window[window_position].size());
+				span.set_items(part[2] - part[1]);
+			});
+			for(std::string& part_data : window) {
+				archive.add_file(part_paths[part_index].substr(1), part_data); //Without the leading slash.
+				std::string().swap(part_data);
+				++part_index;
+			}
+		}
 
-	zip_close(archive);
+		//The root model needs a relationship to each of the parts.
+		archive.add_directory(u8"3D/_rels");
+		std::stringstream model_rels_data;
+		model_rels_data << u8"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+			u8"<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">";
+		for(size_t part_index = 0; part_index < parts.size(); ++part_index) {
+			model_rels_data << u8"<Relationship Target=\"" << part_paths[part_index] << u8"\" Id=\"rel_part_" << (part_index + 1) << u8"\" Type=\"http://schemas.microsoft.com/3dmanufacturing/2013/01/3dmodel\" />";
+		}
+		model_rels_data << u8"</Relationships>";
+		archive.add_file(u8"3D/_rels/3dmodel.model.rels", model_rels_data.str());
+
+		std::stringstream model_data;
+		write_root_model_data(model_data, mesh_part_paths);
+		archive.add_file(u8"3D/3dmodel.model", model_data.str());
+	} else { //Generate the 3D model while writing it, so that it doesn't need to be in memory all at once.
+		archive.add_file(u8"3D/3dmodel.model", model_chunks());
+	}
+	archive.close();
 }
 
-void ThreeMF::write_model_data(std::stringstream& model_data) const {
-	model_data << u8"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
-		u8"<model unit=\"millimeter\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\">"
-		u8"<resources>";
+std::vector<ZipWriter::Chunk> ThreeMF::model_chunks() const {
+	std::vector<ZipWriter::Chunk> chunks;
+	chunks.push_back([](std::ostream& model_data) {
+		model_data << u8"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+			u8"<model unit=\"millimeter\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\">"
+			u8"<resources>";
+	});
 
-	//Write the meshes.
+	//Write the meshes, in chunks of limited numbers of vertices and triangles.
 	for(size_t mesh_index = 0; mesh_index < vertices.size(); ++mesh_index) {
-		model_data << u8"<object id=\"" << (mesh_index + 1) << u8"\" type=\"model\"><mesh>";
-
-		model_data << u8"<vertices>";
-		for(const Point3& vertex : vertices[mesh_index]) {
-			model_data << u8"<vertex x=\"" << vertex.x << u8"\" y=\"" << vertex.y << u8"\" z=\"" << vertex.z << u8"\"/>";
+		chunks.push_back([this, mesh_index](std::ostream& model_data) {
+			model_data << u8"<object id=\"" << (mesh_index + 1) << u8"\" type=\"model\"";
+			write_name_attribute(model_data, mesh_index);
+			model_data << u8"><mesh><vertices>";
+		});
+		for(size_t vertices_begin = 0; vertices_begin < vertices[mesh_index].size(); vertices_begin += chunk_size) {
+			const size_t vertices_end = std::min(vertices[mesh_index].size(), vertices_begin + chunk_size);
+			chunks.push_back(monitored([this, mesh_index, vertices_begin, vertices_end](std::ostream& model_data) {
+				write_vertices(model_data, mesh_index, vertices_begin, vertices_end);
+			}, 0));
+		}
+		chunks.push_back([](std::ostream& model_data) {
+			model_data << u8"</vertices><triangles>";
+		});
+		for(size_t triangles_begin = 0; triangles_begin < triangles[mesh_index].size(); triangles_begin += chunk_size) {
+			const size_t triangles_end = std::min(triangles[mesh_index].size(), triangles_begin + chunk_size);
+			chunks.push_back(monitored([this, mesh_index, triangles_begin, triangles_end](std::ostream& model_data) {
+				write_triangles(model_data, triangles[mesh_index], triangles_begin, triangles_end);
+			}, triangles_end - triangles_begin));
+		}
+		for(const Mesh::TriangleBatch& batch : triangle_batches[mesh_index]) { //Triangles that are only produced now.
+			chunks.push_back(monitored([this, &batch](std::ostream& model_data) {
+				std::vector<std::array<size_t, 3>> batch_triangles;
+				batch(batch_triangles);
+				write_triangles(model_data, batch_triangles, 0, batch_triangles.size());
+				if(options.monitor) { //Only known now how many triangles there are.
+					options.monitor->advance(0, batch_triangles.size());
+				}
+			}, 0));
 		}
-		model_data << u8"</vertices>";
+		chunks.push_back([](std::ostream& model_data) {
+			model_data << u8"</triangles></mesh></object>";
+		});
+	}
 
-		model_data << u8"<triangles>";
-		for(const std::array<size_t, 3>& triangle : triangles[mesh_index]) {
-			model_data << u8"<triangle v1=\"" << triangle[0] << u8"\" v2=\"" << triangle[1] << u8"\" v3=\"" << triangle[2] << u8"\"/>";
+	//Write the scene.
+	chunks.push_back([this](std::ostream& model_data) {
+		model_data << u8"</resources>";
+		model_data << u8"<build>";
+		for(const BuildItem& item : items) {
+			model_data << u8"<item";
+			write_item_attributes(model_data, item);
+			model_data << u8"/>";
 		}
-		model_data << u8"</triangles>";
+		model_data << u8"</build>";
+		model_data << u8"</model>";
+	});
+	return chunks;
+}
+
+ZipWriter::Chunk ThreeMF::monitored(ZipWriter::Chunk&& chunk, const size_t num_triangles) const {
+	if(!options.monitor) {
+		return std::move(chunk);
+	}
+	const std::shared_ptr<Monitor> monitor = options.monitor;
+	return [chunk, monitor, num_triangles](std::ostream& model_data) {
+		const std::streampos start = model_data.tellp();
+		chunk(model_data);
+		monitor->advance(model_data.tellp() - start, num_triangles);
+	};
+}
+
+size_t ThreeMF::estimate_mesh_size(const size_t num_vertices, const size_t num_triangles, const size_t precision) {
+	//With the default precision, coordinates are at most 13 characters and indices at most 20, but most are much shorter.
+	const size_t vertex_size = 26 + 3 * std::max(size_t(10), precision + 4); //<vertex x="" y="" z=""/>
+	constexpr size_t triangle_size = 29 + 3 * 8; //<triangle v1="" v2="" v3=""/>
+	constexpr size_t object_size = 256; //The object, mesh, vertices and triangles elements.
+	return object_size + num_vertices * vertex_size + num_triangles * triangle_size;
+}
+
+void ThreeMF::write_root_model_data(std::stringstream& model_data, const std::vector<std::vector<std::string>>& part_paths) const {
+	model_data << u8"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+		u8"<model unit=\"millimeter\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\" xmlns:p=\"http://schemas.microsoft.com/3dmanufacturing/production/2015/06\" requiredextensions=\"p\">"
+		u8"<resources>";
 
-		model_data << u8"</mesh></object>";
+	//Write an object for each mesh, consisting of the parts in other files.
+	for(size_t mesh_index = 0; mesh_index < part_paths.size(); ++mesh_index) {
+		model_data << u8"<object id=\"" << (mesh_index + 1) << u8"\" type=\"model\"";
+		write_name_attribute(model_data, mesh_index);
+		model_data << u8" p:UUID=\"" << generate_uuid() << u8"\"><components>";
+		for(const std::string& part_path : part_paths[mesh_index]) {
+			model_data << u8"<component objectid=\"1\" p:path=\"" << part_path << u8"\" p:UUID=\"" << generate_uuid() << u8"\"/>"; //Each part contains just one object, with ID 1.
+		}
+		model_data << u8"</components></object>";
 	}
 
 	model_data << u8"</resources>";
 
 	//Write the scene.
-	model_data << u8"<build>";
-	for(size_t mesh_index = 0; mesh_index < vertices.size(); ++mesh_index) {
-		model_data << u8"<item objectid=\"" << (mesh_index + 1) << u8"\"/>";
+	model_data << u8"<build p:UUID=\"" << generate_uuid() << u8"\">";
+	for(const BuildItem& item : items) {
+		model_data << u8"<item";
+		write_item_attributes(model_data, item);
+		model_data << u8" p:UUID=\"" << generate_uuid() << u8"\"/>";
 	}
 	model_data << u8"</build>";
 
 	model_data << u8"</model>";
 }
 
+std::vector<ZipWriter::Chunk> ThreeMF::part_chunks(const size_t mesh_index, const size_t triangles_begin, const size_t triangles_end) const {
+	const std::vector<Point3>& mesh_vertices = vertices[mesh_index];
+	const std::vector<std::array<size_t, 3>>& mesh_triangles = triangles[mesh_index];
+	const bool whole_mesh = triangles_begin == 0 && triangles_end == mesh_triangles.size();
+
+	//If only writing part of the mesh, find which vertices are used and what their new indices are. The chunks share these.
+	const std::shared_ptr<std::unordered_map<size_t, size_t>> index_to_part_index = std::make_shared<std::unordered_map<size_t, size_t>>();
+	const std::shared_ptr<std::vector<size_t>> part_vertices = std::make_shared<std::vector<size_t>>(); //Indices of the vertices in the mesh that are used by this part.
+	if(!whole_mesh) {
+		index_to_part_index->reserve((triangles_end - triangles_begin) * 3);
+		for(size_t triangle_index = triangles_begin; triangle_index < triangles_end; ++triangle_index) {
+			for(const size_t vertex_index : mesh_triangles[triangle_index]) {
+				if(index_to_part_index->emplace(vertex_index, part_vertices->size()).second) { //Not yet in this part.
+					part_vertices->push_back(vertex_index);
+				}
+			}
+		}
+	}
+	const size_t num_vertices = whole_mesh ? mesh_vertices.size() : part_vertices->size();
+
+	std::vector<ZipWriter::Chunk> chunks;
+	chunks.push_back([](std::ostream& model_data) {
+		model_data << u8"<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+			u8"<model unit=\"millimeter\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\" xmlns:p=\"http://schemas.microsoft.com/3dmanufacturing/production/2015/06\" requiredextensions=\"p\">"
+			u8"<resources>";
+		model_data << u8"<object id=\"1\" type=\"model\" p:UUID=\"" << generate_uuid() << u8"\">";
+		model_data << u8"<mesh><vertices>";
+	});
+	for(size_t vertices_begin = 0; vertices_begin < num_vertices; vertices_begin += chunk_size) {
+		const size_t vertices_end = std::min(num_vertices, vertices_begin + chunk_size);
+		chunks.push_back(monitored([this, mesh_index, whole_mesh, part_vertices, vertices_begin, vertices_end](std::ostream& model_data) {
+			if(whole_mesh) {
+				write_vertices(model_data, mesh_index, vertices_begin, vertices_end);
+				return;
+			}
+			model_data.precision(options.precision);
+			for(size_t part_vertex_index = vertices_begin; part_vertex_index < vertices_end; ++part_vertex_index) {
+				write_vertex(model_data, vertices[mesh_index][(*part_vertices)[part_vertex_index]]);
+			}
+		}, 0));
+	}
+	chunks.push_back([](std::ostream& model_data) {
+		model_data << u8"</vertices><triangles>";
+	});
+	for(size_t chunk_begin = triangles_begin; chunk_begin < triangles_end; chunk_begin += chunk_size) {
+		const size_t chunk_end = std::min(triangles_end, chunk_begin + chunk_size);
+		chunks.push_back(monitored([this, mesh_index, whole_mesh, index_to_part_index, chunk_begin, chunk_end](std::ostream& model_data) {
+			if(whole_mesh) {
+				write_triangles(model_data, triangles[mesh_index], chunk_begin, chunk_end);
+				return;
+			}
+			for(size_t triangle_index = chunk_begin; triangle_index < chunk_end; ++triangle_index) {
+				std::array<size_t, 3> triangle = triangles[mesh_index][triangle_index];
+				for(size_t& vertex_index : triangle) {
+					vertex_index = index_to_part_index->at(vertex_index);
+				}
+				model_data << u8"<triangle v1=\"" << triangle[0] << u8"\" v2=\"" << triangle[1] << u8"\" v3=\"" << triangle[2] << u8"\"/>";
+			}
+		}, chunk_end - chunk_begin));
+	}
+	chunks.push_back([](std::ostream& model_data) {
+		model_data << u8"</triangles></mesh>";
+		model_data << u8"</object>";
+		model_data << u8"</resources>";
+		model_data << u8"<build/>"; //Parts are only built through the components of the root model.
+		model_data << u8"</model>";
+	});
+	return chunks;
+}
+
+void ThreeMF::write_vertices(std::ostream& model_data, const size_t mesh_index, const size_t vertices_begin, const size_t vertices_end) const {
+	const std::vector<Point3>& mesh_vertices = vertices[mesh_index];
+	model_data.precision(options.precision);
+	for(size_t vertex_index = vertices_begin; vertex_index < vertices_end; ++vertex_index) {
+		write_vertex(model_data, mesh_vertices[vertex_index]);
+	}
+}
+
+void ThreeMF::write_vertex(std::ostream& model_data, const Point3& vertex) const {
+	if(options.quantize <= 0) {
+		model_data << u8"<vertex x=\"" << vertex.x << u8"\" y=\"" << vertex.y << u8"\" z=\"" << vertex.z << u8"\"/>";
+		return;
+	}
+	//The snapped coordinates are whole multiples of a power of ten, so they can be formatted exactly as integers, which is also much faster.
+	const double scale = std::pow(10.0, quantize_decimals);
+	char buffer[128];
+	size_t length = 0;
+	auto append = [&buffer, &length](const char* text, const size_t text_length) {
+		memcpy(buffer + length, text, text_length);
+		length += text_length;
+	};
+	constexpr char start[] = u8"<vertex x=\"";
+	constexpr char y[] = u8"\" y=\"";
+	constexpr char z[] = u8"\" z=\"";
+	constexpr char end[] = u8"\"/>";
+	append(start, sizeof(start) - 1); //Without the null terminator.
+	length += format_fixed(buffer + length, std::llround(vertex.x * scale), quantize_decimals);
+	append(y, sizeof(y) - 1);
+	length += format_fixed(buffer + length, std::llround(vertex.y * scale), quantize_decimals);
+	append(z, sizeof(z) - 1);
+	length += format_fixed(buffer + length, std::llround(vertex.z * scale), quantize_decimals);
+	append(end, sizeof(end) - 1);
+	model_data.write(buffer, length);
+}
+
+size_t ThreeMF::format_fixed(char* buffer, long long value, const size_t decimals) {
+	//Drop the trailing zeroes first, so they don't need to be written.
+	size_t num_decimals = decimals;
+	while(num_decimals > 0 && value % 10 == 0) {
+		value /= 10;
+		num_decimals--;
+	}
+	const bool negative = value < 0;
+	unsigned long long magnitude = negative ? -static_cast<unsigned long long>(value) : value;
+
+	//Collect the digits from the end, including at least one digit before the decimal point.
+	char digits[32];
+	size_t num_digits = 0;
+	do {
+		digits[num_digits++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while(magnitude > 0 || num_digits <= num_decimals);
+
+	size_t length = 0;
+	if(negative) {
+		buffer[length++] = '-';
+	}
+	while(num_digits > 0) {
+		buffer[length++] = digits[--num_digits];
+		if(num_digits == num_decimals && num_decimals > 0) {
+			buffer[length++] = '.';
+		}
+	}
+	return length;
+}
+
+void ThreeMF::write_triangles(std::ostream& model_data, const std::vector<std::array<size_t, 3>>& triangles, const size_t triangles_begin, const size_t triangles_end) {
+	for(size_t triangle_index = triangles_begin; triangle_index < triangles_end; ++triangle_index) {
+		const std::array<size_t, 3>& triangle = triangles[triangle_index];
+		model_data << u8"<triangle v1=\"" << triangle[0] << u8"\" v2=\"" << triangle[1] << u8"\" v3=\"" << triangle[2] << u8"\"/>";
+	}
+}
+
+void ThreeMF::write_item_attributes(std::ostream& model_data, const BuildItem& item) {
+	model_data << u8" objectid=\"" << (item.mesh_index + 1) << u8"\"";
+	if(item.translation.x != 0 || item.translation.y != 0 || item.translation.z != 0) {
+		//Write the translation exactly, so that the instances end up precisely where the copies were, regardless of the precision of the vertices.
+		const std::streamsize precision = model_data.precision(std::numeric_limits<coord_t>::max_digits10);
+		model_data << u8" transform=\"1 0 0 0 1 0 0 0 1 " << item.translation.x << u8" " << item.translation.y << u8" " << item.translation.z << u8"\"";
+		model_data.precision(precision);
+	}
+}
+
+void ThreeMF::write_name_attribute(std::ostream& model_data, const size_t mesh_index) const {
+	const std::string& name = names[mesh_index];
+	if(name.empty()) {
+		return;
+	}
+	model_data << u8" name=\"";
+	for(const char character : name) { //Escape the characters that have a meaning in XML attributes.
+		switch(character) {
+			case '&': model_data << u8"&amp;"; break;
+			case '<': model_data << u8"&lt;"; break;
+			case '>': model_data << u8"&gt;"; break;
+			case '"': model_data << u8"&quot;"; break;
+			default: model_data << character; break;
+		}
+	}
+	model_data << u8"\"";
+}
+
+std::string ThreeMF::generate_uuid() {
+	static std::mutex generator_mutex; //Parts are serialised from multiple threads, but they share the generator.
+	static std::mt19937_64 generator(std::random_device{}());
+	uint64_t high;
+	uint64_t low;
+	{
+		std::lock_guard<std::mutex> lock(generator_mutex);
+		high = generator();
+		low = generator();
+	}
+	high = (high & 0xFFFFFFFFFFFF0FFFull) | 0x0000000000004000ull; //Version 4: Randomly generated.
+	low = (low & 0x3FFFFFFFFFFFFFFFull) | 0x8000000000000000ull; //Variant 1: RFC 4122.
+
+	std::stringstream uuid;
+	uuid << std::hex << std::setfill('0')
+		<< std::setw(8) << (high >> 32) << '-'
+		<< std::setw(4) << ((high >> 16) & 0xFFFF) << '-'
+		<< std::setw(4) << (high & 0xFFFF) << '-'
+		<< std::setw(4) << (low >> 48) << '-'
+		<< std::setw(12) << (low & 0xFFFFFFFFFFFFull);
+	return uuid.str();
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //To find the spans of a thread that ends.
+#include <fstream> //To write the trace to a file.
+
+#include "trace.hpp" //The definitions for this file.
+
+namespace convertto3mf {
+
+std::atomic<bool> Trace::recording(false);
+std::atomic<std::chrono::steady_clock::rep> Trace::recording_start(0);
+std::mutex Trace::threads_mutex;
+std::vector<Trace::ThreadEvents*> Trace::threads;
+std::map<size_t, std::vector<Trace::Event>> Trace::ended_threads;
+std::set<size_t> Trace::free_thread_ids;
+
+Trace::Span::Span(const char* name) :
+		name(name),
+		enabled(recording.load(std::memory_order_relaxed)),
+		bytes(0),
+		items(0) {
+	if(enabled) {
+		start = std::chrono::steady_clock::now();
+	}
+}
+
+Trace::Span::~Span() {
+	if(enabled && recording.load(std::memory_order_relaxed)) { //Don't record spans that end after the trace was written.
+		record(name, start, std::chrono::steady_clock::now(), bytes, items);
+	}
+}
+
+void Trace::Span::set_bytes(const size_t bytes) {
+	this->bytes = bytes;
+}
+
+void Trace::Span::set_items(const size_t items) {
+	this->items = items;
+}
+
+void Trace::start() {
+	std::lock_guard<std::mutex> lock(threads_mutex);
+	for(ThreadEvents* events : threads) {
+		std::lock_guard<std::mutex> events_lock(events->mutex);
+		events->events.clear();
+	}
+	ended_threads.clear();
+	recording_start = std::chrono::steady_clock::now().time_since_epoch().count();
+	recording = true;
+}
+
+void Trace::write(const std::string& filename) {
+	recording = false;
+	std::lock_guard<std::mutex> lock(threads_mutex);
+	std::ofstream file(filename);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	const auto write_events = [&file, &first](const size_t thread_id, const std::vector<Event>& events) {
+		for(const Event& event : events) {
+			if(!first) {
+				file << ",";
+			}
+			first = false;
+			file << "\n{\"name\":\"" << event.name << "\",\"cat\":\"convertto3mf\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread_id
+				<< ",\"ts\":" << event.start << ",\"dur\":" << event.duration
+				<< ",\"args\":{\"bytes\":" << event.bytes << ",\"items\":" << event.items << "}}";
+		}
+	};
+	for(ThreadEvents* events : threads) {
+		std::lock_guard<std::mutex> events_lock(events->mutex); //Wait for the thread to finish recording a span.
+		write_events(events->thread_id, events->events);
+		events->events.clear();
+	}
+	for(const std::pair<const size_t, std::vector<Event>>& ended_thread : ended_threads) {
+		write_events(ended_thread.first, ended_thread.second);
+	}
+	ended_threads.clear();
+	file << "\n]}\n";
+}
+
+Trace::ThreadOwner::~ThreadOwner() {
+	if(!events) { //This thread never recorded anything.
+		return;
+	}
+	std::lock_guard<std::mutex> lock(threads_mutex);
+	if(!events->events.empty()) { //Keep the spans until the trace is written.
+		std::vector<Event>& ended_events = ended_threads[events->thread_id];
+		ended_events.insert(ended_events.end(), events->events.begin(), events->events.end());
+	}
+	threads.erase(std::find(threads.begin(), threads.end(), events));
+	free_thread_ids.insert(events->thread_id);
+	delete events;
+	events = nullptr;
+}
+
+Trace::ThreadEvents& Trace::thread_events() {
+	thread_local ThreadOwner owner;
+	if(!owner.events) { //This thread hasn't recorded anything yet.
+		std::lock_guard<std::mutex> lock(threads_mutex);
+		owner.events = new ThreadEvents();
+		if(free_thread_ids.empty()) { //All numbers up to the number of running threads are in use.
+			owner.events->thread_id = threads.size() + 1;
+		} else { //Take the lowest number of a thread that ended.
+			owner.events->thread_id = *free_thread_ids.begin();
+			free_thread_ids.erase(free_thread_ids.begin());
+		}
+		owner.events->events.reserve(64);
+		threads.push_back(owner.events);
+	}
+	return *owner.events;
+}
+
+void Trace::record(const char* name, const std::chrono::steady_clock::time_point start, const std::chrono::steady_clock::time_point end, const size_t bytes, const size_t items) {
+	const std::chrono::steady_clock::time_point origin{std::chrono::steady_clock::duration(recording_start.load())};
+	const int64_t start_us = std::chrono::duration_cast<std::chrono::microseconds>(start - origin).count();
+	const int64_t duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	ThreadEvents& events = thread_events();
+	std::lock_guard<std::mutex> lock(events.mutex); //Only contended while the trace is being written.
+	events.events.push_back({name, start_us, duration_us, bytes, items});
+}
+
+}
\ No newline at end of file
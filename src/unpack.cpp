@@ -0,0 +1,145 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <cstring> //To read floats with memcpy.
+#include <initializer_list> //To try the sets of instructions in order.
+#include <type_traits> //To check that the vector implementations produce the right type of coordinates.
+
+#include "unpack.hpp" //The definitions for this file.
+
+//The vector implementations are only available on x86 processors, with compilers that can target instruction sets per function.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CONVERTTO3MF_X86_VECTORS
+#include <immintrin.h> //For the vector instructions.
+#endif
+
+namespace convertto3mf {
+
+void Unpack::unpack_triangles(const char* records, const size_t stride, const size_t count, coord_t* output) {
+	static const Instructions best = best_supported(); //Only detect the processor features once.
+	unpack_triangles(best, records, stride, count, output);
+}
+
+void Unpack::unpack_triangles(const Instructions instructions, const char* records, const size_t stride, const size_t count, coord_t* output) {
+	switch(instructions) {
+		case Instructions::SSE2: unpack_sse2(records, stride, count, output); break;
+		case Instructions::AVX2: unpack_avx2(records, stride, count, output); break;
+		case Instructions::AVX512: unpack_avx512(records, stride, count, output); break;
+		default: unpack_scalar(records, stride, count, output); break;
+	}
+}
+
+bool Unpack::is_supported(const Instructions instructions) {
+	switch(instructions) {
+		case Instructions::SCALAR: return true;
+#ifdef CONVERTTO3MF_X86_VECTORS
+		case Instructions::SSE2: return __builtin_cpu_supports("sse2");
+		case Instructions::AVX2: return __builtin_cpu_supports("avx2");
+		case Instructions::AVX512: return __builtin_cpu_supports("avx512f");
+#endif
+		default: return false;
+	}
+}
+
+Unpack::Instructions Unpack::best_supported() {
+	for(const Instructions instructions : {Instructions::AVX512, Instructions::AVX2, Instructions::SSE2}) {
+		if(is_supported(instructions)) {
+			return instructions;
+		}
+	}
+	return Instructions::SCALAR;
+}
+
+const char* Unpack::name(const Instructions instructions) {
+	switch(instructions) {
+		case Instructions::SSE2: return "SSE2";
+		case Instructions::AVX2: return "AVX2";
+		case Instructions::AVX512: return "AVX-512";
+		default: return "scalar";
+	}
+}
+
+void Unpack::unpack_scalar(const char* records, const size_t stride, const size_t count, coord_t* output) {
+	for(size_t record_index = 0; record_index < count; ++record_index) {
+		const char* record = records + record_index * stride;
+		float coordinates[9];
+		memcpy(coordinates, record, sizeof(coordinates)); //Assuming that your CPU uses little-endian 32-bit floats, which is pretty much every desktop CPU.
+		for(size_t coordinate = 0; coordinate < 9; ++coordinate) {
+			output[record_index * 9 + coordinate] = coordinates[coordinate];
+		}
+	}
+}
+
+#ifdef CONVERTTO3MF_X86_VECTORS
+
+static_assert(std::is_same<coord_t, double>::value, "The vector implementations widen the coordinates to doubles.");
+
+//For each record, the first eight coordinates are loaded as vectors and widened to doubles. The ninth is converted separately.
+//The vector loads only read the first 32 bytes of the 36 bytes of coordinates, so they never read past the end of a record.
+
+__attribute__((target("sse2")))
+void Unpack::unpack_sse2(const char* records, const size_t stride, const size_t count, coord_t* output) {
+	for(size_t record_index = 0; record_index < count; ++record_index) {
+		const char* record = records + record_index * stride;
+		coord_t* out = output + record_index * 9;
+		const __m128 first = _mm_loadu_ps(reinterpret_cast<const float*>(record));
+		const __m128 second = _mm_loadu_ps(reinterpret_cast<const float*>(record + 16));
+		_mm_storeu_pd(out, _mm_cvtps_pd(first));
+		_mm_storeu_pd(out + 2, _mm_cvtps_pd(_mm_movehl_ps(first, first)));
+		_mm_storeu_pd(out + 4, _mm_cvtps_pd(second));
+		_mm_storeu_pd(out + 6, _mm_cvtps_pd(_mm_movehl_ps(second, second)));
+		float last;
+		memcpy(&last, record + 32, sizeof(last));
+		out[8] = last;
+	}
+}
+
+__attribute__((target("avx2")))
+void Unpack::unpack_avx2(const char* records, const size_t stride, const size_t count, coord_t* output) {
+	for(size_t record_index = 0; record_index < count; ++record_index) {
+		const char* record = records + record_index * stride;
+		coord_t* out = output + record_index * 9;
+		_mm256_storeu_pd(out, _mm256_cvtps_pd(_mm_loadu_ps(reinterpret_cast<const float*>(record))));
+		_mm256_storeu_pd(out + 4, _mm256_cvtps_pd(_mm_loadu_ps(reinterpret_cast<const float*>(record + 16))));
+		float last;
+		memcpy(&last, record + 32, sizeof(last));
+		out[8] = last;
+	}
+}
+
+__attribute__((target("avx512f")))
+void Unpack::unpack_avx512(const char* records, const size_t stride, const size_t count, coord_t* output) {
+	for(size_t record_index = 0; record_index < count; ++record_index) {
+		const char* record = records + record_index * stride;
+		coord_t* out = output + record_index * 9;
+		_mm512_storeu_pd(out, _mm512_cvtps_pd(_mm256_loadu_ps(reinterpret_cast<const float*>(record))));
+		float last;
+		memcpy(&last, record + 32, sizeof(last));
+		out[8] = last;
+	}
+}
+
+#else
+
+//Without vector instructions, these fall back to the scalar implementation. They are never chosen anyway, since they are reported as unsupported.
+
+void Unpack::unpack_sse2(const char* records, const size_t stride, const size_t count, coord_t* output) {
+	unpack_scalar(records, stride, count, output);
+}
+
+void Unpack::unpack_avx2(const char* records, const size_t stride, const size_t count, coord_t* output) {
+	unpack_scalar(records, stride, count, output);
+}
+
+void Unpack::unpack_avx512(const char* records, const size_t stride, const size_t count, coord_t* output) {
+	unpack_scalar(records, stride, count, output);
+}
+
+#endif
+
+}
\ No newline at end of file
@@ -0,0 +1,191 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //To sort the edges.
+
+#include "parallel.hpp" //To collect and sort the edges in parallel.
+#include "trace.hpp" //To measure how long validation takes.
+#include "validation.hpp" //The definitions for this file.
+
+namespace convertto3mf {
+
+constexpr size_t Validation::max_samples;
+
+Validation Validation::validate(const std::vector<Point3>& vertices, const std::vector<std::array<size_t, 3>>& triangles, const size_t mesh_index) {
+	Trace::Span span("validate");
+	span.set_items(triangles.size());
+	Validation result;
+	result.num_triangles = triangles.size();
+	if(triangles.empty()) {
+		return result;
+	}
+
+	//Divide the triangles into ranges, which are processed in parallel. Small meshes get only one range, so they don't start any threads.
+	constexpr size_t min_range_size = 16384;
+	const size_t num_ranges = std::max(size_t(1), std::min(num_worker_threads() * 4, triangles.size() / min_range_size));
+	const size_t num_buckets = num_ranges;
+	auto range_start = [&triangles, num_ranges](const size_t range) {
+		return triangles.size() * range / num_ranges;
+	};
+	auto bucket = [&vertices, num_buckets](const size_t vertex) { //Edges are divided over buckets by their lowest vertex, so that equal edges end up in the same bucket.
+		return vertex * num_buckets / vertices.size();
+	};
+
+	//Find the degenerate triangles, and count how many edges each range puts in each bucket.
+	std::vector<Validation> range_results(num_ranges);
+	std::vector<std::vector<size_t>> bucket_offsets(num_ranges, std::vector<size_t>(num_buckets, 0));
+	parallel_for(num_ranges, [&](const size_t range) {
+		for(size_t triangle_index = range_start(range); triangle_index < range_start(range + 1); ++triangle_index) {
+			const std::array<size_t, 3>& triangle = triangles[triangle_index];
+			const bool repeats_vertex = triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0];
+			if(repeats_vertex || is_degenerate(vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]])) {
+				range_results[range].degenerate_triangles++;
+				add_sample(range_results[range].degenerate_samples, {mesh_index, vertices[triangle[0]]});
+			}
+			if(repeats_vertex) { //Its edges don't connect anything.
+				continue;
+			}
+			for(size_t corner = 0; corner < 3; ++corner) {
+				bucket_offsets[range][bucket(std::min(triangle[corner], triangle[(corner + 1) % 3]))]++;
+			}
+		}
+	});
+
+	//Turn the counts into the positions where each range writes its edges: Grouped by bucket, then by range.
+	std::vector<size_t> bucket_starts(num_buckets + 1, 0);
+	size_t position = 0;
+	for(size_t bucket_index = 0; bucket_index < num_buckets; ++bucket_index) {
+		bucket_starts[bucket_index] = position;
+		for(size_t range = 0; range < num_ranges; ++range) {
+			const size_t count = bucket_offsets[range][bucket_index];
+			bucket_offsets[range][bucket_index] = position;
+			position += count;
+		}
+	}
+	bucket_starts[num_buckets] = position;
+
+	//Collect the edges in their buckets.
+	std::vector<Edge> edges(position);
+	parallel_for(num_ranges, [&](const size_t range) {
+		std::vector<size_t>& offsets = bucket_offsets[range];
+		for(size_t triangle_index = range_start(range); triangle_index < range_start(range + 1); ++triangle_index) {
+			const std::array<size_t, 3>& triangle = triangles[triangle_index];
+			if(triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0]) {
+				continue;
+			}
+			for(size_t corner = 0; corner < 3; ++corner) {
+				const size_t from = triangle[corner];
+				const size_t to = triangle[(corner + 1) % 3];
+				const Edge edge = {std::min(from, to), (std::max(from, to) << 1) | (from > to ? 1 : 0)};
+				edges[offsets[bucket(edge.low)]++] = edge;
+			}
+		}
+	});
+
+	//Sort each bucket, so that the triangles sharing an edge are next to each other. Then see how many triangles share each edge, and in which directions.
+	std::vector<Validation> bucket_results(num_buckets);
+	parallel_for(num_buckets, [&](const size_t bucket_index) {
+		Validation& bucket_result = bucket_results[bucket_index];
+		const std::vector<Edge>::iterator bucket_end = edges.begin() + bucket_starts[bucket_index + 1];
+		std::sort(edges.begin() + bucket_starts[bucket_index], bucket_end);
+		for(std::vector<Edge>::iterator run_start = edges.begin() + bucket_starts[bucket_index]; run_start != bucket_end;) {
+			std::vector<Edge>::iterator run_end = run_start;
+			size_t num_reversed = 0;
+			while(run_end != bucket_end && run_end->low == run_start->low && (run_end->high_reversed >> 1) == (run_start->high_reversed >> 1)) {
+				num_reversed += run_end->high_reversed & 1;
+				++run_end;
+			}
+			const size_t count = run_end - run_start;
+			const Point3& low = vertices[run_start->low];
+			const Point3& high = vertices[run_start->high_reversed >> 1];
+			const Problem problem = {mesh_index, Point3((low.x + high.x) / 2, (low.y + high.y) / 2, (low.z + high.z) / 2)};
+			if(count == 1) {
+				bucket_result.boundary_edges++;
+				add_sample(bucket_result.boundary_samples, problem);
+			} else if(count > 2) {
+				bucket_result.non_manifold_edges++;
+				add_sample(bucket_result.non_manifold_samples, problem);
+			} else if(num_reversed != 1) { //Both triangles go the same way along the edge.
+				bucket_result.flipped_edges++;
+				add_sample(bucket_result.flipped_samples, problem);
+			}
+			run_start = run_end;
+		}
+	});
+
+	for(const Validation& range_result : range_results) {
+		result.include(range_result);
+	}
+	for(const Validation& bucket_result : bucket_results) {
+		result.include(bucket_result);
+	}
+	return result;
+}
+
+void Validation::include(const Validation& other) {
+	num_triangles += other.num_triangles;
+	degenerate_triangles += other.degenerate_triangles;
+	non_manifold_edges += other.non_manifold_edges;
+	flipped_edges += other.flipped_edges;
+	boundary_edges += other.boundary_edges;
+	for(const Problem& problem : other.degenerate_samples) {
+		add_sample(degenerate_samples, problem);
+	}
+	for(const Problem& problem : other.non_manifold_samples) {
+		add_sample(non_manifold_samples, problem);
+	}
+	for(const Problem& problem : other.flipped_samples) {
+		add_sample(flipped_samples, problem);
+	}
+	for(const Problem& problem : other.boundary_samples) {
+		add_sample(boundary_samples, problem);
+	}
+}
+
+bool Validation::is_valid() const {
+	return degenerate_triangles == 0 && non_manifold_edges == 0 && flipped_edges == 0 && boundary_edges == 0;
+}
+
+void Validation::write_report(std::ostream& report) const {
+	report << "Validated " << num_triangles << " triangles: " << degenerate_triangles << " degenerate triangles, " << non_manifold_edges << " non-manifold edges, " << flipped_edges << " edges between flipped triangles, " << boundary_edges << " edges around holes." << std::endl;
+	auto write_samples = [&report](const char* description, const std::vector<Problem>& samples) {
+		for(const Problem& problem : samples) {
+			report << "  " << description << " in object " << (problem.mesh_index + 1) << " at (" << problem.location.x << ", " << problem.location.y << ", " << problem.location.z << ")." << std::endl;
+		}
+	};
+	write_samples("Degenerate triangle", degenerate_samples);
+	write_samples("Non-manifold edge", non_manifold_samples);
+	write_samples("Edge between flipped triangles", flipped_samples);
+	write_samples("Edge around a hole", boundary_samples);
+}
+
+bool Validation::Edge::operator <(const Edge& other) const {
+	return low < other.low || (low == other.low && high_reversed < other.high_reversed);
+}
+
+void Validation::add_sample(std::vector<Problem>& samples, const Problem& problem) {
+	if(samples.size() < max_samples) {
+		samples.push_back(problem);
+	}
+}
+
+bool Validation::is_degenerate(const Point3& a, const Point3& b, const Point3& c) {
+	//The cross product of two sides is as long as twice the area. Compare it to the longest side, to allow for rounding errors relative to the size of the triangle.
+	const coord_t ab_x = b.x - a.x, ab_y = b.y - a.y, ab_z = b.z - a.z;
+	const coord_t ac_x = c.x - a.x, ac_y = c.y - a.y, ac_z = c.z - a.z;
+	const coord_t bc_x = c.x - b.x, bc_y = c.y - b.y, bc_z = c.z - b.z;
+	const coord_t cross_x = ab_y * ac_z - ab_z * ac_y;
+	const coord_t cross_y = ab_z * ac_x - ab_x * ac_z;
+	const coord_t cross_z = ab_x * ac_y - ab_y * ac_x;
+	const coord_t cross_squared = cross_x * cross_x + cross_y * cross_y + cross_z * cross_z;
+	const coord_t longest_squared = std::max({ab_x * ab_x + ab_y * ab_y + ab_z * ab_z, ac_x * ac_x + ac_y * ac_y + ac_z * ac_z, bc_x * bc_x + bc_y * bc_y + bc_z * bc_z});
+	constexpr coord_t tolerance = 1e-12; //Relative to the squared size of the triangle, so about 1e-6 of its size.
+	return cross_squared <= tolerance * longest_squared * longest_squared;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,243 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //For std::min.
+#include <cstring> //To compare signatures and file names.
+#include <zlib.h> //To inflate the files and to check their CRC-32.
+
+#include "trace.hpp" //To measure how long reading takes.
+#include "zip_reader.hpp" //The definitions for this file.
+
+namespace convertto3mf {
+
+constexpr size_t ZipReader::piece_size;
+
+ZipReader::ZipReader(const std::string& filename) : file(filename) {
+	valid = read_directory();
+}
+
+bool ZipReader::is_valid() const {
+	return valid;
+}
+
+const std::vector<ZipReader::Entry>& ZipReader::entries() const {
+	return directory;
+}
+
+const ZipReader::Entry* ZipReader::find(const std::string& name) const {
+	for(const Entry& entry : directory) {
+		if(entry.name == name) {
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+bool ZipReader::read(const Entry& entry, const std::function<void(const char*, size_t)>& output) const {
+	if(!valid) {
+		return false;
+	}
+	Trace::Span span("decompress");
+	span.set_bytes(entry.uncompressed_size);
+	const char* data = file.data() + data_offsets[&entry - directory.data()];
+	uLong crc = crc32(0, Z_NULL, 0);
+	uint64_t size = 0;
+	if(entry.method == 0) { //Stored.
+		for(uint64_t start = 0; start < entry.compressed_size; start += piece_size) {
+			const size_t length = std::min(uint64_t(piece_size), entry.compressed_size - start);
+			crc = crc32(crc, reinterpret_cast<const Bytef*>(data + start), length);
+			output(data + start, length);
+		}
+		size = entry.compressed_size;
+	} else if(entry.method == 8) { //Deflated.
+		z_stream stream;
+		stream.zalloc = Z_NULL;
+		stream.zfree = Z_NULL;
+		stream.opaque = Z_NULL;
+		stream.next_in = Z_NULL;
+		stream.avail_in = 0;
+		if(inflateInit2(&stream, -MAX_WBITS) != Z_OK) { //Negative window bits for raw deflate data, without zlib header.
+			return false;
+		}
+		std::vector<char> piece(piece_size);
+		uint64_t consumed = 0; //How much of the compressed data was given to zlib so far.
+		int result = Z_OK;
+		while(result == Z_OK) {
+			if(stream.avail_in == 0 && consumed < entry.compressed_size) { //zlib can only take 4GB at a time.
+				const size_t length = std::min(uint64_t(piece_size), entry.compressed_size - consumed);
+				stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data + consumed));
+				stream.avail_in = length;
+				consumed += length;
+			}
+			stream.next_out = reinterpret_cast<Bytef*>(piece.data());
+			stream.avail_out = piece.size();
+			result = inflate(&stream, Z_NO_FLUSH);
+			const size_t produced = piece.size() - stream.avail_out;
+			if(produced > 0) {
+				crc = crc32(crc, reinterpret_cast<const Bytef*>(piece.data()), produced);
+				size += produced;
+				output(piece.data(), produced);
+			} else if(result == Z_OK && stream.avail_in == 0 && consumed >= entry.compressed_size) { //The compressed data ended before the deflate stream did.
+				result = Z_DATA_ERROR;
+			}
+		}
+		inflateEnd(&stream);
+		if(result != Z_STREAM_END) {
+			return false;
+		}
+	} else { //The ZipWriter doesn't use other compression methods.
+		return false;
+	}
+	return size == entry.uncompressed_size && crc == entry.crc;
+}
+
+bool ZipReader::read(const std::string& name, std::string& contents) const {
+	const Entry* entry = find(name);
+	if(!entry) {
+		return false;
+	}
+	contents.clear();
+	contents.reserve(entry->uncompressed_size);
+	return read(*entry, [&contents](const char* data, const size_t size) {
+		contents.append(data, size);
+	});
+}
+
+bool ZipReader::verify() const {
+	if(!valid) {
+		return false;
+	}
+	for(const Entry& entry : directory) {
+		if(!read(entry, [](const char*, size_t) {})) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ZipReader::read_directory() {
+	const char* data = file.data();
+	const uint64_t size = file.size();
+
+	//The end of central directory record is at the very end, since the ZipWriter writes no comment. Allow a comment anyway.
+	constexpr size_t end_size = 22;
+	if(size < end_size) {
+		return false;
+	}
+	uint64_t end_offset = size - end_size;
+	while(get32(data + end_offset) != 0x06054b50 || end_offset + end_size + get16(data + end_offset + 20) != size) {
+		if(end_offset == 0 || size - end_offset >= end_size + 0xFFFF) { //No room for a longer comment.
+			return false;
+		}
+		end_offset--;
+	}
+	uint64_t num_entries = get16(data + end_offset + 10);
+	uint64_t directory_size = get32(data + end_offset + 12);
+	uint64_t directory_offset = get32(data + end_offset + 16);
+	uint64_t directory_end = end_offset; //The central directory must end before the records that point to it.
+
+	//If any of the fields is full, the real values are in the ZIP64 end of central directory record.
+	if(num_entries == 0xFFFF || directory_size == 0xFFFFFFFF || directory_offset == 0xFFFFFFFF) {
+		constexpr size_t locator_size = 20;
+		constexpr size_t end64_size = 56;
+		if(end_offset < locator_size || get32(data + end_offset - locator_size) != 0x07064b50) {
+			return false;
+		}
+		const uint64_t end64_offset = get64(data + end_offset - locator_size + 8);
+		if(end64_offset > end_offset - locator_size || end_offset - locator_size - end64_offset < end64_size || get32(data + end64_offset) != 0x06064b50) {
+			return false;
+		}
+		num_entries = get64(data + end64_offset + 32);
+		directory_size = get64(data + end64_offset + 40);
+		directory_offset = get64(data + end64_offset + 48);
+		directory_end = end64_offset;
+	}
+	if(directory_offset > directory_end || directory_end - directory_offset != directory_size) {
+		return false;
+	}
+
+	//Read the central directory, and check that each local header agrees with it.
+	constexpr size_t header_size = 46;
+	constexpr size_t local_header_size = 30;
+	uint64_t position = directory_offset;
+	for(uint64_t entry_index = 0; entry_index < num_entries; ++entry_index) {
+		if(directory_end - position < header_size || get32(data + position) != 0x02014b50) {
+			return false;
+		}
+		const char* header = data + position;
+		Entry entry;
+		entry.method = get16(header + 10);
+		entry.crc = get32(header + 16);
+		entry.compressed_size = get32(header + 20);
+		entry.uncompressed_size = get32(header + 24);
+		const size_t name_length = get16(header + 28);
+		const size_t extra_length = get16(header + 30);
+		const size_t comment_length = get16(header + 32);
+		entry.offset = get32(header + 42);
+		if(directory_end - position < header_size + name_length + extra_length + comment_length) {
+			return false;
+		}
+		entry.name.assign(header + header_size, name_length);
+
+		//Sizes and offsets that don't fit in 32 bits are in the ZIP64 extra field, in this order.
+		const char* extra = header + header_size + name_length;
+		for(size_t field = 0; field + 4 <= extra_length;) {
+			const uint16_t field_id = get16(extra + field);
+			const size_t field_length = get16(extra + field + 2);
+			if(field + 4 + field_length > extra_length) {
+				return false;
+			}
+			if(field_id == 0x0001) {
+				size_t value = field + 4;
+				for(uint64_t* target : {&entry.uncompressed_size, &entry.compressed_size, &entry.offset}) {
+					if(*target == 0xFFFFFFFF) {
+						if(value + 8 > field + 4 + field_length) {
+							return false;
+						}
+						*target = get64(extra + value);
+						value += 8;
+					}
+				}
+			}
+			field += 4 + field_length;
+		}
+		position += header_size + name_length + extra_length + comment_length;
+
+		//The local header must be the same file, and its data must fit before the central directory.
+		if(entry.offset > directory_offset || directory_offset - entry.offset < local_header_size) {
+			return false;
+		}
+		const char* local_header = data + entry.offset;
+		const size_t local_name_length = get16(local_header + 26);
+		const size_t local_extra_length = get16(local_header + 28);
+		const uint64_t data_offset = entry.offset + local_header_size + local_name_length + local_extra_length;
+		if(get32(local_header) != 0x04034b50 || get16(local_header + 8) != entry.method || local_name_length != name_length
+				|| data_offset > directory_offset || std::memcmp(local_header + local_header_size, entry.name.data(), name_length) != 0
+				|| directory_offset - data_offset < entry.compressed_size) {
+			return false;
+		}
+		directory.push_back(entry);
+		data_offsets.push_back(data_offset);
+	}
+	return position == directory_end;
+}
+
+uint16_t ZipReader::get16(const char* data) {
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+	return bytes[0] | (bytes[1] << 8);
+}
+
+uint32_t ZipReader::get32(const char* data) {
+	return get16(data) | (uint32_t(get16(data + 2)) << 16);
+}
+
+uint64_t ZipReader::get64(const char* data) {
+	return get32(data) | (uint64_t(get32(data + 4)) << 32);
+}
+
+}
\ No newline at end of file
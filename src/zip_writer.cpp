@@ -0,0 +1,301 @@
+/*
+ * Command line application to convert models to 3MF.
+ * Copyright (C) 2020 Ghostkeeper
+ * This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for details.
+ * You should have received a copy of the GNU Affero General Public License along with this library. If not, see <https://gnu.org/licenses/>.
+ */
+
+#include <algorithm> //For std::min and std::max.
+#include <ctime> //To store the current time as modification time of the files.
+#include <new> //To report that zlib ran out of memory.
+#include <sstream> //To generate chunks into.
+#include <zlib.h> //To deflate the files.
+
+#include "parallel.hpp" //To generate and compress chunks in parallel.
+#include "trace.hpp" //To measure how long compression and writing take.
+#include "zip_writer.hpp" //The definitions for this file.
+
+namespace convertto3mf {
+
+constexpr int ZipWriter::compression_level;
+constexpr size_t ZipWriter::piece_size;
+constexpr uint64_t ZipWriter::max_zip32;
+constexpr uint16_t ZipWriter::utf8_flag;
+constexpr uint16_t ZipWriter::data_descriptor_flag;
+const char ZipWriter::final_block[2] = {0x03, 0x00}; //Final block with fixed Huffman codes, containing only the end-of-block code.
+
+ZipWriter::ZipWriter(const Output& output) : output(output), position(0) {
+	const std::time_t now = std::time(nullptr);
+	const std::tm local = *std::localtime(&now);
+	dos_time = (local.tm_hour << 11) | (local.tm_min << 5) | (local.tm_sec / 2);
+	dos_date = ((std::max(local.tm_year, 80) - 80) << 9) | ((local.tm_mon + 1) << 5) | local.tm_mday; //MS-DOS dates start in 1980.
+}
+
+void ZipWriter::add_directory(const std::string& name) {
+	Entry entry;
+	entry.name = name + "/";
+	entry.method = 0; //Stored, since there is nothing to compress.
+	entry.flags = utf8_flag;
+	entry.version_needed = 20;
+	entry.crc = 0;
+	entry.compressed_size = 0;
+	entry.uncompressed_size = 0;
+	entry.external_attributes = 0x10; //The MS-DOS directory attribute.
+	write_local_header(entry, false);
+	entries.push_back(entry);
+}
+
+void ZipWriter::add_file(const std::string& name, const std::string& data) {
+	//Compress pieces of the file in parallel.
+	const size_t num_pieces = std::max(size_t(1), (data.size() + piece_size - 1) / piece_size);
+	std::vector<Piece> pieces(num_pieces);
+	parallel_for(num_pieces, [&data, &pieces](const size_t piece_index) {
+		Trace::Span span("compress");
+		const size_t start = piece_index * piece_size;
+		const size_t length = std::min(piece_size, data.size() - start);
+		pieces[piece_index] = compress(data.data() + start, length);
+		span.set_bytes(length);
+	});
+
+	//The size and checksum are known now, so they can be written in the local header.
+	Entry entry;
+	entry.name = name;
+	entry.method = 8; //Deflated.
+	entry.flags = utf8_flag;
+	entry.crc = 0;
+	entry.compressed_size = sizeof(final_block);
+	entry.uncompressed_size = data.size();
+	entry.external_attributes = 0;
+	for(const Piece& piece : pieces) {
+		entry.crc = crc32_combine(entry.crc, piece.crc, piece.size);
+		entry.compressed_size += piece.data.size();
+	}
+	const bool zip64 = entry.compressed_size >= max_zip32 || entry.uncompressed_size >= max_zip32;
+	entry.version_needed = zip64 ? 45 : 20;
+	write_local_header(entry, zip64);
+
+	Trace::Span span("output");
+	span.set_bytes(entry.compressed_size);
+	for(Piece& piece : pieces) {
+		write(piece.data.data(), piece.data.size());
+		std::string().swap(piece.data); //Free the memory of this piece as soon as it's been written.
+	}
+	write(final_block, sizeof(final_block));
+	entries.push_back(entry);
+}
+
+void ZipWriter::add_file(const std::string& name, const std::vector<Chunk>& chunks) {
+	//The size and checksum are not known yet. They are written in a data descriptor after the data, with ZIP64 sizes in case they turn out to be large.
+	Entry entry;
+	entry.name = name;
+	entry.method = 8; //Deflated.
+	entry.flags = utf8_flag | data_descriptor_flag;
+	entry.version_needed = 45;
+	entry.crc = 0;
+	entry.compressed_size = 0;
+	entry.uncompressed_size = 0;
+	entry.external_attributes = 0;
+	write_local_header(entry, true);
+
+	//Generate and compress the next few chunks, one for each thread. Then write those in order, while freeing their memory.
+	size_t next_chunk = 0;
+	while(next_chunk < chunks.size()) {
+		const size_t window_size = std::min(num_worker_threads(), chunks.size() - next_chunk);
+		std::vector<Piece> window(window_size);
+		parallel_for(window_size, [&chunks, &window, next_chunk](const size_t window_position) {
+			std::string chunk_data;
+			{
+				Trace::Span span("serialise");
+				std::stringstream chunk_stream;
+				chunks[next_chunk + window_position](chunk_stream);
+				chunk_data = chunk_stream.str();
+				span.set_bytes(chunk_data.size());
+			}
+			Trace::Span span("compress");
+			span.set_bytes(chunk_data.size());
+			window[window_position] = compress(chunk_data.data(), chunk_data.size());
+		});
+		next_chunk += window_size;
+
+		Trace::Span span("output");
+		size_t window_bytes = 0;
+		for(Piece& piece : window) {
+			entry.crc = crc32_combine(entry.crc, piece.crc, piece.size);
+			entry.uncompressed_size += piece.size;
+			entry.compressed_size += piece.data.size();
+			write(piece.data.data(), piece.data.size());
+			window_bytes += piece.data.size();
+			std::string().swap(piece.data);
+		}
+		span.set_bytes(window_bytes);
+	}
+	write(final_block, sizeof(final_block));
+	entry.compressed_size += sizeof(final_block);
+
+	std::string descriptor;
+	put32(descriptor, 0x08074b50); //Signature.
+	put32(descriptor, entry.crc);
+	put64(descriptor, entry.compressed_size);
+	put64(descriptor, entry.uncompressed_size);
+	write(descriptor.data(), descriptor.size());
+	entries.push_back(entry);
+}
+
+void ZipWriter::close() {
+	const uint64_t directory_offset = position;
+	std::string directory;
+	for(const Entry& entry : entries) {
+		//Sizes and offsets that don't fit in 32 bits go in a ZIP64 extra field, in this order.
+		std::string extra;
+		if(entry.uncompressed_size >= max_zip32) {
+			put64(extra, entry.uncompressed_size);
+		}
+		if(entry.compressed_size >= max_zip32) {
+			put64(extra, entry.compressed_size);
+		}
+		if(entry.offset >= max_zip32) {
+			put64(extra, entry.offset);
+		}
+
+		put32(directory, 0x02014b50); //Signature.
+		put16(directory, 45); //Version made by: 4.5 on MS-DOS, which supports ZIP64.
+		put16(directory, extra.empty() ? entry.version_needed : 45);
+		put16(directory, entry.flags);
+		put16(directory, entry.method);
+		put16(directory, dos_time);
+		put16(directory, dos_date);
+		put32(directory, entry.crc);
+		put32(directory, std::min(entry.compressed_size, max_zip32));
+		put32(directory, std::min(entry.uncompressed_size, max_zip32));
+		put16(directory, entry.name.size());
+		put16(directory, extra.empty() ? 0 : extra.size() + 4);
+		put16(directory, 0); //Comment length.
+		put16(directory, 0); //Disk number.
+		put16(directory, 0); //Internal attributes.
+		put32(directory, entry.external_attributes);
+		put32(directory, std::min(entry.offset, max_zip32));
+		directory += entry.name;
+		if(!extra.empty()) {
+			put16(directory, 0x0001); //ZIP64 extra field.
+			put16(directory, extra.size());
+			directory += extra;
+		}
+	}
+	write(directory.data(), directory.size());
+
+	const uint64_t directory_size = directory.size();
+	std::string end;
+	if(entries.size() >= 0xFFFF || directory_size >= max_zip32 || directory_offset >= max_zip32) { //The end of central directory record can't hold these, so add a ZIP64 version of it.
+		const uint64_t end64_offset = position;
+		put32(end, 0x06064b50); //Signature of the ZIP64 end of central directory record.
+		put64(end, 44); //Size of the rest of this record.
+		put16(end, 45); //Version made by.
+		put16(end, 45); //Version needed.
+		put32(end, 0); //Number of this disk.
+		put32(end, 0); //Disk where the central directory starts.
+		put64(end, entries.size()); //Entries on this disk.
+		put64(end, entries.size()); //Entries in total.
+		put64(end, directory_size);
+		put64(end, directory_offset);
+		put32(end, 0x07064b50); //Signature of the ZIP64 end of central directory locator.
+		put32(end, 0); //Disk where the ZIP64 end of central directory record is.
+		put64(end, end64_offset);
+		put32(end, 1); //Total number of disks.
+	}
+	put32(end, 0x06054b50); //Signature of the end of central directory record.
+	put16(end, 0); //Number of this disk.
+	put16(end, 0); //Disk where the central directory starts.
+	put16(end, std::min(entries.size(), size_t(0xFFFF))); //Entries on this disk.
+	put16(end, std::min(entries.size(), size_t(0xFFFF))); //Entries in total.
+	put32(end, std::min(directory_size, max_zip32));
+	put32(end, std::min(directory_offset, max_zip32));
+	put16(end, 0); //Comment length.
+	write(end.data(), end.size());
+}
+
+uint64_t ZipWriter::size() const {
+	return position;
+}
+
+void ZipWriter::write(const char* data, const size_t size) {
+	output(data, size);
+	position += size;
+}
+
+void ZipWriter::write_local_header(Entry& entry, const bool zip64) {
+	entry.offset = position;
+	std::string header;
+	put32(header, 0x04034b50); //Signature.
+	put16(header, entry.version_needed);
+	put16(header, entry.flags);
+	put16(header, entry.method);
+	put16(header, dos_time);
+	put16(header, dos_date);
+	put32(header, entry.crc);
+	if(zip64) { //The sizes are in the extra field.
+		put32(header, max_zip32);
+		put32(header, max_zip32);
+	} else {
+		put32(header, entry.compressed_size);
+		put32(header, entry.uncompressed_size);
+	}
+	put16(header, entry.name.size());
+	put16(header, zip64 ? 20 : 0);
+	header += entry.name;
+	if(zip64) {
+		put16(header, 0x0001); //ZIP64 extra field.
+		put16(header, 16);
+		put64(header, entry.uncompressed_size);
+		put64(header, entry.compressed_size);
+	}
+	write(header.data(), header.size());
+}
+
+ZipWriter::Piece ZipWriter::compress(const char* data, const size_t size) {
+	Piece piece;
+	piece.crc = crc32(0, reinterpret_cast<const Bytef*>(data), size);
+	piece.size = size;
+
+	z_stream stream;
+	stream.zalloc = Z_NULL;
+	stream.zfree = Z_NULL;
+	stream.opaque = Z_NULL;
+	if(deflateInit2(&stream, compression_level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) { //Negative window bits for raw deflate data, without zlib header, as zip archives need.
+		throw std::bad_alloc();
+	}
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+	stream.avail_in = size;
+	piece.data.resize(deflateBound(&stream, size) + 16); //A bit of extra space for the flush marker.
+	size_t used = 0;
+	while(true) {
+		stream.next_out = reinterpret_cast<Bytef*>(&piece.data[used]);
+		stream.avail_out = piece.data.size() - used;
+		deflate(&stream, Z_SYNC_FLUSH); //Ends on a byte boundary without ending the deflate stream, so that the next piece can follow it.
+		used = piece.data.size() - stream.avail_out;
+		if(stream.avail_out > 0) { //Everything is flushed.
+			break;
+		}
+		piece.data.resize(piece.data.size() * 2);
+	}
+	deflateEnd(&stream);
+	piece.data.resize(used);
+	return piece;
+}
+
+void ZipWriter::put16(std::string& record, const uint16_t value) {
+	record += static_cast<char>(value & 0xFF);
+	record += static_cast<char>(value >> 8);
+}
+
+void ZipWriter::put32(std::string& record, const uint32_t value) {
+	put16(record, value & 0xFFFF);
+	put16(record, value >> 16);
+}
+
+void ZipWriter::put64(std::string& record, const uint64_t value) {
+	put32(record, value & 0xFFFFFFFF);
+	put32(record, value >> 32);
+}
+
+}
\ No newline at end of file